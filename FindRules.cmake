@@ -151,31 +151,41 @@ endif()
 ##############################
 
 if ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU")
-  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 5.2)
-     message(FATAL_ERROR "GCC version must be at least 5.2!")
+  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 7.1)
+     message(FATAL_ERROR "GCC version must be at least 7.1!")
   endif()
-  set(CMAKE_CXX_FLAGS "-std=c++14 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -static-libstdc++ -static-libgcc -g") 
+  set(CMAKE_CXX_FLAGS "-std=c++17 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -static-libstdc++ -static-libgcc -g") 
   message(STATUS "GNU FLAGS: ${CMAKE_CXX_FLAGS}")
 elseif ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "Clang")
-  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 3.8)
-     message(FATAL_ERROR "Clang version must be at least 3.8!")
+  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 5.0)
+     message(FATAL_ERROR "Clang version must be at least 5.0!")
   endif()
-  set(CMAKE_CXX_FLAGS "-std=c++14 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -stdlib=libc++ -Wl,-rpath,/opt/clang/lib -g") 
+  set(CMAKE_CXX_FLAGS "-std=c++17 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -stdlib=libc++ -Wl,-rpath,/opt/clang/lib -g") 
   message(STATUS "Clang FLAGS: ${CMAKE_CXX_FLAGS}")
 elseif ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "AppleClang")
-  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 7.0)
-     message(FATAL_ERROR "Apple Clang version must be at least 7.0!")
+  if (CMAKE_CXX_COMPILER_VERSION VERSION_LESS 10.0)
+     message(FATAL_ERROR "Apple Clang version must be at least 10.0!")
   endif()
-  set(CMAKE_CXX_FLAGS "-std=c++14 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -stdlib=libc++ -g") 
+  set(CMAKE_CXX_FLAGS "-std=c++17 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -stdlib=libc++ -g") 
   message(STATUS "Apple Clang FLAGS: ${CMAKE_CXX_FLAGS}")
 elseif ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "Intel")
   message(STATUS "Intel version: ${CMAKE_CXX_COMPILER_VERSION}")
-  set(CMAKE_CXX_FLAGS "-std=c++14 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -static-libstdc++ -static-libgcc -g") 
+  set(CMAKE_CXX_FLAGS "-std=c++17 -Wall -Wno-unused-local-typedefs -Wno-deprecated-declarations -static-libstdc++ -static-libgcc -g") 
   message(STATUS "Intel FLAGS: ${CMAKE_CXX_FLAGS}")
 else ("${CMAKE_CXX_COMPILER_ID}" STREQUAL "GNU")
   message(FATAL_ERROR "Not supported") 
 endif()
 
+# concurrent ingestion stress tests are meant to be run under ThreadSanitizer as well
+option(SANITIZE_THREAD "Build with ThreadSanitizer" OFF)
+if(SANITIZE_THREAD)
+  string(REPLACE "-static-libstdc++ -static-libgcc" "" CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS}")
+  set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -fsanitize=thread -O1")
+  message(STATUS "ThreadSanitizer FLAGS: ${CMAKE_CXX_FLAGS}")
+endif()
+
+find_package( Threads REQUIRED )
+
 ##########
 
 endif(BUILD_CODE)
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <sys/stat.h>
+
+#include "version.hpp"
+
+// software under test
+#include "Exceptions.hpp"
+#include "Journal.hpp"
+#include "ThreadPool.hpp"
+#include "Backtest.hpp"
+
+namespace {
+
+// what is left of a run once its series is written
+struct run_summary {
+   size_t samples {0};
+   double last_index {0.0};
+   double seconds {0.0};
+};
+
+std::string seriesPath(const std::string& directory, const jpmorgan::backtest_config& config)
+{
+   return directory + "/border_" + std::to_string( config.border.count() ) + "_interval_" + std::to_string( config.interval.count() ) + ".csv";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  try {
+        jpmorgan::backtest_options options = jpmorgan::parseBacktest( std::vector<std::string>( argv + 1, argv + argc ) );
+        if( !options.output.empty() ) { ::mkdir( options.output.c_str(), 0755 ); } // might be there already
+
+        jpmorgan::JournalReader journal { options.journal };
+        size_t stocks = jpmorgan::journalStocks( journal.records() );
+        jpmorgan::WorkStealingPool pool { options.threads };
+
+        // every run writes its own file, summaries by run number: nothing shared between workers
+        std::vector<run_summary> summaries( options.configs.size() );
+        auto start = std::chrono::steady_clock::now();
+        jpmorgan::runBacktests( journal.records(), stocks, options.configs, pool, [&](size_t run, const jpmorgan::backtest_series& series) {
+           summaries[run] = run_summary{ series.size(), ( series.size() ? series.all_share_index.back() : 0.0 ), series.wall_seconds };
+           if( !options.output.empty() ) {
+              std::ofstream file { seriesPath( options.output, series.config ) };
+              series.write( file );
+              if( !file ) { throw backtest_io_error(); }
+           }
+        });
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+        std::cout << "border_ms,interval_ms,samples,last_all_share_index,seconds" << std::endl;
+        for(size_t run=0; run<summaries.size(); ++run) {
+           std::cout << options.configs[run].border.count() << "," << options.configs[run].interval.count() << ","
+                     << summaries[run].samples << "," << summaries[run].last_index << "," << summaries[run].seconds << std::endl;
+        }
+        std::cerr << summaries.size() << " runs over " << journal.size() << " records of " << stocks << " stocks on "
+                  << pool.size() << " threads in " << seconds << " s, " << pool.getSteals() << " steals" << std::endl;
+
+	return 0;
+
+   } catch ( const unexpected_option& ) {
+
+	std::cerr << "Usage: " << argv[0] << " journal [--threads 8] [--borders 60,300,900 | 1:900:1] [--interval-ms 1000] [--output dir]" << std::endl;
+	return -3;
+
+   } catch ( const std::exception& e ) {
+
+	std::cerr << e.what() << std::endl;
+	return -1;
+
+   } catch ( ... ) {
+
+        std::cerr << "Uncught Exception" << std::endl;
+        return -2;
+
+   }
+}
@@ -0,0 +1,627 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include "version.hpp"
+
+// software under benchmark
+#include "Feed.hpp"
+#include "Trade.hpp"
+#include "Stock.hpp"
+#include "GBCE.hpp"
+#include "ConcurrentGBCE.hpp"
+#include "Journal.hpp"
+#include "ShardedGBCE.hpp"
+#include "Screen.hpp"
+#include "FeedHandler.hpp"
+#include "Snapshot.hpp"
+#include "Metrics.hpp"
+#include "Published.hpp"
+#include "Backtest.hpp"
+#include "Subscriptions.hpp"
+
+namespace {
+
+// same symbols & prices for every run
+std::vector<std::string> listStocks(jpmorgan::GlobalBeverageCorporationExchange& GBCE, size_t n, jpmorgan::SyntheticFeed& feed)
+{
+   std::vector<std::string> symbols;
+   symbols.reserve( n );
+   for(size_t i=0; i<n; ++i)
+   {
+      symbols.push_back( "S" + std::to_string(i) );
+      jpmorgan::SymbolId id = GBCE.addStock( symbols.back(), 8.0, 100.0 );
+      GBCE.setPrice( id, feed.price( 1.0, 200.0 ) );
+   }
+   return symbols;
+}
+
+// 100 stocks and then packets of 50 trades sharing a timestamp, a price tick between packets
+void encodeFeed(jpmorgan::FeedEncoder& encoder, size_t packets)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::timestamp time = std::chrono::system_clock::now();
+   for(std::uint32_t i=0; i<100; ++i) { encoder.addStock( i, "S" + std::to_string(i), 8.0, 100.0 ); }
+   for(size_t p=0; p<packets; ++p, time += std::chrono::microseconds(100))
+   {
+      encoder.setPrice( static_cast<std::uint32_t>( feed.index( 100 ) ), time, feed.price( 1.0, 200.0 ) );
+      for(size_t t=0; t<50; ++t) { encoder.addTrade( static_cast<std::uint32_t>( feed.index( 100 ) ), time, feed.quantity(), feed.indicator() ); }
+   }
+}
+
+// decoding cost alone
+struct counting_handler {
+   size_t messages {0};
+   unsigned long long quantity {0};
+
+   void onStock(std::uint32_t, std::string_view, double, double, double) { ++messages; }
+   void onPrice(std::uint32_t, const jpmorgan::timestamp&, double) { ++messages; }
+   void onTrade(std::uint32_t, const jpmorgan::timestamp&, unsigned long q, bool) { ++messages; quantity += q; }
+};
+
+} // namespace
+
+/*** VwapWindow ***/
+
+// a trade entering and an older one leaving, as in every sliding window
+template<typename Sum>
+static void VwapWindow_slide(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::VwapWindow<Sum> window;
+   std::vector<jpmorgan::trade_data> trades( 1024 );
+   for(auto& trade : trades) { trade = jpmorgan::trade_data{ feed.quantity(), false, feed.price( 1.0, 200.0 ) }; }
+   for(const auto& trade : trades) { window.add( trade.price, trade.quantity ); }
+   size_t i {0};
+   for(auto _ : state)
+   {
+      const auto& trade = trades[i++ & 1023];
+      window.add( trade.price, trade.quantity );
+      window.subtract( trade.price, trade.quantity );
+      benchmark::DoNotOptimize( window.stockPrice() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK_TEMPLATE(VwapWindow_slide, jpmorgan::plain_sum);
+BENCHMARK_TEMPLATE(VwapWindow_slide, jpmorgan::compensated_sum);
+BENCHMARK_TEMPLATE(VwapWindow_slide, jpmorgan::tick_sum);
+
+/*** Trade ***/
+
+static void Trade_addTrade(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::Trade trade;
+   for(auto _ : state)
+   {
+      trade.addTrade( feed.quantity(), feed.indicator(), feed.price() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(Trade_addTrade);
+
+// window size from 10 to 10M trades, all of them inside the border
+static void Trade_stockPrice(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::Trade trade;
+   for(long i=0; i<state.range(0); ++i) { trade.addTrade( feed.quantity(), feed.indicator(), feed.price() ); }
+
+   for(auto _ : state)
+   {
+      benchmark::DoNotOptimize( trade.stockPrice() );
+   }
+   state.counters["trades"] = static_cast<double>( trade.size() );
+}
+BENCHMARK(Trade_stockPrice)->RangeMultiplier(10)->Range(10, 10000000);
+
+// a dashboard reading four horizons after every trade
+static void Trade_stats_fourWindows(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::Clock manual { jpmorgan::Clock::manual };
+   jpmorgan::Trade trade;
+   trade.setClock( manual );
+   trade.setBorder( jpmorgan::_15min );
+   trade.addWindow( std::chrono::seconds(1) );
+   trade.addWindow( jpmorgan::_5sec );
+   trade.addWindow( std::chrono::minutes(1) );
+
+   for(auto _ : state)
+   {
+      trade.addTrade( feed.quantity(), feed.indicator(), feed.price() );
+      manual.advance( std::chrono::milliseconds(1) );
+      for(jpmorgan::Trade::window_id w=0; w<4; ++w) { benchmark::DoNotOptimize( trade.stats( w ) ); }
+      if( 0 == ( trade.size() & 0xffff ) ) { trade.clearOldTrades(); }
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(Trade_stats_fourWindows);
+
+// a batch of trades already out of the border released at once
+static void Trade_clearOldTrades(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::Trade trade;
+   trade.setBorder( std::chrono::milliseconds(0) );
+
+   for(auto _ : state)
+   {
+      state.PauseTiming();
+      for(long i=0; i<state.range(0); ++i) { trade.addTrade( feed.quantity(), feed.indicator(), feed.price() ); }
+      state.ResumeTiming();
+
+      trade.clearOldTrades();
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(Trade_clearOldTrades)->RangeMultiplier(10)->Range(1000, 1000000);
+
+/*** GBCE ***/
+
+static void GBCE_addTrade_bySymbol(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, state.range(0), feed );
+
+   for(auto _ : state)
+   {
+      GBCE.addTrade( symbols[ feed.index( symbols.size() ) ], feed.quantity(), feed.indicator() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(GBCE_addTrade_bySymbol)->RangeMultiplier(10)->Range(5, 10000);
+
+static void GBCE_addTrade_byId(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, state.range(0), feed );
+
+   for(auto _ : state)
+   {
+      GBCE.addTrade( static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.quantity(), feed.indicator() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(GBCE_addTrade_byId)->RangeMultiplier(10)->Range(5, 10000);
+
+// a feed packet of 50 to 500 trades over 100 stocks, one call per packet
+static void GBCE_addTrades_batch(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, 100, feed );
+
+   std::vector<jpmorgan::trade_event> packet( state.range(0) );
+   for(auto& event : packet) { event = jpmorgan::trade_event{ static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.quantity(), feed.indicator() }; }
+
+   for(auto _ : state)
+   {
+      GBCE.addTrades( packet );
+   }
+   state.SetItemsProcessed( state.iterations() * packet.size() );
+}
+BENCHMARK(GBCE_addTrades_batch)->Arg(50)->Arg(500);
+
+// every tick a few stocks trade and the exchange clears old trades: only those few should be visited
+static void GBCE_clearOldTrades(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::Clock manual { jpmorgan::Clock::manual };
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   GBCE.setClock( manual );
+   std::vector<std::string> symbols = listStocks( GBCE, state.range(0), feed );
+   GBCE.setBorder( jpmorgan::_5sec );
+
+   for(auto _ : state)
+   {
+      for(size_t i=0; i<10; ++i) { GBCE.addTrade( static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.quantity(), feed.indicator() ); }
+      manual.advance( std::chrono::milliseconds(20) );
+      GBCE.clearOldTrades();
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(GBCE_clearOldTrades)->RangeMultiplier(10)->Range(10, 10000);
+
+// one price tick and then the index, the usual pattern
+static void GBCE_allShareIndex(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, state.range(0), feed );
+
+   for(auto _ : state)
+   {
+      GBCE.setPrice( static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.price( 1.0, 200.0 ) );
+      benchmark::DoNotOptimize( GBCE.allShareIndex() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(GBCE_allShareIndex)->RangeMultiplier(10)->Range(5, 10000);
+
+// yield & P/E of every stock in one call, one fifth of them Preferred
+static void GBCE_ratios(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   for(long i=0; i<state.range(0); ++i)
+   {
+      jpmorgan::SymbolId id = GBCE.addStock( "S" + std::to_string(i), 8.0, 100.0, ( 0 == i % 5 ? 0.02 : 0.0 ) );
+      GBCE.setPrice( id, feed.price( 1.0, 200.0 ) );
+   }
+
+   jpmorgan::ratio_columns ratios {};
+   for(auto _ : state)
+   {
+      GBCE.ratios( ratios );
+      benchmark::DoNotOptimize( ratios.dividend_yields.data() );
+      benchmark::DoNotOptimize( ratios.p_e_ratios.data() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(GBCE_ratios)->RangeMultiplier(10)->Range(100, 10000);
+
+// the 50ms screen: snapshot, yield, P/E & VWAP deviation of 8000 stocks and the top 20 yields
+static void ExchangeScreen_snapshot_top(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   for(long i=0; i<state.range(0); ++i)
+   {
+      jpmorgan::SymbolId id = GBCE.addStock( "S" + std::to_string(i), 8.0, 100.0, ( 0 == i % 5 ? 0.02 : 0.0 ) );
+      GBCE.setPrice( id, feed.price( 1.0, 200.0 ) );
+      for(size_t t=0; t<10; ++t) { GBCE.addTrade( id, feed.quantity(), feed.indicator() ); }
+   }
+
+   jpmorgan::ExchangeScreen screen;
+   std::vector<size_t> rows;
+   for(auto _ : state)
+   {
+      screen.snapshot( GBCE );
+      screen.top( jpmorgan::ExchangeScreen::dividend_yield, 20, rows );
+      benchmark::DoNotOptimize( rows.data() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(ExchangeScreen_snapshot_top)->Arg(8000);
+
+// the writer side: every figure of 8000 stocks into their rows
+static void PublishedExchange_publish(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   listStocks( GBCE, static_cast<size_t>( state.range(0) ), feed );
+   jpmorgan::PublishedExchange published { GBCE.getSlotCount() };
+   for(auto _ : state)
+   {
+      published.publish( GBCE );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(PublishedExchange_publish)->Arg(8000);
+
+// the read side: one stock row and the index, from 1 & 4 polling threads at once
+static void PublishedExchange_read(benchmark::State& state)
+{
+   static jpmorgan::SyntheticFeed feed;
+   static jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   static jpmorgan::PublishedExchange published { 1000 };
+   if( 0 == state.thread_index() && 0 == GBCE.size() )
+   {
+      listStocks( GBCE, 1000, feed );
+      published.publish( GBCE );
+   }
+   jpmorgan::SymbolId id = static_cast<jpmorgan::SymbolId>( state.thread_index() );
+   for(auto _ : state)
+   {
+      benchmark::DoNotOptimize( published.at( id ).stock_price );
+      benchmark::DoNotOptimize( published.allShareIndex() );
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(PublishedExchange_read)->Threads(1)->Threads(4);
+
+// a trade then a 'notify' over 100 to 10k VWAP subscriptions coalesced every 100ms, one per stock
+static void ChangeNotifier_notify(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   size_t n = static_cast<size_t>( state.range(0) );
+   listStocks( GBCE, n, feed );
+
+   jpmorgan::ChangeNotifier notifier { GBCE };
+   size_t updates {0};
+   jpmorgan::subscription_options options { 0.0, jpmorgan::subscription_options::absolute, std::chrono::milliseconds(100) };
+   for(jpmorgan::SymbolId id=0; id<n; ++id) { notifier.subscribeStock( id, [&updates](const jpmorgan::change_update&) { ++updates; }, options ); }
+   for(auto _ : state)
+   {
+      GBCE.addTrade( static_cast<jpmorgan::SymbolId>( feed.index( n ) ), feed.quantity(), feed.indicator() );
+      benchmark::DoNotOptimize( notifier.notify() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+   state.counters["updates"] = static_cast<double>( updates );
+}
+BENCHMARK(ChangeNotifier_notify)->Arg(100)->Arg(1000)->Arg(10000);
+
+/*** Feed ***/
+
+static void Feed_decode(benchmark::State& state)
+{
+   jpmorgan::FeedEncoder encoder;
+   encodeFeed( encoder, 20000 );
+
+   size_t messages {0};
+   for(auto _ : state)
+   {
+      counting_handler handler;
+      jpmorgan::decodeFeed( encoder.data(), encoder.size(), handler );
+      benchmark::DoNotOptimize( handler.quantity );
+      messages += handler.messages;
+   }
+   state.SetItemsProcessed( static_cast<long long>( messages ) );
+   state.SetBytesProcessed( state.iterations() * encoder.size() );
+}
+BENCHMARK(Feed_decode);
+
+// from the buffer into a fresh exchange, packets of trades going in as batches
+static void GBCEFeedHandler_apply(benchmark::State& state)
+{
+   jpmorgan::FeedEncoder encoder;
+   encodeFeed( encoder, 20000 );
+
+   size_t messages {0};
+   for(auto _ : state)
+   {
+      state.PauseTiming();
+      {
+         jpmorgan::GlobalBeverageCorporationExchange GBCE;
+         jpmorgan::GBCEFeedHandler handler { GBCE };
+         state.ResumeTiming();
+         handler.apply( encoder.data(), encoder.size() );
+         messages += handler.getMessages();
+         state.PauseTiming();
+      }
+      state.ResumeTiming();
+   }
+   state.SetItemsProcessed( static_cast<long long>( messages ) );
+   state.SetBytesProcessed( state.iterations() * encoder.size() );
+}
+BENCHMARK(GBCEFeedHandler_apply)->Unit(benchmark::kMillisecond);
+
+/*** Snapshot ***/
+
+// 100 stocks holding 1M trades: the pause a capture means for ingestion, and loading it back
+static void SnapshotWriter_capture(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, 100, feed );
+   for(long i=0; i<state.range(0); ++i) { GBCE.addTrade( static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.quantity(), feed.indicator() ); }
+
+   jpmorgan::SnapshotWriter writer;
+   for(auto _ : state)
+   {
+      writer.capture( GBCE );
+      benchmark::DoNotOptimize( writer.bytes().data() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+   state.SetBytesProcessed( state.iterations() * writer.bytes().size() );
+}
+BENCHMARK(SnapshotWriter_capture)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void restoreSnapshot(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::GlobalBeverageCorporationExchange GBCE;
+   std::vector<std::string> symbols = listStocks( GBCE, 100, feed );
+   for(long i=0; i<state.range(0); ++i) { GBCE.addTrade( static_cast<jpmorgan::SymbolId>( feed.index( symbols.size() ) ), feed.quantity(), feed.indicator() ); }
+
+   jpmorgan::SnapshotWriter writer;
+   writer.capture( GBCE );
+   for(auto _ : state)
+   {
+      jpmorgan::GlobalBeverageCorporationExchange restored;
+      jpmorgan::restoreSnapshot( restored, writer.bytes() );
+      benchmark::DoNotOptimize( restored.allShareIndex() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+}
+BENCHMARK(restoreSnapshot)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+/*** ConcurrentExchange ***/
+
+// 1..8 producers pushing trades over 100 stocks at once, a background thread draining & publishing
+static void ConcurrentExchange_pushTrade(benchmark::State& state)
+{
+   static std::unique_ptr<jpmorgan::ConcurrentExchange> exchange {};
+   static std::atomic<bool> done {false};
+   static std::thread drainer {};
+   if( 0 == state.thread_index() )
+   {
+      jpmorgan::SyntheticFeed prices;
+      jpmorgan::GlobalBeverageCorporationExchange GBCE;
+      listStocks( GBCE, 100, prices );
+      exchange.reset( new jpmorgan::ConcurrentExchange( std::move(GBCE) ) );
+      done.store( false );
+      drainer = std::thread( []() { do { exchange->drain(); } while( !done.load() ); } );
+   }
+
+   // every producer its own feed, the loop starts once every thread is here
+   jpmorgan::SyntheticFeed feed { 0x5eed + static_cast<std::uint64_t>( state.thread_index() ) };
+   for(auto _ : state)
+   {
+      jpmorgan::SymbolId id = static_cast<jpmorgan::SymbolId>( feed.index( 100 ) );
+      unsigned long quantity = feed.quantity();
+      bool indicator = feed.indicator();
+      while( !exchange->pushTrade( id, quantity, indicator ) ) { std::this_thread::yield(); }
+   }
+   state.SetItemsProcessed( state.iterations() );
+
+   if( 0 == state.thread_index() )
+   {
+      done.store( true );
+      drainer.join();
+      exchange.reset();
+   }
+}
+BENCHMARK(ConcurrentExchange_pushTrade)->Threads(1)->Threads(2)->Threads(4)->Threads(8)->UseRealTime();
+
+/*** ShardedExchange ***/
+
+// as many producers as shards, each one feeding the stocks of its own shard; items are added up over
+// every producer, so points from 1 to 32 shards compare as aggregate throughput
+static void ShardedExchange_pushTrade(benchmark::State& state)
+{
+   constexpr size_t stocks {256}; // the same number on every shard up to 32 of them
+   static std::unique_ptr<jpmorgan::ShardedExchange> sharded {};
+   size_t shards = static_cast<size_t>( state.threads() );
+   if( 0 == state.thread_index() )
+   {
+      jpmorgan::SyntheticFeed prices;
+      sharded.reset( new jpmorgan::ShardedExchange( shards ) );
+      for(size_t i=0; i<stocks; ++i)
+      {
+         jpmorgan::SymbolId id = sharded->addStock( "S" + std::to_string(i), 8.0, 100.0 );
+         sharded->setPrice( id, prices.price( 1.0, 200.0 ) );
+      }
+      sharded->start();
+   }
+
+   // symbol 'id' lives in shard 'id % shards'
+   size_t own = static_cast<size_t>( state.thread_index() );
+   jpmorgan::SyntheticFeed feed { 0x5eed + own };
+   for(auto _ : state)
+   {
+      jpmorgan::SymbolId id = static_cast<jpmorgan::SymbolId>( own + shards * feed.index( stocks / shards ) );
+      unsigned long quantity = feed.quantity();
+      bool indicator = feed.indicator();
+      while( !sharded->pushTrade( id, quantity, indicator ) ) { std::this_thread::yield(); }
+   }
+   state.SetItemsProcessed( state.iterations() );
+
+   if( 0 == state.thread_index() )
+   {
+      sharded->sync();
+      sharded->stop();
+      sharded.reset();
+   }
+}
+BENCHMARK(ShardedExchange_pushTrade)->Threads(1)->Threads(2)->Threads(4)->Threads(8)->Threads(16)->Threads(32)->UseRealTime();
+
+/*** Journal ***/
+
+static void Journal_appendTrade(benchmark::State& state)
+{
+   const std::string path { "benchmark.journal" };
+   std::remove( path.c_str() );
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::timestamp now = std::chrono::system_clock::now();
+   {
+      jpmorgan::TradeJournal journal { path };
+      for(auto _ : state)
+      {
+         journal.appendTrade( static_cast<jpmorgan::SymbolId>( feed.index( 100 ) ), now, jpmorgan::trade_data{ feed.quantity(), feed.indicator(), 100.0 } );
+      }
+   }
+   state.SetItemsProcessed( state.iterations() );
+   std::remove( path.c_str() );
+}
+BENCHMARK(Journal_appendTrade);
+
+// a restart: 100 stocks back from a journal of 1M records
+static void GBCE_replay(benchmark::State& state)
+{
+   const std::string path { "benchmark.journal" };
+   std::remove( path.c_str() );
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::timestamp now = std::chrono::system_clock::now();
+   {
+      jpmorgan::TradeJournal journal { path };
+      for(long i=0; i<state.range(0); ++i)
+      {
+         journal.appendTrade( static_cast<jpmorgan::SymbolId>( feed.index( 100 ) ), now + std::chrono::microseconds(i), jpmorgan::trade_data{ feed.quantity(), feed.indicator(), feed.price( 1.0, 200.0 ) } );
+      }
+   }
+
+   jpmorgan::JournalReader reader { path };
+   for(auto _ : state)
+   {
+      jpmorgan::GlobalBeverageCorporationExchange GBCE;
+      listStocks( GBCE, 100, feed );
+      GBCE.replay( reader.records() );
+      benchmark::DoNotOptimize( GBCE.allShareIndex() );
+   }
+   state.SetItemsProcessed( state.iterations() * state.range(0) );
+   state.SetBytesProcessed( state.iterations() * state.range(0) * sizeof(jpmorgan::journal_record) );
+   std::remove( path.c_str() );
+}
+BENCHMARK(GBCE_replay)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+// a sweep of 16 borders over 100k records of 100 stocks, on 1, 2, 4 & 8 workers
+static void runBacktests(benchmark::State& state)
+{
+   jpmorgan::SyntheticFeed feed;
+   jpmorgan::timestamp time = std::chrono::system_clock::now();
+   std::vector<jpmorgan::journal_record> records( 100000 );
+   for(size_t i=0; i<records.size(); ++i)
+   {
+      records[i].setTimestamp( time + std::chrono::milliseconds( 20 * i ) );
+      records[i].value = feed.price( 1.0, 200.0 );
+      records[i].quantity = feed.quantity();
+      records[i].id = static_cast<std::uint32_t>( feed.index( 100 ) );
+      records[i].kind = ( 0 == i % 10 ? jpmorgan::journal_record::price : jpmorgan::journal_record::trade );
+   }
+   std::vector<jpmorgan::backtest_config> configs;
+   for(long border=1; border<=16; ++border) { configs.push_back( jpmorgan::backtest_config{ std::chrono::minutes( border ), std::chrono::seconds(1) } ); }
+
+   jpmorgan::WorkStealingPool pool { static_cast<size_t>( state.range(0) ) };
+   for(auto _ : state)
+   {
+      jpmorgan::runBacktests( records, 100, configs, pool, [](size_t, const jpmorgan::backtest_series& series) { benchmark::DoNotOptimize( series.vwaps.data() ); } );
+   }
+   state.SetItemsProcessed( state.iterations() * configs.size() * records.size() );
+}
+BENCHMARK(runBacktests)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/*** Metrics ***/
+
+// what JPMORGAN_METRICS adds to every instrumented call: two tick reads and a record
+static void Metrics_scopedTimer(benchmark::State& state)
+{
+   jpmorgan::Histogram histogram;
+   for(auto _ : state)
+   {
+      jpmorgan::ScopedTimer timer { histogram };
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(Metrics_scopedTimer);
+
+// JSON by default so that results can be stored and compared between releases
+int main(int argc, char** argv)
+{
+   std::vector<char*> arguments( argv, argv + argc );
+   bool format_given = false;
+   for(char* argument : arguments) { format_given = ( format_given || 0 == std::strncmp( argument, "--benchmark_format", 18 ) ); }
+
+   static char json_format[] = "--benchmark_format=json";
+   if( !format_given ) { arguments.push_back( json_format ); }
+
+   int size = static_cast<int>( arguments.size() );
+   benchmark::Initialize( &size, arguments.data() );
+   if( benchmark::ReportUnrecognizedArguments( size, arguments.data() ) ) { return 1; }
+
+   benchmark::AddCustomContext( "version_info", VERSION_INFO );
+   benchmark::RunSpecifiedBenchmarks();
+   benchmark::Shutdown();
+   return 0;
+}
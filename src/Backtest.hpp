@@ -0,0 +1,223 @@
+#ifndef BACKTEST_HPP
+#define BACKTEST_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Symbols.hpp"
+#include "Span.hpp"
+#include "Journal.hpp"
+#include "ThreadPool.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Parameter sweeps over a recorded day: the journal is mapped once and shared read-only, every
+// configuration gets an exchange of its own on a manual clock, and runs go through a work-stealing
+// pool, so a sweep takes as long as its runs divided by the cores, not their sum.
+
+// A run replays the journal chunk by chunk, one chunk per sampling interval: at the end of every
+// interval old trades are cleared and the All Share Index plus the VWAP of every stock are sampled.
+// Journal records only carry ids, so stocks are listed as "S<id>" up to the highest id found;
+// dividends play no part in any VWAP nor in the index.
+
+/**** PROPER INTERFACE *****/
+
+struct backtest_config {
+   std::chrono::milliseconds border {_15min}; // window 0, the VWAP one
+   std::chrono::milliseconds interval {1000}; // between samples
+};
+
+struct backtest_series {
+   backtest_config config {};
+   size_t stocks {0};
+   std::vector<timestamp> times {}; // end of every interval
+   std::vector<double> all_share_index {};
+   std::vector<double> vwaps {}; // 'stocks' per sample, sample after sample
+   double wall_seconds {0.0};
+
+   inline size_t size() const; // samples
+   inline span<const double> vwap(size_t sample) const; // by SymbolId
+
+   inline void write(std::ostream& out) const; // CSV: time in nanoseconds since epoch, index, S0, S1, ...
+};
+
+// "journal [--threads 8] [--borders 60,300,900 | 1:900:1] [--interval-ms 1000,5000] [--output dir]"
+// every border with every interval, borders in seconds
+struct backtest_options {
+   std::string journal {};
+   std::vector<backtest_config> configs {};
+   size_t threads {std::thread::hardware_concurrency()};
+   std::string output {}; // no series written when empty
+};
+
+inline size_t journalStocks(span<const journal_record> records); // highest id plus one
+
+inline backtest_series runBacktest(span<const journal_record> records, size_t stocks, const backtest_config& config);
+
+// called by the worker that ran 'configs[run]', right before its series is dropped: a day of
+// samples of every stock for hundreds of runs doesn't fit in memory at once
+using backtest_sink = std::function<void(size_t run, const backtest_series& series)>;
+
+// returns once every run went through 'sink'
+inline void runBacktests(span<const journal_record> records, size_t stocks, const std::vector<backtest_config>& configs,
+                         WorkStealingPool& pool, const backtest_sink& sink);
+
+// throws unexpected_option, also for empty ranges, infinities and values past whole milliseconds
+inline backtest_options parseBacktest(const std::vector<std::string>& options);
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+size_t jpmorgan::backtest_series::size() const { return times.size(); }
+
+jpmorgan::span<const double> jpmorgan::backtest_series::vwap(size_t sample) const { return span<const double>{ vwaps.data() + sample * stocks, stocks }; }
+
+void jpmorgan::backtest_series::write(std::ostream& out) const
+{
+   out << "time,all_share_index";
+   for(size_t id=0; id<stocks; ++id) { out << ",S" << id; }
+   out << "\n";
+
+   for(size_t s=0; s<size(); ++s)
+   {
+      out << std::chrono::duration_cast<std::chrono::nanoseconds>( times[s].time_since_epoch() ).count() << "," << all_share_index[s];
+      for(double value : vwap(s)) { out << "," << value; }
+      out << "\n";
+   }
+}
+
+size_t jpmorgan::journalStocks(span<const journal_record> records)
+{
+   size_t stocks {0};
+   for(const auto& record : records) { if( record.id >= stocks ) { stocks = record.id + 1; } }
+   return stocks;
+}
+
+jpmorgan::backtest_series jpmorgan::runBacktest(span<const journal_record> records, size_t stocks, const backtest_config& config)
+{
+   auto wall_start = std::chrono::steady_clock::now();
+
+   backtest_series series {};
+   series.config = config;
+   series.stocks = stocks;
+   if( records.empty() ) { return series; }
+
+   Clock clock { Clock::manual, records[0].getTimestamp() };
+   GlobalBeverageCorporationExchange gbce;
+   gbce.setClock( clock );
+   gbce.setBorder( config.border );
+   for(size_t id=0; id<stocks; ++id) { gbce.addStock( "S" + std::to_string(id), 0.0, 100.0 ); }
+
+   std::chrono::milliseconds interval = ( 0 < config.interval.count() ? config.interval : std::chrono::milliseconds(1) );
+   size_t first {0};
+   for(timestamp end = records[0].getTimestamp() + interval; first < records.size(); end += interval)
+   {
+      size_t last = first;
+      while( last < records.size() && records[last].getTimestamp() < end ) { ++last; }
+      gbce.replay( records.subspan( first, last - first ) );
+      first = last;
+
+      clock.set( end );
+      gbce.clearOldTrades();
+
+      series.times.push_back( end );
+      series.all_share_index.push_back( gbce.allShareIndex() );
+      for(SymbolId id=0; id<stocks; ++id) { series.vwaps.push_back( gbce.stockPrice(id) ); }
+   }
+
+   series.wall_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - wall_start ).count();
+   return series;
+}
+
+void jpmorgan::runBacktests(span<const journal_record> records, size_t stocks, const std::vector<backtest_config>& configs,
+                            WorkStealingPool& pool, const backtest_sink& sink)
+{
+   for(size_t i=0; i<configs.size(); ++i)
+   {
+      pool.submit( [&configs, &sink, records, stocks, i]() { sink( i, runBacktest( records, stocks, configs[i] ) ); } );
+   }
+   pool.wait();
+}
+
+jpmorgan::backtest_options jpmorgan::parseBacktest(const std::vector<std::string>& options)
+{
+   // "a,b,c" where every item might be a "from:to:step" range as well; positive and finite, ranges not empty
+   constexpr double max_value {1e12}; // still whole milliseconds in a long long
+   constexpr size_t max_values {1000000};
+   auto numbers = [max_value, max_values](const std::string& list) {
+      std::vector<double> result;
+      size_t begin {0};
+      while( begin <= list.size() )
+      {
+         size_t comma = list.find( ',', begin );
+         std::string item = list.substr( begin, ( std::string::npos == comma ? list.size() : comma ) - begin );
+         double range[3] { 0.0, 0.0, 1.0 };
+         size_t parts {0};
+         const char* p = item.c_str();
+         for(;;)
+         {
+            char* end {nullptr};
+            double value = std::strtod( p, &end );
+            if( end == p || 3 <= parts || !std::isfinite( value ) || !( 0.0 < value ) || max_value < value ) { throw unexpected_option(); }
+            range[parts++] = value;
+            if( '\0' == *end ) { break; }
+            if( ':' != *end ) { throw unexpected_option(); }
+            p = end + 1;
+         }
+         if( 1 == parts ) { result.push_back( range[0] ); }
+         else
+         {
+            if( range[1] < range[0] || ( range[1] - range[0] ) / range[2] >= max_values ) { throw unexpected_option(); }
+            for(double value = range[0]; value <= range[1] + 1e-9; value += range[2]) { result.push_back( value ); }
+         }
+
+         if( std::string::npos == comma ) { break; }
+         begin = comma + 1;
+      }
+      return result;
+   };
+
+   backtest_options parsed {};
+   std::vector<double> borders { std::chrono::duration<double>( _15min ).count() };
+   std::vector<double> intervals { 1000.0 };
+   for(size_t i=0; i<options.size(); ++i)
+   {
+      const std::string& name = options[i];
+      if( 0 != name.compare( 0, 2, "--" ) )
+      {
+         if( !parsed.journal.empty() ) { throw unexpected_option(); }
+         parsed.journal = name;
+         continue;
+      }
+      if( i + 1 >= options.size() ) { throw unexpected_option(); }
+      const std::string& value = options[++i];
+
+      if( "--borders" == name ) { borders = numbers( value ); }
+      else if( "--interval-ms" == name ) { intervals = numbers( value ); }
+      else if( "--threads" == name ) { parsed.threads = static_cast<size_t>( numbers( value ).at(0) ); }
+      else if( "--output" == name ) { parsed.output = value; }
+      else { throw unexpected_option(); }
+   }
+   if( parsed.journal.empty() ) { throw unexpected_option(); }
+
+   for(double border : borders)
+   {
+      for(double interval : intervals)
+      {
+         parsed.configs.push_back( backtest_config{ std::chrono::milliseconds( std::llround( border * 1000 ) ), std::chrono::milliseconds( std::llround( interval ) ) } );
+      }
+   }
+   return parsed;
+}
+
+#endif // BACKTEST_HPP
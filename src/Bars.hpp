@@ -0,0 +1,175 @@
+#ifndef BARS_HPP
+#define BARS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "Clock.hpp"
+
+namespace jpmorgan {
+
+// Open/high/low/close/volume bars built while trades arrive, so that history can be asked for
+// without keeping the trades: one 64 bytes bar per interval instead of thousands of trades.
+
+// Bars start on multiples of the interval since epoch, that way bars of different stocks line up
+// and the All Share Index can be calculated per bar. Intervals without trades get a flat bar at the
+// last close and zero volume, so finished bars are contiguous in time and found by just dividing.
+
+// Finished bars go into a ring allocated once; when it's full the oldest bar is overwritten.
+
+/**** PROPER INTERFACE *****/
+
+struct bar {
+   timestamp start {};
+   double open {0.0};
+   double high {0.0};
+   double low {0.0};
+   double close {0.0};
+   unsigned long long volume {0};
+   double price_x_quantity {0.0};
+   size_t count {0}; // trades, zero for a flat bar
+
+   inline double vwap() const; // close when there was no volume
+};
+
+class BarBuilder
+{
+public:
+  inline explicit BarBuilder(std::chrono::milliseconds interval = std::chrono::minutes(1), size_t capacity = 1024);
+
+  inline void add(const timestamp& time, double price, unsigned long quantity);
+  inline void close(const timestamp& right_now); // finishes every bar before the interval of 'right_now'
+
+  inline std::chrono::milliseconds getInterval() const;
+  inline size_t size() const; // finished bars kept
+  inline size_t capacity() const;
+  inline bool empty() const;
+  inline const bar& operator[](size_t i) const; // finished ones, 0 is the oldest
+  inline const bar* find(const timestamp& start) const; // finished bar starting at 'start', if still kept
+  inline bool isOpen() const;
+  inline const bar& current() const; // the one being built
+
+private:
+  inline timestamp startOf(const timestamp& time) const;
+  inline void finish(); // open bar into the ring
+  inline void fill(const timestamp& until);
+  inline void push(const bar& finished);
+
+  std::chrono::milliseconds interval {std::chrono::minutes(1)};
+  std::vector<bar> ring {};
+  size_t first {0};
+  size_t count {0};
+  bar open_bar {};
+  bool open {false};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+double jpmorgan::bar::vwap() const
+{
+   if( 0 == volume ) { return close; }
+   return ( price_x_quantity / volume );
+}
+
+jpmorgan::BarBuilder::BarBuilder(std::chrono::milliseconds i, size_t c) :
+ interval{ i > std::chrono::milliseconds::zero() ? i : std::chrono::milliseconds(1) }, ring( c > 0 ? c : 1 )
+{
+}
+
+jpmorgan::timestamp jpmorgan::BarBuilder::startOf(const timestamp& time) const
+{
+   timestamp::duration step = std::chrono::duration_cast<timestamp::duration>( interval );
+   return timestamp{ ( time.time_since_epoch() / step ) * step };
+}
+
+void jpmorgan::BarBuilder::push(const bar& finished)
+{
+   ring[ ( first + count ) % ring.size() ] = finished;
+   if( count < ring.size() ) { ++count; } else { first = ( first + 1 ) % ring.size(); }
+}
+
+void jpmorgan::BarBuilder::finish()
+{
+   push( open_bar );
+   open = false;
+}
+
+// flat bars from the last finished one up to 'until', never more than the ring can keep
+void jpmorgan::BarBuilder::fill(const timestamp& until)
+{
+   if( 0 == count ) { return; }
+
+   timestamp::duration step = std::chrono::duration_cast<timestamp::duration>( interval );
+   const bar& last = (*this)[count - 1];
+   timestamp flat_start = last.start + step;
+   if( until <= flat_start ) { return; }
+
+   size_t gaps = static_cast<size_t>( ( until - flat_start ) / step );
+   if( gaps > ring.size() ) { flat_start += step * static_cast<long long>( gaps - ring.size() ); gaps = ring.size(); }
+
+   double last_close = last.close;
+   for(size_t i=0; i<gaps; ++i, flat_start += step) {
+      push( bar{ flat_start, last_close, last_close, last_close, last_close, 0, 0.0, 0 } );
+   }
+}
+
+// every interval before the one of 'right_now' gets its bar, even without trades
+void jpmorgan::BarBuilder::close(const timestamp& right_now)
+{
+   timestamp now_start = startOf( right_now );
+
+   if( open )
+   {
+      if( now_start <= open_bar.start ) { return; }
+      finish();
+   }
+
+   fill( now_start );
+}
+
+void jpmorgan::BarBuilder::add(const timestamp& time, double price, unsigned long quantity)
+{
+   // a late trade just goes into the open bar, finished bars are never reopened
+   if( open && time >= open_bar.start + interval ) { close( time ); }
+
+   if( !open )
+   {
+      timestamp start = startOf( time );
+      fill( start );
+      if( 0 < count && start <= (*this)[count - 1].start ) { start = (*this)[count - 1].start + interval; }
+      open_bar = bar{ start, price, price, price, price, 0, 0.0, 0 };
+      open = true;
+   }
+
+   open_bar.high = std::max( open_bar.high, price );
+   open_bar.low = std::min( open_bar.low, price );
+   open_bar.close = price;
+   open_bar.volume += quantity;
+   open_bar.price_x_quantity += price * quantity;
+   ++open_bar.count;
+}
+
+std::chrono::milliseconds jpmorgan::BarBuilder::getInterval() const { return interval; }
+size_t jpmorgan::BarBuilder::size() const { return count; }
+size_t jpmorgan::BarBuilder::capacity() const { return ring.size(); }
+bool jpmorgan::BarBuilder::empty() const { return ( 0 == count ); }
+const jpmorgan::bar& jpmorgan::BarBuilder::operator[](size_t i) const { return ring[ ( first + i ) % ring.size() ]; }
+bool jpmorgan::BarBuilder::isOpen() const { return open; }
+const jpmorgan::bar& jpmorgan::BarBuilder::current() const { return open_bar; }
+
+const jpmorgan::bar* jpmorgan::BarBuilder::find(const timestamp& start) const
+{
+   if( 0 == count || start < (*this)[0].start ) { return nullptr; }
+
+   size_t i = static_cast<size_t>( ( start - (*this)[0].start ) / std::chrono::duration_cast<timestamp::duration>( interval ) );
+   if( i >= count ) { return nullptr; }
+
+   const bar& found = (*this)[i];
+   return ( found.start == start ? &found : nullptr );
+}
+
+#endif // BARS_HPP
@@ -0,0 +1,145 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JPMORGAN_TSC_CLOCK 1
+#include <x86intrin.h>
+#endif
+
+namespace jpmorgan {
+
+using timestamp = std::chrono::time_point<std::chrono::system_clock>;
+
+// Where trades and windows get their 'now' from. Asking std::chrono::system_clock for every trade
+// and every query is not for free, and tests or replays need time to go at their own pace.
+
+// As with Common & Preferred stocks, a humble switch on the kind of clock is used instead of a vtable:
+//  * system: std::chrono::system_clock::now() every time, the default
+//  * coarse: system time cached by 'refresh', i.e. once per batch or per event loop tick
+//  * tsc:    CPU time stamp counter scaled to system time (invariant TSC supposed), system elsewhere
+//  * manual: only moves with 'set' or 'advance', for tests & replays
+
+// The cached time is atomic (relaxed), so producer threads of the concurrent & sharded exchanges may
+// read a coarse or manual clock while its owner refreshes, sets or advances it. Calibrating a tsc clock
+// again is not atomic, refresh it only while nobody else reads it.
+
+/**** PROPER INTERFACE *****/
+
+class Clock
+{
+public:
+  enum kind_type : unsigned char { system, coarse, tsc, manual };
+
+  inline explicit Clock(kind_type kind = system, timestamp start = std::chrono::system_clock::now());
+  inline Clock(const Clock& other);
+  inline Clock& operator=(const Clock& other);
+
+  inline timestamp now() const;
+  inline void refresh(); // coarse: read system time again, tsc: calibrate again
+  inline void set(timestamp new_now); // manual
+  inline void advance(std::chrono::nanoseconds elapsed); // manual
+
+  inline kind_type getKind() const;
+
+  static inline const Clock& systemClock(); // shared default one
+
+private:
+  inline void calibrate();
+
+  kind_type kind {system};
+  std::atomic<timestamp::rep> cached {0}; // coarse & manual, ticks since the epoch
+
+#ifdef JPMORGAN_TSC_CLOCK
+  timestamp base_time {};
+  std::uint64_t base_ticks {0};
+  double nanoseconds_per_tick {0.0};
+#endif
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::Clock::Clock(kind_type k, timestamp start) : kind{k}, cached{start.time_since_epoch().count()}
+{
+#ifdef JPMORGAN_TSC_CLOCK
+   if( tsc == kind ) { calibrate(); }
+#else
+   if( tsc == kind ) { kind = system; }
+#endif
+}
+
+jpmorgan::Clock::Clock(const Clock& other) { *this = other; }
+
+jpmorgan::Clock& jpmorgan::Clock::operator=(const Clock& other)
+{
+   kind = other.kind;
+   cached.store( other.cached.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+#ifdef JPMORGAN_TSC_CLOCK
+   base_time = other.base_time;
+   base_ticks = other.base_ticks;
+   nanoseconds_per_tick = other.nanoseconds_per_tick;
+#endif
+   return *this;
+}
+
+const jpmorgan::Clock& jpmorgan::Clock::systemClock()
+{
+   static const Clock clock { system };
+   return clock;
+}
+
+jpmorgan::timestamp jpmorgan::Clock::now() const
+{
+   switch( kind )
+   {
+     case coarse:
+     case manual:
+        return timestamp{ timestamp::duration{ cached.load( std::memory_order_relaxed ) } };
+#ifdef JPMORGAN_TSC_CLOCK
+     case tsc:
+        return base_time + std::chrono::duration_cast<timestamp::duration>(
+                              std::chrono::nanoseconds( static_cast<long long>( ( __rdtsc() - base_ticks ) * nanoseconds_per_tick ) ) );
+#endif
+     default:
+        return std::chrono::system_clock::now();
+   }
+}
+
+void jpmorgan::Clock::refresh()
+{
+   if( coarse == kind ) { cached.store( std::chrono::system_clock::now().time_since_epoch().count(), std::memory_order_relaxed ); }
+#ifdef JPMORGAN_TSC_CLOCK
+   if( tsc == kind ) { calibrate(); }
+#endif
+}
+
+void jpmorgan::Clock::set(timestamp new_now) { cached.store( new_now.time_since_epoch().count(), std::memory_order_relaxed ); }
+void jpmorgan::Clock::advance(std::chrono::nanoseconds elapsed) { cached.fetch_add( std::chrono::duration_cast<timestamp::duration>( elapsed ).count(), std::memory_order_relaxed ); }
+
+jpmorgan::Clock::kind_type jpmorgan::Clock::getKind() const { return kind; }
+
+// ticks per nanosecond measured against the steady clock for a couple of milliseconds
+void jpmorgan::Clock::calibrate()
+{
+#ifdef JPMORGAN_TSC_CLOCK
+   auto steady_start = std::chrono::steady_clock::now();
+   std::uint64_t ticks_start = __rdtsc();
+
+   auto steady_end = steady_start;
+   while( steady_end - steady_start < std::chrono::milliseconds(2) ) { steady_end = std::chrono::steady_clock::now(); }
+   std::uint64_t ticks_end = __rdtsc();
+
+   double elapsed = std::chrono::duration<double, std::nano>( steady_end - steady_start ).count();
+   nanoseconds_per_tick = ( ticks_end > ticks_start ? elapsed / ( ticks_end - ticks_start ) : 1.0 );
+
+   base_time = std::chrono::system_clock::now();
+   base_ticks = __rdtsc();
+#endif
+}
+
+#endif // CLOCK_HPP
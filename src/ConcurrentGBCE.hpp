@@ -0,0 +1,167 @@
+#ifndef CONCURRENTGBCE_HPP
+#define CONCURRENTGBCE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Queue.hpp"
+#include "GBCE.hpp"
+#include "Published.hpp"
+
+namespace jpmorgan {
+
+// GBCE itself is not thread-safe at all. This wrapper lets several feed threads push trades and
+// prices at the same time through one lock-free queue per stock, without any lock on their side.
+
+// Queued events are applied to the stocks only by 'drain', which then publishes the figures of every
+// stock and the All Share Index (see Published.hpp). Readers load that snapshot: no lock, no draining,
+// whatever the backlog; they see everything applied by the last 'drain', all of it of the same moment.
+// Nothing drains in the background: some thread must call 'drain' often enough, otherwise
+// queues fill up and pushes return false until somebody does. Trades are stamped by the exchange
+// clock when pushed, not when drained, so a late drain doesn't move them in their windows; coarse and
+// manual clocks may be refreshed or moved by their owner meanwhile, their time is read atomically.
+// Stocks must be listed before wrapping the exchange; the set of queues never changes afterwards.
+// Ids of stocks removed before wrapping get no queue, so pushes for them throw stock_non_found.
+
+/**** PROPER INTERFACE *****/
+
+struct ingest_event {
+   enum kind_type : unsigned char { trade, price };
+
+   kind_type kind {trade};
+   bool indicator {false}; // buy->false or sell->true
+   unsigned long quantity {0};
+   double value {0.0}; // new price
+   timestamp time {}; // trades, when pushed
+};
+
+class ConcurrentExchange
+{
+public:
+  inline explicit ConcurrentExchange(GlobalBeverageCorporationExchange gbce, size_t queue_capacity = 1024);
+
+  ConcurrentExchange(const ConcurrentExchange&) =delete;
+  ConcurrentExchange& operator=(const ConcurrentExchange&) =delete;
+
+  // producers, any thread: false when that stock's queue is full
+  inline bool pushTrade(SymbolId id, unsigned long quantity, bool indicator);
+  inline bool pushTrade(std::string_view symbol, unsigned long quantity, bool indicator);
+  inline bool pushPrice(SymbolId id, double price);
+  inline bool pushPrice(std::string_view symbol, double price);
+  inline SymbolId getSymbolId(std::string_view symbol) const;
+
+  // any thread, serialized among them: returns the number of events applied
+  inline size_t drain();
+
+  // readers, any thread: figures as published by the last 'drain', without waiting for it
+  inline double stockPrice(std::string_view symbol) const;
+  inline double getPrice(std::string_view symbol) const;
+  inline double dividendYield(std::string_view symbol) const;
+  inline double p_e_ratio(std::string_view symbol) const;
+  inline double allShareIndex() const;
+  inline std::uint64_t getVersion() const; // drains so far, plus one
+  inline size_t getTradeSize(std::string_view symbol); // waits for a running 'drain'
+
+
+private:
+  using queue_type = MpscQueue<ingest_event>;
+
+  inline queue_type& queue(SymbolId id) const;
+  inline size_t drain(SymbolId id); // mutex already taken
+  inline published_stock row(std::string_view symbol) const; // throws stock_non_found for removed stocks
+
+  GlobalBeverageCorporationExchange exchange;
+  std::vector<std::unique_ptr<queue_type>> queues {}; // by SymbolId, null for removed stocks, read-only after construction
+  PublishedExchange published;
+  std::mutex drainer {};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::ConcurrentExchange::ConcurrentExchange(GlobalBeverageCorporationExchange gbce, size_t queue_capacity) : exchange{ std::move(gbce) }, published{ exchange.getSlotCount() }
+{
+   // by id, removed stocks leave holes
+   queues.resize( exchange.getSlotCount() );
+   for(SymbolId id=0; id<queues.size(); ++id) { if( exchange.isListed( id ) ) { queues[id].reset( new queue_type( queue_capacity ) ); } }
+   published.publish( exchange ); // readers get the wrapped figures until the first drain
+}
+
+jpmorgan::ConcurrentExchange::queue_type& jpmorgan::ConcurrentExchange::queue(SymbolId id) const
+{
+   if( id >= queues.size() || !queues[id] ) { throw stock_non_found(); }
+   return *queues[id];
+}
+
+// the symbol table is read-only as well, so looking up names is fine from any thread
+jpmorgan::SymbolId jpmorgan::ConcurrentExchange::getSymbolId(std::string_view symbol) const { return exchange.getSymbolId( symbol ); }
+
+bool jpmorgan::ConcurrentExchange::pushTrade(SymbolId id, unsigned long quantity, bool indicator)
+{
+   queue_type& target = queue(id);
+   return target.push( ingest_event{ ingest_event::trade, indicator, quantity, 0.0, exchange.getClock().now() } );
+}
+bool jpmorgan::ConcurrentExchange::pushTrade(std::string_view symbol, unsigned long quantity, bool indicator) { return pushTrade( getSymbolId(symbol), quantity, indicator ); }
+
+bool jpmorgan::ConcurrentExchange::pushPrice(SymbolId id, double price)
+{
+   if( 0.0 > price ) { throw unexpected_negative_value(); }
+   return queue(id).push( ingest_event{ ingest_event::price, false, 0, price } );
+}
+bool jpmorgan::ConcurrentExchange::pushPrice(std::string_view symbol, double price) { return pushPrice( getSymbolId(symbol), price ); }
+
+size_t jpmorgan::ConcurrentExchange::drain(SymbolId id)
+{
+   queue_type& pending = queue( id );
+   size_t applied {0};
+
+   ingest_event event {};
+   while( pending.pop( event ) )
+   {
+      if( ingest_event::price == event.kind ) { exchange.setPrice( id, event.value ); }
+      else { exchange.addTrade( id, event.time, event.quantity, event.indicator ); }
+      ++applied;
+   }
+
+   return applied;
+}
+
+// the only place stocks change, so what's published is exactly what the exchange holds
+size_t jpmorgan::ConcurrentExchange::drain()
+{
+   std::lock_guard<std::mutex> lock( drainer );
+   size_t applied {0};
+   for(SymbolId id=0; id<queues.size(); ++id) { if( queues[id] ) { applied += drain( id ); } }
+   published.publish( exchange );
+   return applied;
+}
+
+jpmorgan::published_stock jpmorgan::ConcurrentExchange::row(std::string_view symbol) const
+{
+   published_stock result = published.at( getSymbolId( symbol ) );
+   if( !result.listed ) { throw stock_non_found(); }
+   return result;
+}
+
+double jpmorgan::ConcurrentExchange::stockPrice(std::string_view symbol) const { return row( symbol ).stock_price; }
+double jpmorgan::ConcurrentExchange::getPrice(std::string_view symbol) const { return row( symbol ).price; }
+double jpmorgan::ConcurrentExchange::dividendYield(std::string_view symbol) const { return row( symbol ).dividend_yield; }
+double jpmorgan::ConcurrentExchange::p_e_ratio(std::string_view symbol) const { return row( symbol ).p_e_ratio; }
+double jpmorgan::ConcurrentExchange::allShareIndex() const { return published.allShareIndex(); }
+std::uint64_t jpmorgan::ConcurrentExchange::getVersion() const { return published.getVersion(); }
+
+// not published: read from the exchange itself, as of the last drain as well
+size_t jpmorgan::ConcurrentExchange::getTradeSize(std::string_view symbol)
+{
+   SymbolId id = getSymbolId( symbol );
+   std::lock_guard<std::mutex> lock( drainer );
+   return exchange.at( id ).getTradeSize();
+}
+
+#endif // CONCURRENTGBCE_HPP
@@ -23,4 +23,49 @@ class stock_non_found : public std::exception
   virtual const char* what() const noexcept override { return "Stock Non Found"; }
 };
 
+class journal_io_error : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Journal I/O Error"; }
+};
+
+class unexpected_journal_format : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Unexpected Journal Format"; }
+};
+
+class feed_io_error : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Feed I/O Error"; }
+};
+
+class unexpected_feed_format : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Unexpected Feed Format"; }
+};
+
+class snapshot_io_error : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Snapshot I/O Error"; }
+};
+
+class unexpected_snapshot_format : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Unexpected Snapshot Format"; }
+};
+
+class backtest_io_error : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Backtest I/O Error"; }
+};
+
+class publish_capacity_exceeded : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Publish Capacity Exceeded"; }
+};
+
+class unexpected_option : public std::exception
+{
+  virtual const char* what() const noexcept override { return "Unexpected Option"; }
+};
+
 #endif // EXCEPTIONS_HPP
@@ -0,0 +1,59 @@
+#ifndef FEED_HPP
+#define FEED_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace jpmorgan {
+
+// Deterministic synthetic market data for benchmarks & simulations: the same seed always gives
+// the same prices, quantities and sides, so runs can be compared against each other.
+// Based on splitmix64, much cheaper than std::function wrapped <random> distributions.
+
+/**** PROPER INTERFACE *****/
+
+class SyntheticFeed
+{
+public:
+  inline explicit SyntheticFeed(std::uint64_t seed = 0x5eed);
+
+  inline std::uint64_t next(); // raw 64 bits
+  inline double uniform(); // [0, 1)
+  inline double price(double low = 0.0, double high = 200.0);
+  inline unsigned long quantity(unsigned long low = 1, unsigned long high = 1000);
+  inline bool indicator(); // buy->false or sell->true
+  inline size_t index(size_t n); // [0, n), i.e. which stock
+
+private:
+  std::uint64_t state {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::SyntheticFeed::SyntheticFeed(std::uint64_t seed) : state{seed} {}
+
+std::uint64_t jpmorgan::SyntheticFeed::next()
+{
+   std::uint64_t z = ( state += 0x9e3779b97f4a7c15ULL );
+   z = ( z ^ (z >> 30) ) * 0xbf58476d1ce4e5b9ULL;
+   z = ( z ^ (z >> 27) ) * 0x94d049bb133111ebULL;
+   return z ^ (z >> 31);
+}
+
+// 53 random bits as mantissa
+double jpmorgan::SyntheticFeed::uniform() { return ( next() >> 11 ) * ( 1.0 / 9007199254740992.0 ); }
+
+double jpmorgan::SyntheticFeed::price(double low, double high) { return low + ( high - low ) * uniform(); }
+
+unsigned long jpmorgan::SyntheticFeed::quantity(unsigned long low, unsigned long high)
+{
+   return low + static_cast<unsigned long>( next() % ( high - low + 1 ) );
+}
+
+bool jpmorgan::SyntheticFeed::indicator() { return ( next() & 1 ); }
+
+size_t jpmorgan::SyntheticFeed::index(size_t n) { return static_cast<size_t>( next() % n ); }
+
+#endif // FEED_HPP
@@ -0,0 +1,431 @@
+#ifndef FEEDHANDLER_HPP
+#define FEEDHANDLER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Symbols.hpp"
+#include "Span.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Compact binary market data: a 16 bytes file header and then messages back to back, each one a
+// type byte and its fields, little endian and unaligned. Stocks are listed by the feed itself with
+// feed ids of its own, so the same file can be fed to exchanges that already have other stocks.
+//
+//   stock 'S': u32 feed id, f64 last dividend, f64 par value, f64 fixed dividend, u8 length, symbol   30 + length bytes
+//   price 'P': u32 feed id, i64 nanoseconds since epoch, f64 price                                    21 bytes
+//   trade 'T': u32 feed id, i64 nanoseconds since epoch, u32 quantity, u8 indicator (sell->1)         18 bytes
+
+// Decoding reads fields straight out of the buffer (or the mapped file) and calls the handler, a
+// template parameter instead of virtual callbacks: no std::string, no message object, no indirection.
+
+/**** PROPER INTERFACE *****/
+
+struct feed_header {
+   char magic[8] {};
+   std::uint32_t version {0};
+   std::uint32_t reserved {0};
+};
+
+static_assert( sizeof(feed_header) == 16, "feed headers are written as they are in memory" );
+
+static constexpr char feed_magic[8] = { 'G', 'B', 'C', 'E', 'F', 'E', 'E', 'D' };
+static constexpr std::uint32_t feed_version = 1;
+
+struct feed_message {
+   enum kind_type : char { stock = 'S', price = 'P', trade = 'T' };
+
+   static constexpr size_t stock_size = 30; // plus the symbol
+   static constexpr size_t price_size = 21;
+   static constexpr size_t trade_size = 18;
+};
+
+// Handler has to provide:
+//   onStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+//   onPrice(std::uint32_t feed_id, const timestamp& time, double price)
+//   onTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator)
+// whole messages only, the bytes consumed are returned so that a partial one can be completed by the next buffer;
+// throws unexpected_feed_format on unknown message types
+template<typename Handler>
+inline size_t decodeFeed(const char* data, size_t length, Handler& handler);
+
+// messages appended to a buffer in memory, i.e. to build test or benchmark feeds; symbols longer than
+// 255 characters or quantities beyond 32 bits throw unexpected_feed_format, nothing is appended then
+class FeedEncoder
+{
+public:
+  inline void addStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend = 0.0);
+  inline void setPrice(std::uint32_t feed_id, const timestamp& time, double price);
+  inline void addTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator);
+
+  inline const char* data() const;
+  inline size_t size() const;
+  inline void clear();
+
+private:
+  template<typename T>
+  inline void put(const T& value);
+
+  std::vector<char> bytes {};
+};
+
+// messages written to a feed file, buffered and handed to the kernel 64KB at a time
+class FeedRecorder
+{
+public:
+  inline explicit FeedRecorder(const std::string& path); // truncates an existing file
+  inline ~FeedRecorder();
+
+  FeedRecorder(const FeedRecorder&) =delete;
+  FeedRecorder& operator=(const FeedRecorder&) =delete;
+
+  inline void addStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend = 0.0);
+  inline void setPrice(std::uint32_t feed_id, const timestamp& time, double price);
+  inline void addTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator);
+  inline void flush();
+
+private:
+  static constexpr size_t buffer_size = 65536;
+
+  inline void write(const char* data, size_t length);
+  inline void flushIfFull();
+
+  int file {-1};
+  FeedEncoder buffer {};
+};
+
+// read-only mapping of a feed file
+class FeedReader
+{
+public:
+  inline explicit FeedReader(const std::string& path);
+  inline ~FeedReader();
+
+  FeedReader(const FeedReader&) =delete;
+  FeedReader& operator=(const FeedReader&) =delete;
+
+  inline span<const char> messages() const; // after the header
+
+private:
+  int file {-1};
+  char* base {nullptr};
+  size_t length {0};
+};
+
+// feed straight into an exchange: feed ids are mapped to SymbolIds as stocks are listed and runs of
+// trades sharing a timestamp go in as one 'addTrades' batch; a price, a stock or another timestamp
+// closes the batch first, so trades always get the price in force when they were sent
+
+// Feed ids come straight from the input and index a table, so they are capped: a stock message with
+// a feed id at or above 'max_feed_ids' throws unexpected_feed_format instead of growing the table.
+
+// When 'apply' throws, messages before the faulty one are already in the exchange (trades of the
+// last batch once 'flush' is called) but the count of bytes consumed is lost with the exception:
+// the buffer can't be resumed past the faulty message, 'getMessages' tells how many went in.
+class GBCEFeedHandler
+{
+public:
+  static constexpr size_t default_max_feed_ids = 1 << 20;
+
+  inline explicit GBCEFeedHandler(GlobalBeverageCorporationExchange& gbce, size_t max_feed_ids = default_max_feed_ids);
+
+  inline size_t apply(const char* data, size_t length); // bytes consumed, see 'decodeFeed'; throws unexpected_feed_format & stock_non_found
+  inline size_t apply(span<const char> data);
+  inline void flush(); // pending trades into the exchange, done by 'apply' before returning
+
+  inline size_t getMessages() const;
+
+  // handler
+  inline void onStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend);
+  inline void onPrice(std::uint32_t feed_id, const timestamp& time, double price);
+  inline void onTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator);
+
+private:
+  static constexpr SymbolId unknown = ~SymbolId{0};
+
+  inline SymbolId symbolId(std::uint32_t feed_id) const; // throws stock_non_found
+
+  GlobalBeverageCorporationExchange& exchange;
+  std::vector<SymbolId> ids {}; // by feed id
+  size_t max_ids {default_max_feed_ids};
+  std::vector<trade_event> batch {};
+  timestamp batch_time {};
+  size_t messages {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+namespace jpmorgan {
+namespace feed {
+
+template<typename T>
+inline T load(const char* p)
+{
+   T value;
+   std::memcpy( &value, p, sizeof(T) );
+   return value;
+}
+
+inline timestamp loadTime(const char* p)
+{
+   return timestamp{ std::chrono::duration_cast<timestamp::duration>( std::chrono::nanoseconds( load<std::int64_t>( p ) ) ) };
+}
+
+inline std::int64_t nanoseconds(const timestamp& time)
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>( time.time_since_epoch() ).count();
+}
+
+} // namespace feed
+} // namespace jpmorgan
+
+template<typename Handler>
+size_t jpmorgan::decodeFeed(const char* data, size_t length, Handler& handler)
+{
+   size_t offset {0};
+   while( offset < length )
+   {
+      const char* p = data + offset;
+      size_t left = length - offset;
+
+      switch( *p )
+      {
+        case feed_message::trade:
+          if( left < feed_message::trade_size ) { return offset; }
+          handler.onTrade( feed::load<std::uint32_t>( p + 1 ), feed::loadTime( p + 5 ), feed::load<std::uint32_t>( p + 13 ), 0 != p[17] );
+          offset += feed_message::trade_size;
+          break;
+
+        case feed_message::price:
+          if( left < feed_message::price_size ) { return offset; }
+          handler.onPrice( feed::load<std::uint32_t>( p + 1 ), feed::loadTime( p + 5 ), feed::load<double>( p + 13 ) );
+          offset += feed_message::price_size;
+          break;
+
+        case feed_message::stock:
+        {
+          if( left < feed_message::stock_size ) { return offset; }
+          size_t symbol_length = static_cast<unsigned char>( p[29] );
+          if( left < feed_message::stock_size + symbol_length ) { return offset; }
+          handler.onStock( feed::load<std::uint32_t>( p + 1 ), std::string_view{ p + feed_message::stock_size, symbol_length },
+                           feed::load<double>( p + 5 ), feed::load<double>( p + 13 ), feed::load<double>( p + 21 ) );
+          offset += feed_message::stock_size + symbol_length;
+          break;
+        }
+
+        default:
+          throw unexpected_feed_format();
+      }
+   }
+   return offset;
+}
+
+template<typename T>
+void jpmorgan::FeedEncoder::put(const T& value)
+{
+   size_t at = bytes.size();
+   bytes.resize( at + sizeof(T) );
+   std::memcpy( bytes.data() + at, &value, sizeof(T) );
+}
+
+void jpmorgan::FeedEncoder::addStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+{
+   if( symbol.empty() ) { throw unexpected_empty_string(); }
+   if( symbol.size() > 255 ) { throw unexpected_feed_format(); }
+
+   put( static_cast<char>( feed_message::stock ) );
+   put( feed_id );
+   put( last_dividend );
+   put( par_value );
+   put( fixed_dividend );
+   put( static_cast<std::uint8_t>( symbol.size() ) );
+   bytes.insert( bytes.end(), symbol.begin(), symbol.end() );
+}
+
+void jpmorgan::FeedEncoder::setPrice(std::uint32_t feed_id, const timestamp& time, double price)
+{
+   put( static_cast<char>( feed_message::price ) );
+   put( feed_id );
+   put( feed::nanoseconds( time ) );
+   put( price );
+}
+
+void jpmorgan::FeedEncoder::addTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator)
+{
+   if( quantity > std::numeric_limits<std::uint32_t>::max() ) { throw unexpected_feed_format(); }
+
+   put( static_cast<char>( feed_message::trade ) );
+   put( feed_id );
+   put( feed::nanoseconds( time ) );
+   put( static_cast<std::uint32_t>( quantity ) );
+   put( static_cast<std::uint8_t>( indicator ) );
+}
+
+const char* jpmorgan::FeedEncoder::data() const { return bytes.data(); }
+size_t jpmorgan::FeedEncoder::size() const { return bytes.size(); }
+void jpmorgan::FeedEncoder::clear() { bytes.clear(); }
+
+jpmorgan::FeedRecorder::FeedRecorder(const std::string& path)
+{
+   file = ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+   if( 0 > file ) { throw feed_io_error(); }
+
+   feed_header header {};
+   std::memcpy( header.magic, feed_magic, sizeof(feed_magic) );
+   header.version = feed_version;
+   try {
+      write( reinterpret_cast<const char*>( &header ), sizeof(feed_header) );
+   } catch( ... ) {
+      ::close( file );
+      throw;
+   }
+}
+
+jpmorgan::FeedRecorder::~FeedRecorder()
+{
+   try { flush(); } catch( ... ) { /* nothing to do in a dtor */ }
+   ::close( file );
+}
+
+void jpmorgan::FeedRecorder::write(const char* data, size_t length)
+{
+   while( 0 < length )
+   {
+      ssize_t written = ::write( file, data, length );
+      if( 0 > written ) { throw feed_io_error(); }
+      data += written;
+      length -= static_cast<size_t>( written );
+   }
+}
+
+void jpmorgan::FeedRecorder::flushIfFull() { if( buffer.size() >= buffer_size ) { flush(); } }
+
+void jpmorgan::FeedRecorder::flush()
+{
+   write( buffer.data(), buffer.size() );
+   buffer.clear();
+}
+
+void jpmorgan::FeedRecorder::addStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+{
+   buffer.addStock( feed_id, symbol, last_dividend, par_value, fixed_dividend );
+   flushIfFull();
+}
+
+void jpmorgan::FeedRecorder::setPrice(std::uint32_t feed_id, const timestamp& time, double price)
+{
+   buffer.setPrice( feed_id, time, price );
+   flushIfFull();
+}
+
+void jpmorgan::FeedRecorder::addTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator)
+{
+   buffer.addTrade( feed_id, time, quantity, indicator );
+   flushIfFull();
+}
+
+jpmorgan::FeedReader::FeedReader(const std::string& path)
+{
+   file = ::open( path.c_str(), O_RDONLY );
+   if( 0 > file ) { throw feed_io_error(); }
+
+   struct stat status {};
+   if( 0 != ::fstat( file, &status ) ) { ::close( file ); throw feed_io_error(); }
+   length = static_cast<size_t>( status.st_size );
+   if( length < sizeof(feed_header) ) { ::close( file ); throw unexpected_feed_format(); }
+
+   void* address = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, file, 0 );
+   if( MAP_FAILED == address ) { ::close( file ); throw feed_io_error(); }
+   base = static_cast<char*>( address );
+
+   feed_header header {};
+   std::memcpy( &header, base, sizeof(feed_header) );
+   if( 0 != std::memcmp( header.magic, feed_magic, sizeof(feed_magic) ) || feed_version != header.version )
+   {
+      ::munmap( base, length );
+      ::close( file );
+      throw unexpected_feed_format();
+   }
+
+   ::madvise( base, length, MADV_SEQUENTIAL );
+}
+
+jpmorgan::FeedReader::~FeedReader()
+{
+   ::munmap( base, length );
+   ::close( file );
+}
+
+jpmorgan::span<const char> jpmorgan::FeedReader::messages() const
+{
+   return span<const char>{ base + sizeof(feed_header), length - sizeof(feed_header) };
+}
+
+jpmorgan::GBCEFeedHandler::GBCEFeedHandler(GlobalBeverageCorporationExchange& gbce, size_t max_feed_ids) : exchange{gbce}, max_ids{max_feed_ids} {}
+
+size_t jpmorgan::GBCEFeedHandler::apply(const char* data, size_t length)
+{
+   size_t consumed = decodeFeed( data, length, *this );
+   flush();
+   return consumed;
+}
+size_t jpmorgan::GBCEFeedHandler::apply(span<const char> data) { return apply( data.data(), data.size() ); }
+
+void jpmorgan::GBCEFeedHandler::flush()
+{
+   if( batch.empty() ) { return; }
+   exchange.addTrades( batch_time, batch );
+   batch.clear();
+}
+
+size_t jpmorgan::GBCEFeedHandler::getMessages() const { return messages; }
+
+jpmorgan::SymbolId jpmorgan::GBCEFeedHandler::symbolId(std::uint32_t feed_id) const
+{
+   if( feed_id >= ids.size() || unknown == ids[feed_id] ) { throw stock_non_found(); }
+   return ids[feed_id];
+}
+
+void jpmorgan::GBCEFeedHandler::onStock(std::uint32_t feed_id, std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+{
+   flush();
+   if( feed_id >= max_ids ) { throw unexpected_feed_format(); }
+   if( feed_id >= ids.size() ) { ids.resize( feed_id + 1, unknown ); }
+   ids[feed_id] = exchange.addStock( symbol, last_dividend, par_value, fixed_dividend );
+   ++messages;
+}
+
+// the exchange has no time for prices, only the order matters
+void jpmorgan::GBCEFeedHandler::onPrice(std::uint32_t feed_id, const timestamp& /*time*/, double price)
+{
+   flush();
+   exchange.setPrice( symbolId( feed_id ), price );
+   ++messages;
+}
+
+void jpmorgan::GBCEFeedHandler::onTrade(std::uint32_t feed_id, const timestamp& time, unsigned long quantity, bool indicator)
+{
+   if( !batch.empty() && time != batch_time ) { flush(); }
+   batch_time = time;
+   batch.push_back( trade_event{ symbolId( feed_id ), quantity, indicator } );
+   ++messages;
+}
+
+#endif // FEEDHANDLER_HPP
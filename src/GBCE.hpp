@@ -2,13 +2,25 @@
 #define GBCE_HPP
 
 #include <iostream>
-#include <map>
+#include <vector>
 #include <chrono>
 #include <string>
+#include <string_view>
 #include <exception>
 #include <cmath>
+#include <iterator>
+#include <utility>
+#include <algorithm>
 
 #include "Exceptions.hpp"
+#include "Symbols.hpp"
+#include "Clock.hpp"
+#include "Metrics.hpp"
+#include "Span.hpp"
+#include "Journal.hpp"
+#include "Wheel.hpp"
+#include "ShareIndex.hpp"
+#include "Kinds.hpp"
 #include "Trade.hpp"
 #include "Stock.hpp"
 
@@ -16,148 +28,478 @@
 
 namespace jpmorgan {
 
-class GlobalBeverageCorporationExchange : public std::map<std::string, Stock>
+// Stocks live in a flat vector indexed by their SymbolId, handed out by 'addStock'. Every method
+// comes in two flavours: by id, just an array index, and by name, a lookup on the symbol table.
+
+// Removed stocks leave a hole so that ids already handed out never point to a different stock.
+// Stocks are only modified through the exchange, that way the All Share Index follows every price.
+
+// yields & P/E ratios of every listed stock, Common ones first; kept by the caller so that its memory is reused
+struct ratio_columns {
+   std::vector<SymbolId> ids {};
+   std::vector<double> dividend_yields {};
+   std::vector<double> p_e_ratios {};
+
+   size_t size() const { return ids.size(); }
+};
+
+// one trade out of a feed packet, traded at the stock's current price
+struct trade_event {
+   SymbolId id {0};
+   unsigned long quantity {0};
+   bool indicator {false}; // buy->false or sell->true
+};
+
+class GlobalBeverageCorporationExchange
 {
 public:
-   inline void addStock(std::string symbol, double last_dividend, double par_value, double fixed_dividend = 0.0); 
-   inline void setPrice(std::string symbol, double price);
-   inline double getPrice(std::string symbol) const;
- 
-   inline void addTrade(std::string symbol, unsigned long quantity, bool indicator);
-   inline double stockPriceAndClear(std::string symbol); 
-   inline double stockPrice(std::string symbol); 
+   class const_iterator;
+
+   inline SymbolId addStock(std::string_view symbol, double last_dividend, double par_value, double fixed_dividend = 0.0);
+   inline void removeStock(std::string_view symbol);
+   inline void removeStock(SymbolId id);
+   inline SymbolId getSymbolId(std::string_view symbol) const; // throws stock_non_found
+   inline const std::string& getSymbol(SymbolId id) const;
+
+   inline void setPrice(std::string_view symbol, double price);
+   inline void setPrice(SymbolId id, double price);
+   inline double getPrice(std::string_view symbol) const;
+   inline double getPrice(SymbolId id) const;
 
-   inline double dividendYield(std::string symbol) const; 
-   inline double p_e_ratio(std::string symbol) const;  
+   inline void addTrade(std::string_view symbol, unsigned long quantity, bool indicator);
+   inline void addTrade(SymbolId id, unsigned long quantity, bool indicator);
+   inline void addTrade(std::string_view symbol, const timestamp& time, unsigned long quantity, bool indicator); // i.e. exchange timestamps
+   inline void addTrade(SymbolId id, const timestamp& time, unsigned long quantity, bool indicator);
+   inline void addTrades(span<const trade_event> events); // a whole packet: one clock read, one append per stock
+   inline void addTrades(const timestamp& time, span<const trade_event> events); // throws stock_non_found before adding anything
+   inline double stockPriceAndClear(std::string_view symbol);
+   inline double stockPriceAndClear(SymbolId id);
+   inline double stockPrice(std::string_view symbol);
+   inline double stockPrice(SymbolId id);
 
-   inline void clearOldTrades(); // all stocks
+   inline double dividendYield(std::string_view symbol) const;
+   inline double dividendYield(SymbolId id) const;
+   inline double p_e_ratio(std::string_view symbol) const;
+   inline double p_e_ratio(SymbolId id) const;
+   inline void ratios(ratio_columns& out) const; // every stock in one call, no branch on its kind
+   inline const CommonColumns& getCommons() const;
+   inline const PreferredColumns& getPreferreds() const;
+
+   inline const Stock& at(std::string_view symbol) const;
+   inline const Stock& at(SymbolId id) const;
+   inline const Stock& operator[](SymbolId id) const; // unchecked, for ids known to be listed
+
+   // every price and trade is appended to the journal, if any; it must outlive the exchange
+   inline void setJournal( TradeJournal* new_journal );
+   // back to the state recorded, stocks listed in the same order; trades older than 'since' are skipped
+   inline void replay( span<const journal_record> records, const timestamp& since = timestamp{} );
+
+   inline void setBorder( std::chrono::milliseconds new_border ); // all stocks, even the ones to come
+   inline Trade::window_id addWindow( std::chrono::milliseconds border ); // all stocks, even the ones to come
+   inline size_t getWindowCount() const;
+   inline std::chrono::milliseconds getBorder( Trade::window_id w = 0 ) const;
+   inline window_stats windowStats(std::string_view symbol, Trade::window_id w) const;
+   inline window_stats windowStats(SymbolId id, Trade::window_id w) const;
+
+   // OHLCV bars on every stock, even the ones to come
+   inline Stock::bars_id addBars( std::chrono::milliseconds interval, size_t capacity = 1024 );
+   inline void closeBars(); // every bar before the current interval is finished, trades or not
+   inline const BarBuilder& getBars(SymbolId id, Stock::bars_id b) const;
+   inline double allShareIndex(Stock::bars_id b, const timestamp& bar_start) const; // on closing prices of that bar
+   inline void setClock( const Clock& new_clock ); // all stocks, even the ones to come; it must outlive the exchange
+   inline const Clock& getClock() const;
+   inline void setPool( BlockPool* new_pool ); // trade storage of all stocks, even the ones to come; it must outlive the exchange
+   inline void clearOldTrades(); // only stocks with trades out of the border, see ExpiryWheel
 
    // no thread-safe at all
-   inline double allShareIndex(); // no const because it uses static variables to speed up
+   inline double allShareIndex() const;
+   inline const ShareIndex& getShareIndex() const;
+
+   inline size_t size() const; // listed stocks
+   inline bool empty() const;
+   inline size_t getSlotCount() const; // listed & removed, ids go from 0 up to this
+   inline bool isListed(SymbolId id) const;
+   inline const_iterator begin() const;
+   inline const_iterator end() const;
 
    inline friend std::ostream &operator<<(std::ostream &stream, const jpmorgan::GlobalBeverageCorporationExchange& stock);
-}; 
+
+private:
+   inline Stock& stock(SymbolId id);
+   inline void resetWheel(); // i.e. when borders change
+
+   SymbolTable symbols {};
+   std::vector<Stock> stocks {}; // by SymbolId
+   std::vector<unsigned char> listed {}; // by SymbolId, false once removed
+   size_t listed_size {0};
+   ShareIndex index {};
+
+   // prices & dividends again, split by kind so that bulk ratios never branch on it
+   struct kind_row {
+      bool preferred {false};
+      size_t row {0};
+   };
+   inline void setKindPrice(SymbolId id, double price);
+
+   CommonColumns commons {};
+   PreferredColumns preferreds {};
+   std::vector<kind_row> kind_rows {}; // by SymbolId
+   const Clock* clock { &Clock::systemClock() };
+   TradeJournal* journal {nullptr};
+   BlockPool* pool {nullptr};
+   ExpiryWheel wheel {};
+   std::vector<std::chrono::milliseconds> borders { _15min }; // by window id
+   std::vector<std::pair<std::chrono::milliseconds, size_t>> bar_settings {}; // by bars id
+
+   // scratch space for 'addTrades', kept around so that batches don't allocate once warmed up
+   std::vector<std::pair<SymbolId, unsigned int>> batch_order {}; // (id, position in the batch)
+   std::vector<trade_data> batch_trades {};
+};
+
+// only listed stocks
+class GlobalBeverageCorporationExchange::const_iterator
+{
+public:
+   using iterator_category = std::forward_iterator_tag;
+   using value_type = Stock;
+   using difference_type = std::ptrdiff_t;
+   using pointer = const Stock*;
+   using reference = const Stock&;
+
+   const_iterator(const GlobalBeverageCorporationExchange* g, SymbolId i) : gbce{g}, id{i} { skip(); }
+
+   reference operator*() const { return gbce->stocks[id]; }
+   pointer operator->() const { return &gbce->stocks[id]; }
+   const_iterator& operator++() { ++id; skip(); return *this; }
+   const_iterator operator++(int) { const_iterator it = *this; ++(*this); return it; }
+   bool operator==(const const_iterator& it) const { return id == it.id; }
+   bool operator!=(const const_iterator& it) const { return id != it.id; }
+
+   SymbolId getSymbolId() const { return id; }
+
+private:
+   void skip() { while( id < gbce->listed.size() && !gbce->listed[id] ) { ++id; } }
+
+   const GlobalBeverageCorporationExchange* gbce {nullptr};
+   SymbolId id {0};
+};
 
 // for debugging
 std::ostream &operator<<(std::ostream &stream, const jpmorgan::GlobalBeverageCorporationExchange& gbce)
 {
-  for(auto element : gbce) { stream << element.second; }
+  for(const auto& stock : gbce) { stream << stock; }
   return stream;
 }
- 
+
 } // namespace jpmorgan
 
 /****** INLINE FUNCTION DEFINITIONS *********/
 
+// cost depends on the stocks with expired trades, not on the listed ones nor on the live trades
 void jpmorgan::GlobalBeverageCorporationExchange::clearOldTrades()
 {
-   for(auto element : *this) { element.second.clearOldTrades(); } 
+   JPMORGAN_METRICS_TIME( clear_old_trades );
+   timestamp right_now = clock->now();
+   wheel.advance( right_now, [&](SymbolId id) { if( listed[id] ) { stocks[id].clearOldTrades( right_now ); } } );
 }
 
-void jpmorgan::GlobalBeverageCorporationExchange::addStock(std::string symbol, double last_dividend, double par_value, double fixed_dividend)
+void jpmorgan::GlobalBeverageCorporationExchange::setJournal( TradeJournal* new_journal ) { journal = new_journal; }
+
+// straight to the stocks, nothing is journaled again; removed stocks just ignore their records
+void jpmorgan::GlobalBeverageCorporationExchange::replay( span<const journal_record> records, const timestamp& since )
 {
-   emplace(symbol, jpmorgan::Stock { symbol, last_dividend, par_value, fixed_dividend } );
+   // a first pass to check every id and size every ring once, for the trades it will really hold
+   std::vector<size_t> trades( stocks.size(), 0 );
+   for(const auto& record : records)
+   {
+      if( record.id >= stocks.size() ) { throw stock_non_found(); }
+      if( journal_record::trade == record.kind && record.getTimestamp() >= since ) { ++trades[record.id]; }
+   }
+   for(SymbolId id=0; id<stocks.size(); ++id) { if( listed[id] ) { stocks[id].reserve( stocks[id].getTradeSize() + trades[id] ); } }
+
+   for(const auto& record : records)
+   {
+      if( !listed[record.id] ) { continue; }
+
+      Stock& replayed = stocks[record.id];
+      if( journal_record::price == record.kind )
+      {
+         double old_price = replayed.getPrice();
+         replayed.setPrice( record.value );
+         index.update( old_price, record.value );
+         setKindPrice( record.id, record.value );
+      }
+      else
+      {
+         timestamp time = record.getTimestamp();
+         if( time >= since ) {
+            replayed.addTrade( time, static_cast<unsigned long>( record.quantity ), 0 != record.indicator, record.value );
+            wheel.insert( record.id, time );
+         }
+      }
+   }
 }
- 
-// at least can throw when the symbol is not found or when price is negative
-void jpmorgan::GlobalBeverageCorporationExchange::setPrice(std::string symbol, double price)
+
+void jpmorgan::GlobalBeverageCorporationExchange::setBorder( std::chrono::milliseconds new_border )
 {
-  try {
-     at(symbol).setPrice(price);
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   borders[0] = new_border;
+   for(auto& stock : stocks) { stock.setBorder( new_border ); }
+   resetWheel();
 }
-double jpmorgan::GlobalBeverageCorporationExchange::getPrice(std::string symbol) const
+
+jpmorgan::Trade::window_id jpmorgan::GlobalBeverageCorporationExchange::addWindow( std::chrono::milliseconds border )
 {
-  try {
-     return at(symbol).getPrice();
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   borders.push_back( border );
+   for(auto& stock : stocks) { stock.addWindow( border ); }
+   resetWheel();
+   return borders.size() - 1;
 }
-   
-void jpmorgan::GlobalBeverageCorporationExchange::addTrade(std::string symbol, unsigned long quantity, bool indicator)
+
+size_t jpmorgan::GlobalBeverageCorporationExchange::getWindowCount() const { return borders.size(); }
+std::chrono::milliseconds jpmorgan::GlobalBeverageCorporationExchange::getBorder( Trade::window_id w ) const { return borders.at( w ); }
+
+// the wheel follows the widest window; slots are rebuilt from scratch, so whatever
+// is stored now expires at the latest one border from now
+void jpmorgan::GlobalBeverageCorporationExchange::resetWheel()
 {
-  try {
-     at(symbol).addTrade(quantity, indicator);
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   wheel.reset( *std::max_element( borders.begin(), borders.end() ) );
+   timestamp right_now = clock->now();
+   for(SymbolId id=0; id<stocks.size(); ++id) { if( listed[id] && 0 < stocks[id].getTradeSize() ) { wheel.insert( id, right_now ); } }
 }
 
-double jpmorgan::GlobalBeverageCorporationExchange::stockPriceAndClear(std::string symbol) 
+jpmorgan::Stock::bars_id jpmorgan::GlobalBeverageCorporationExchange::addBars( std::chrono::milliseconds interval, size_t capacity )
 {
-  try {
-     return at(symbol).stockPriceAndClear();
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   bar_settings.emplace_back( interval, capacity );
+   for(auto& stock : stocks) { stock.addBars( interval, capacity ); }
+   return bar_settings.size() - 1;
 }
 
-double jpmorgan::GlobalBeverageCorporationExchange::stockPrice(std::string symbol) 
+void jpmorgan::GlobalBeverageCorporationExchange::closeBars()
 {
-  try {
-     return at(symbol).stockPrice();
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   timestamp right_now = clock->now();
+   for(SymbolId id=0; id<stocks.size(); ++id) { if( listed[id] ) { stocks[id].closeBars( right_now ); } }
 }
 
-double jpmorgan::GlobalBeverageCorporationExchange::dividendYield(std::string symbol) const
+const jpmorgan::BarBuilder& jpmorgan::GlobalBeverageCorporationExchange::getBars(SymbolId id, Stock::bars_id b) const { return at(id).getBars( b ); }
+
+// bars line up on the same starts for every stock; stocks without that bar (i.e. no trade yet) are left out
+double jpmorgan::GlobalBeverageCorporationExchange::allShareIndex(Stock::bars_id b, const timestamp& bar_start) const
 {
-  try {
-     return at(symbol).dividendYield();
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
-     throw stock_non_found();
-  }
+   ShareIndex closes {};
+   for(SymbolId id=0; id<stocks.size(); ++id)
+   {
+      if( !listed[id] ) { continue; }
+      const bar* found = stocks[id].getBars( b ).find( bar_start );
+      if( nullptr != found ) { closes.add( found->close ); }
+   }
+   return closes.value();
+}
+
+jpmorgan::window_stats jpmorgan::GlobalBeverageCorporationExchange::windowStats(SymbolId id, Trade::window_id w) const { return at(id).windowStats( w ); }
+jpmorgan::window_stats jpmorgan::GlobalBeverageCorporationExchange::windowStats(std::string_view symbol, Trade::window_id w) const { return windowStats( getSymbolId(symbol), w ); }
+
+void jpmorgan::GlobalBeverageCorporationExchange::setClock( const Clock& new_clock )
+{
+   clock = &new_clock;
+   for(auto& stock : stocks) { stock.setClock( new_clock ); }
+}
+const jpmorgan::Clock& jpmorgan::GlobalBeverageCorporationExchange::getClock() const { return *clock; }
+
+void jpmorgan::GlobalBeverageCorporationExchange::setPool( BlockPool* new_pool )
+{
+   pool = new_pool;
+   for(auto& stock : stocks) { stock.setPool( new_pool ); }
+}
+
+// already listed stocks keep their data
+jpmorgan::SymbolId jpmorgan::GlobalBeverageCorporationExchange::addStock(std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+{
+   SymbolId id {};
+   if( symbols.find( symbol, id ) ) { return id; }
+
+   stocks.emplace_back( std::string{symbol}, last_dividend, par_value, fixed_dividend );
+   stocks.back().setClock( *clock );
+   stocks.back().setPool( pool );
+   stocks.back().setBorder( borders[0] );
+   for(size_t w=1; w<borders.size(); ++w) { stocks.back().addWindow( borders[w] ); }
+   for(const auto& setting : bar_settings) { stocks.back().addBars( setting.first, setting.second ); }
+   listed.push_back( true );
+   ++listed_size;
+   index.add( stocks.back().getPrice() );
+
+   const Stock& added = stocks.back();
+   if( added.isPreferred() ) {
+      kind_rows.push_back( kind_row{ true, preferreds.add( static_cast<SymbolId>( stocks.size() - 1 ), added.getPrice(), last_dividend, par_value, fixed_dividend ) } );
+   } else {
+      kind_rows.push_back( kind_row{ false, commons.add( static_cast<SymbolId>( stocks.size() - 1 ), added.getPrice(), last_dividend, par_value, fixed_dividend ) } );
+   }
+   return symbols.intern( symbol );
 }
-double jpmorgan::GlobalBeverageCorporationExchange::p_e_ratio(std::string symbol) const
+
+// its trades are released but the slot stays, ids are never reused
+void jpmorgan::GlobalBeverageCorporationExchange::removeStock(SymbolId id)
+{
+   Stock& removed = stock( id );
+   index.remove( removed.getPrice() );
+   symbols.erase( removed.getSymbol() );
+   removed.clear();
+
+   // the last stock of that kind takes its row
+   const kind_row gone = kind_rows[id];
+   if( gone.preferred ) {
+      SymbolId moved = preferreds.remove( gone.row );
+      if( gone.row < preferreds.size() ) { kind_rows[moved].row = gone.row; }
+   } else {
+      SymbolId moved = commons.remove( gone.row );
+      if( gone.row < commons.size() ) { kind_rows[moved].row = gone.row; }
+   }
+   listed[id] = false;
+   --listed_size;
+}
+void jpmorgan::GlobalBeverageCorporationExchange::removeStock(std::string_view symbol) { removeStock( getSymbolId(symbol) ); }
+
+jpmorgan::SymbolId jpmorgan::GlobalBeverageCorporationExchange::getSymbolId(std::string_view symbol) const
 {
-  try {
-     return at(symbol).p_e_ratio();
-  } catch (const std::out_of_range& oor) {
-     std::cerr << "Non found stock " << symbol << std::endl;
+  SymbolId id {};
+  if( !symbols.find( symbol, id ) ) {
+     JPMORGAN_METRICS_COUNT( symbols_non_found, 1 );
      throw stock_non_found();
   }
+  return id;
 }
 
-// supposed thant allShareIndex will be invoked more often than individual changes at stock prices
-// in order to spare pow(..., 1/n) calculation and reduce overflow issues the policy to be followed will be
-// trying to 'cache' values already calculated if possible
-//
-// no completely thread-safe
-double jpmorgan::GlobalBeverageCorporationExchange::allShareIndex()
+const std::string& jpmorgan::GlobalBeverageCorporationExchange::getSymbol(SymbolId id) const { return symbols.name( id ); }
+
+jpmorgan::Stock& jpmorgan::GlobalBeverageCorporationExchange::stock(SymbolId id)
+{
+  if( id >= stocks.size() || !listed[id] ) { throw stock_non_found(); }
+  return stocks[id];
+}
+const jpmorgan::Stock& jpmorgan::GlobalBeverageCorporationExchange::at(SymbolId id) const
 {
-   // AppleClang doesn't support Thread Local Storage 
-   static /*thread_local*/ double last_calculated_value {};
-   
-   double exponent = ( 1.0 / size() ); 
+  if( id >= stocks.size() || !listed[id] ) { throw stock_non_found(); }
+  return stocks[id];
+}
+const jpmorgan::Stock& jpmorgan::GlobalBeverageCorporationExchange::operator[](SymbolId id) const { return stocks[id]; }
+const jpmorgan::Stock& jpmorgan::GlobalBeverageCorporationExchange::at(std::string_view symbol) const { return at( getSymbolId(symbol) ); }
 
-   bool calculate = false;
-   for(auto& element : *this)
+// at least can throw when the symbol is not found or when price is negative
+void jpmorgan::GlobalBeverageCorporationExchange::setPrice(SymbolId id, double price)
+{
+  Stock& changed = stock(id);
+  double old_price = changed.getPrice();
+  changed.setPrice(price);
+  index.update(old_price, price);
+  setKindPrice(id, price);
+  if( nullptr != journal ) { journal->appendPrice( id, clock->now(), price ); }
+}
+void jpmorgan::GlobalBeverageCorporationExchange::setPrice(std::string_view symbol, double price) { setPrice( getSymbolId(symbol), price ); }
+
+double jpmorgan::GlobalBeverageCorporationExchange::getPrice(SymbolId id) const { return at(id).getPrice(); }
+double jpmorgan::GlobalBeverageCorporationExchange::getPrice(std::string_view symbol) const { return getPrice( getSymbolId(symbol) ); }
+
+void jpmorgan::GlobalBeverageCorporationExchange::addTrade(SymbolId id, unsigned long quantity, bool indicator) { addTrade( id, clock->now(), quantity, indicator ); }
+void jpmorgan::GlobalBeverageCorporationExchange::addTrade(std::string_view symbol, unsigned long quantity, bool indicator) { addTrade( getSymbolId(symbol), quantity, indicator ); }
+void jpmorgan::GlobalBeverageCorporationExchange::addTrade(SymbolId id, const timestamp& time, unsigned long quantity, bool indicator)
+{
+   Stock& traded = stock(id);
+   traded.addTrade(time, quantity, indicator);
+   wheel.insert(id, time);
+   if( nullptr != journal ) { journal->appendTrade( id, time, trade_data{ quantity, indicator, traded.getPrice() } ); }
+}
+void jpmorgan::GlobalBeverageCorporationExchange::addTrade(std::string_view symbol, const timestamp& time, unsigned long quantity, bool indicator) { addTrade( getSymbolId(symbol), time, quantity, indicator ); }
+
+void jpmorgan::GlobalBeverageCorporationExchange::addTrades(span<const trade_event> events)
+{
+   if( events.empty() ) { return; }
+   addTrades( clock->now(), events );
+}
+
+// events are grouped by stock keeping their order inside the batch, every stock gets just one bulk append
+void jpmorgan::GlobalBeverageCorporationExchange::addTrades(const timestamp& time, span<const trade_event> events)
+{
+   batch_order.clear();
+   for(size_t i=0; i<events.size(); ++i)
    {
-     // the order of this pedicate is important due to compiler optimization
-     calculate = ( element.second.hasChanged( exponent ) || calculate );
+      SymbolId id = events[i].id;
+      if( id >= stocks.size() || !listed[id] ) { throw stock_non_found(); }
+      batch_order.emplace_back( id, static_cast<unsigned int>(i) );
    }
 
-   if( calculate ) 
+   // packets already in stock order skip the sort
+   if( !std::is_sorted( batch_order.begin(), batch_order.end() ) ) { std::sort( batch_order.begin(), batch_order.end() ); }
+
+   for(size_t begin=0; begin<batch_order.size(); )
    {
-      double product {1.0};
-      for(const auto& element: *this)
+      SymbolId id = batch_order[begin].first;
+      Stock& current = stocks[id];
+      double price = current.getPrice();
+
+      batch_trades.clear();
+      size_t end = begin;
+      for(; end<batch_order.size() && batch_order[end].first == id; ++end)
       {
-         product = ( element.second.getPricePow() * product );
+         const trade_event& event = events[ batch_order[end].second ];
+         batch_trades.push_back( trade_data{ event.quantity, event.indicator, price } );
       }
-      last_calculated_value = product;
+
+      current.addTrades( time, batch_trades );
+      wheel.insert( id, time );
+      if( nullptr != journal ) { for(const auto& data : batch_trades) { journal->appendTrade( id, time, data ); } }
+      begin = end;
    }
+}
+
+double jpmorgan::GlobalBeverageCorporationExchange::stockPriceAndClear(SymbolId id) { return stock(id).stockPriceAndClear(); }
+double jpmorgan::GlobalBeverageCorporationExchange::stockPriceAndClear(std::string_view symbol) { return stockPriceAndClear( getSymbolId(symbol) ); }
 
-   return last_calculated_value; 
+double jpmorgan::GlobalBeverageCorporationExchange::stockPrice(SymbolId id) { return at(id).stockPrice(); }
+double jpmorgan::GlobalBeverageCorporationExchange::stockPrice(std::string_view symbol) { return stockPrice( getSymbolId(symbol) ); }
+
+double jpmorgan::GlobalBeverageCorporationExchange::dividendYield(SymbolId id) const { return at(id).dividendYield(); }
+double jpmorgan::GlobalBeverageCorporationExchange::dividendYield(std::string_view symbol) const { return dividendYield( getSymbolId(symbol) ); }
+
+double jpmorgan::GlobalBeverageCorporationExchange::p_e_ratio(SymbolId id) const { return at(id).p_e_ratio(); }
+double jpmorgan::GlobalBeverageCorporationExchange::p_e_ratio(std::string_view symbol) const { return p_e_ratio( getSymbolId(symbol) ); }
+
+void jpmorgan::GlobalBeverageCorporationExchange::setKindPrice(SymbolId id, double price)
+{
+   const kind_row& at_row = kind_rows[id];
+   if( at_row.preferred ) { preferreds.setPrice( at_row.row, price ); } else { commons.setPrice( at_row.row, price ); }
+}
+
+// straight from the columns of every kind, one vectorized division per column
+void jpmorgan::GlobalBeverageCorporationExchange::ratios(ratio_columns& out) const
+{
+   size_t n = commons.size() + preferreds.size();
+   out.ids.resize( n );
+   out.dividend_yields.resize( n );
+   out.p_e_ratios.resize( n );
+
+   std::copy( commons.ids().begin(), commons.ids().end(), out.ids.begin() );
+   std::copy( preferreds.ids().begin(), preferreds.ids().end(), out.ids.begin() + commons.size() );
+   commons.dividendYields( span<double>{ out.dividend_yields.data(), commons.size() } );
+   commons.p_e_ratios( span<double>{ out.p_e_ratios.data(), commons.size() } );
+   preferreds.dividendYields( span<double>{ out.dividend_yields.data() + commons.size(), preferreds.size() } );
+   preferreds.p_e_ratios( span<double>{ out.p_e_ratios.data() + commons.size(), preferreds.size() } );
+}
+
+const jpmorgan::CommonColumns& jpmorgan::GlobalBeverageCorporationExchange::getCommons() const { return commons; }
+const jpmorgan::PreferredColumns& jpmorgan::GlobalBeverageCorporationExchange::getPreferreds() const { return preferreds; }
+
+size_t jpmorgan::GlobalBeverageCorporationExchange::size() const { return listed_size; }
+bool jpmorgan::GlobalBeverageCorporationExchange::empty() const { return ( 0 == listed_size ); }
+size_t jpmorgan::GlobalBeverageCorporationExchange::getSlotCount() const { return stocks.size(); }
+bool jpmorgan::GlobalBeverageCorporationExchange::isListed(SymbolId id) const { return ( id < listed.size() && listed[id] ); }
+jpmorgan::GlobalBeverageCorporationExchange::const_iterator jpmorgan::GlobalBeverageCorporationExchange::begin() const { return const_iterator{ this, 0 }; }
+jpmorgan::GlobalBeverageCorporationExchange::const_iterator jpmorgan::GlobalBeverageCorporationExchange::end() const { return const_iterator{ this, static_cast<SymbolId>( stocks.size() ) }; }
+
+// every setPrice, addStock and removeStock already updated the index in O(1): nothing to scan here
+double jpmorgan::GlobalBeverageCorporationExchange::allShareIndex() const
+{
+   JPMORGAN_METRICS_TIME( all_share_index );
+   return index.value();
 }
+const jpmorgan::ShareIndex& jpmorgan::GlobalBeverageCorporationExchange::getShareIndex() const { return index; }
 
 #endif // GBCE_HPP
@@ -0,0 +1,302 @@
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Symbols.hpp"
+#include "Span.hpp"
+#include "TradeStore.hpp"
+
+namespace jpmorgan {
+
+// Append-only binary journal of everything that changes a stock: trades and prices, each one a fixed
+// 32 bytes record after a 32 bytes header. The file is mapped into memory, so appending is just
+// writing into a page and reading it back for a replay or a backtest is just walking an array.
+
+// Records only carry the SymbolId: stocks must be listed in the same order before replaying.
+
+// How hard appended records are pushed to disk is up to the flush policy:
+//  * background: the kernel writes pages back whenever it likes, survives a process crash but not a power loss
+//  * periodic:   asynchronous msync every 'flush_every' records
+//  * durable:    synchronous msync every 'flush_every' records, i.e. 1 for every single record
+
+/**** PROPER INTERFACE *****/
+
+struct journal_record {
+   enum kind_type : std::uint8_t { trade, price };
+
+   std::int64_t time {0}; // nanoseconds since epoch
+   double value {0.0}; // trade price or new price
+   std::uint64_t quantity {0};
+   std::uint32_t id {0};
+   kind_type kind {trade};
+   std::uint8_t indicator {0}; // buy->0 or sell->1
+   std::uint8_t reserved[2] {};
+
+   inline timestamp getTimestamp() const;
+   inline void setTimestamp(const timestamp& t);
+};
+
+struct journal_header {
+   char magic[8] {};
+   std::uint32_t version {0};
+   std::uint32_t record_size {0};
+   std::uint64_t count {0}; // records in use, the file might be longer
+   std::uint64_t reserved {0};
+};
+
+static_assert( sizeof(journal_record) == 32, "journal records are written as they are in memory" );
+static_assert( sizeof(journal_header) == 32, "journal records must stay aligned after the header" );
+
+static constexpr char journal_magic[8] = { 'G', 'B', 'C', 'E', 'J', 'R', 'N', 'L' };
+static constexpr std::uint32_t journal_version = 1;
+
+class TradeJournal
+{
+public:
+  enum flush_type : unsigned char { background, periodic, durable };
+
+  // an existing journal is opened to keep appending after its last record
+  inline explicit TradeJournal(const std::string& path, flush_type flush = background, size_t flush_every = 4096);
+  inline ~TradeJournal();
+
+  TradeJournal(const TradeJournal&) =delete;
+  TradeJournal& operator=(const TradeJournal&) =delete;
+
+  inline void appendTrade(SymbolId id, const timestamp& time, const trade_data& data);
+  inline void appendPrice(SymbolId id, const timestamp& time, double price);
+  inline void append(const journal_record& record);
+  inline void flush(); // synchronous, whatever the policy
+
+  inline span<const journal_record> records() const;
+  inline size_t size() const;
+
+private:
+  inline void map(size_t new_capacity); // in records
+  inline journal_header& header() const;
+
+  int file {-1};
+  char* base {nullptr};
+  size_t capacity {0}; // records the file has room for
+  size_t count {0};
+  flush_type policy {background};
+  size_t flush_every {4096};
+  size_t unflushed {0};
+};
+
+// read-only view of a journal, i.e. for backtests
+class JournalReader
+{
+public:
+  inline explicit JournalReader(const std::string& path);
+  inline ~JournalReader();
+
+  JournalReader(const JournalReader&) =delete;
+  JournalReader& operator=(const JournalReader&) =delete;
+
+  inline span<const journal_record> records() const;
+  inline size_t size() const;
+
+private:
+  int file {-1};
+  char* base {nullptr};
+  size_t length {0}; // bytes mapped
+  size_t count {0};
+};
+
+// throws unexpected_journal_format
+inline size_t checkJournalHeader(const char* base, size_t length);
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::timestamp jpmorgan::journal_record::getTimestamp() const
+{
+   return timestamp{ std::chrono::duration_cast<timestamp::duration>( std::chrono::nanoseconds( time ) ) };
+}
+
+void jpmorgan::journal_record::setTimestamp(const timestamp& t)
+{
+   time = std::chrono::duration_cast<std::chrono::nanoseconds>( t.time_since_epoch() ).count();
+}
+
+// how many records a well formed journal says it holds
+size_t jpmorgan::checkJournalHeader(const char* base, size_t length)
+{
+   if( length < sizeof(journal_header) ) { throw unexpected_journal_format(); }
+
+   journal_header header {};
+   std::memcpy( &header, base, sizeof(journal_header) );
+   if( 0 != std::memcmp( header.magic, journal_magic, sizeof(journal_magic) ) ) { throw unexpected_journal_format(); }
+   if( journal_version != header.version || sizeof(journal_record) != header.record_size ) { throw unexpected_journal_format(); }
+   if( header.count > ( length - sizeof(journal_header) ) / sizeof(journal_record) ) { throw unexpected_journal_format(); }
+
+   return static_cast<size_t>( header.count );
+}
+
+jpmorgan::TradeJournal::TradeJournal(const std::string& path, flush_type flush, size_t every) :
+ policy{flush}, flush_every{ every > 0 ? every : 1 }
+{
+   file = ::open( path.c_str(), O_RDWR | O_CREAT, 0644 );
+   if( 0 > file ) { throw journal_io_error(); }
+
+   struct stat status {};
+   if( 0 != ::fstat( file, &status ) ) { ::close( file ); throw journal_io_error(); }
+   size_t length = static_cast<size_t>( status.st_size );
+
+   try {
+      if( 0 == length )
+      {
+         map( 65536 );
+         journal_header& h = header();
+         std::memcpy( h.magic, journal_magic, sizeof(journal_magic) );
+         h.version = journal_version;
+         h.record_size = sizeof(journal_record);
+         h.count = 0;
+      }
+      else
+      {
+         // a foreign or damaged file is rejected as it is, before mapping may extend it
+         journal_header existing {};
+         if( ::pread( file, &existing, sizeof(journal_header), 0 ) != static_cast<ssize_t>( std::min( length, sizeof(journal_header) ) ) ) { throw journal_io_error(); }
+         count = checkJournalHeader( reinterpret_cast<const char*>( &existing ), length );
+         map( ( length - sizeof(journal_header) ) / sizeof(journal_record) );
+      }
+   } catch( ... ) {
+      if( nullptr != base ) { ::munmap( base, sizeof(journal_header) + capacity * sizeof(journal_record) ); }
+      ::close( file );
+      throw;
+   }
+}
+
+// nothing beyond the last record is left in the file
+jpmorgan::TradeJournal::~TradeJournal()
+{
+   if( policy != background ) { ::msync( base, sizeof(journal_header) + count * sizeof(journal_record), MS_SYNC ); }
+   ::munmap( base, sizeof(journal_header) + capacity * sizeof(journal_record) );
+   if( 0 != ::ftruncate( file, static_cast<off_t>( sizeof(journal_header) + count * sizeof(journal_record) ) ) ) { /* nothing to do in a dtor */ }
+   ::close( file );
+}
+
+// file & mapping grow together, records already written keep their place in the file
+void jpmorgan::TradeJournal::map(size_t new_capacity)
+{
+   size_t new_length = sizeof(journal_header) + new_capacity * sizeof(journal_record);
+
+   if( nullptr != base ) { ::munmap( base, sizeof(journal_header) + capacity * sizeof(journal_record) ); base = nullptr; }
+
+   struct stat status {};
+   if( 0 != ::fstat( file, &status ) ) { throw journal_io_error(); }
+   if( static_cast<size_t>( status.st_size ) < new_length && 0 != ::ftruncate( file, static_cast<off_t>( new_length ) ) ) { throw journal_io_error(); }
+
+   void* address = ::mmap( nullptr, new_length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0 );
+   if( MAP_FAILED == address ) { throw journal_io_error(); }
+
+   base = static_cast<char*>( address );
+   capacity = new_capacity;
+}
+
+jpmorgan::journal_header& jpmorgan::TradeJournal::header() const { return *reinterpret_cast<journal_header*>( base ); }
+
+void jpmorgan::TradeJournal::append(const journal_record& record)
+{
+   if( count == capacity ) { map( std::max<size_t>( 2 * capacity, 65536 ) ); }
+
+   std::memcpy( base + sizeof(journal_header) + count * sizeof(journal_record), &record, sizeof(journal_record) );
+   header().count = ++count;
+
+   if( background != policy && ++unflushed >= flush_every )
+   {
+      ::msync( base, sizeof(journal_header) + count * sizeof(journal_record), ( durable == policy ? MS_SYNC : MS_ASYNC ) );
+      unflushed = 0;
+   }
+}
+
+void jpmorgan::TradeJournal::appendTrade(SymbolId id, const timestamp& time, const trade_data& data)
+{
+   journal_record record {};
+   record.setTimestamp( time );
+   record.value = data.price;
+   record.quantity = data.quantity;
+   record.id = id;
+   record.kind = journal_record::trade;
+   record.indicator = data.indicator;
+   append( record );
+}
+
+void jpmorgan::TradeJournal::appendPrice(SymbolId id, const timestamp& time, double price)
+{
+   journal_record record {};
+   record.setTimestamp( time );
+   record.value = price;
+   record.id = id;
+   record.kind = journal_record::price;
+   append( record );
+}
+
+void jpmorgan::TradeJournal::flush()
+{
+   if( 0 != ::msync( base, sizeof(journal_header) + count * sizeof(journal_record), MS_SYNC ) ) { throw journal_io_error(); }
+   unflushed = 0;
+}
+
+jpmorgan::span<const jpmorgan::journal_record> jpmorgan::TradeJournal::records() const
+{
+   return span<const journal_record>{ reinterpret_cast<const journal_record*>( base + sizeof(journal_header) ), count };
+}
+
+size_t jpmorgan::TradeJournal::size() const { return count; }
+
+jpmorgan::JournalReader::JournalReader(const std::string& path)
+{
+   file = ::open( path.c_str(), O_RDONLY );
+   if( 0 > file ) { throw journal_io_error(); }
+
+   struct stat status {};
+   if( 0 != ::fstat( file, &status ) ) { ::close( file ); throw journal_io_error(); }
+   length = static_cast<size_t>( status.st_size );
+   if( length < sizeof(journal_header) ) { ::close( file ); throw unexpected_journal_format(); }
+
+   void* address = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, file, 0 );
+   if( MAP_FAILED == address ) { ::close( file ); throw journal_io_error(); }
+   base = static_cast<char*>( address );
+
+   try {
+      count = checkJournalHeader( base, length );
+   } catch( ... ) {
+      ::munmap( base, length );
+      ::close( file );
+      throw;
+   }
+
+   // replays walk it front to back
+   ::madvise( base, length, MADV_SEQUENTIAL );
+}
+
+jpmorgan::JournalReader::~JournalReader()
+{
+   ::munmap( base, length );
+   ::close( file );
+}
+
+jpmorgan::span<const jpmorgan::journal_record> jpmorgan::JournalReader::records() const
+{
+   return span<const journal_record>{ reinterpret_cast<const journal_record*>( base + sizeof(journal_header) ), count };
+}
+
+size_t jpmorgan::JournalReader::size() const { return count; }
+
+#endif // JOURNAL_HPP
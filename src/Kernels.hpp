@@ -0,0 +1,431 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define JPMORGAN_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace jpmorgan {
+
+// Bulk calculations over trade columns (price, quantity and indicator arrays). They are used to
+// recompute whole windows, i.e. when a day of trades is replayed, instead of the running sums.
+
+// AVX2 and SSE2 versions are chosen at runtime depending on the CPU; the scalar one is always there
+// as a fallback and as the reference. Vector versions convert quantities to double with the 2^52 trick,
+// so quantities are supposed to be smaller than 2^52 shares.
+
+/**** PROPER INTERFACE *****/
+
+struct trade_summary {
+   double price_x_quantity {0.0};
+   unsigned long long quantity {0};
+   unsigned long long buy_quantity {0};  // indicator false
+   unsigned long long sell_quantity {0}; // indicator true
+   double min_price { std::numeric_limits<double>::infinity() };
+   double max_price { -std::numeric_limits<double>::infinity() };
+   size_t count {0};
+
+   inline void merge(const trade_summary& other);
+   inline double stockPrice() const; // volume weighted, zero when empty
+};
+
+enum class simd { scalar, sse2, avx2 };
+
+inline simd detectedSimd(); // best one supported by this CPU
+inline simd activeSimd();
+inline void setSimd(simd level); // mainly for testing & benchmarking, never above the detected one
+
+// sum(price * quantity) & sum(quantity) only, less memory traffic than the whole summary
+inline void sumPriceQuantity(const double* price, const std::uint64_t* quantity, size_t n, double& s_price_x_quantity, unsigned long long& s_quantity);
+
+// price * quantity, quantity, buy/sell quantity and min/max price in one pass
+inline trade_summary summarize(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n);
+
+// result[i] = numerator[i] / denominator[i], i.e. yields & P/E ratios of many stocks; IEEE division, same results on every level
+inline void divide(const double* numerator, const double* denominator, double* result, size_t n);
+
+// result[i] = ( value[i] - reference[i] ) / reference[i], NaN where reference[i] isn't positive; i.e. price against VWAP
+inline void relativeDeviation(const double* value, const double* reference, double* result, size_t n);
+
+namespace kernels {
+
+inline void sumPriceQuantityScalar(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q);
+inline trade_summary summarizeScalar(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n);
+inline void divideScalar(const double* numerator, const double* denominator, double* result, size_t n);
+inline void relativeDeviationScalar(const double* value, const double* reference, double* result, size_t n);
+
+#ifdef JPMORGAN_X86_KERNELS
+inline void sumPriceQuantitySse2(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q);
+inline trade_summary summarizeSse2(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n);
+inline void divideSse2(const double* numerator, const double* denominator, double* result, size_t n);
+inline void relativeDeviationSse2(const double* value, const double* reference, double* result, size_t n);
+__attribute__((target("avx2"))) inline void sumPriceQuantityAvx2(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q);
+__attribute__((target("avx2"))) inline trade_summary summarizeAvx2(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n);
+__attribute__((target("avx2"))) inline void divideAvx2(const double* numerator, const double* denominator, double* result, size_t n);
+__attribute__((target("avx2"))) inline void relativeDeviationAvx2(const double* value, const double* reference, double* result, size_t n);
+#endif
+
+inline simd& active();
+
+} // namespace kernels
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+void jpmorgan::trade_summary::merge(const trade_summary& other)
+{
+   price_x_quantity += other.price_x_quantity;
+   quantity += other.quantity;
+   buy_quantity += other.buy_quantity;
+   sell_quantity += other.sell_quantity;
+   min_price = std::min( min_price, other.min_price );
+   max_price = std::max( max_price, other.max_price );
+   count += other.count;
+}
+
+double jpmorgan::trade_summary::stockPrice() const
+{
+   if( 0 == quantity ) { return 0.0; }
+   if( 0.0 >= price_x_quantity ) { return 0.0; }
+   return ( price_x_quantity / quantity );
+}
+
+jpmorgan::simd jpmorgan::detectedSimd()
+{
+#ifdef JPMORGAN_X86_KERNELS
+   static const simd detected = ( __builtin_cpu_supports("avx2") ? simd::avx2 : simd::sse2 );
+   return detected;
+#else
+   return simd::scalar;
+#endif
+}
+
+jpmorgan::simd& jpmorgan::kernels::active()
+{
+   static simd level = detectedSimd();
+   return level;
+}
+
+jpmorgan::simd jpmorgan::activeSimd() { return kernels::active(); }
+
+void jpmorgan::setSimd(simd level)
+{
+   if( static_cast<int>(level) > static_cast<int>(detectedSimd()) ) { level = detectedSimd(); }
+   kernels::active() = level;
+}
+
+void jpmorgan::sumPriceQuantity(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q)
+{
+   switch( kernels::active() )
+   {
+#ifdef JPMORGAN_X86_KERNELS
+     case simd::avx2: kernels::sumPriceQuantityAvx2(price, quantity, n, s_pxq, s_q); return;
+     case simd::sse2: kernels::sumPriceQuantitySse2(price, quantity, n, s_pxq, s_q); return;
+#endif
+     default: kernels::sumPriceQuantityScalar(price, quantity, n, s_pxq, s_q); return;
+   }
+}
+
+jpmorgan::trade_summary jpmorgan::summarize(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n)
+{
+   switch( kernels::active() )
+   {
+#ifdef JPMORGAN_X86_KERNELS
+     case simd::avx2: return kernels::summarizeAvx2(price, quantity, indicator, n);
+     case simd::sse2: return kernels::summarizeSse2(price, quantity, indicator, n);
+#endif
+     default: return kernels::summarizeScalar(price, quantity, indicator, n);
+   }
+}
+
+void jpmorgan::divide(const double* numerator, const double* denominator, double* result, size_t n)
+{
+   switch( kernels::active() )
+   {
+#ifdef JPMORGAN_X86_KERNELS
+     case simd::avx2: kernels::divideAvx2(numerator, denominator, result, n); return;
+     case simd::sse2: kernels::divideSse2(numerator, denominator, result, n); return;
+#endif
+     default: kernels::divideScalar(numerator, denominator, result, n); return;
+   }
+}
+
+void jpmorgan::relativeDeviation(const double* value, const double* reference, double* result, size_t n)
+{
+   switch( kernels::active() )
+   {
+#ifdef JPMORGAN_X86_KERNELS
+     case simd::avx2: kernels::relativeDeviationAvx2(value, reference, result, n); return;
+     case simd::sse2: kernels::relativeDeviationSse2(value, reference, result, n); return;
+#endif
+     default: kernels::relativeDeviationScalar(value, reference, result, n); return;
+   }
+}
+
+/*** scalar ***/
+
+void jpmorgan::kernels::sumPriceQuantityScalar(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q)
+{
+   double pxq {0.0};
+   unsigned long long q {0};
+   for(size_t i=0; i<n; ++i)
+   {
+      pxq += ( price[i] * quantity[i] );
+      q += quantity[i];
+   }
+   s_pxq = pxq;
+   s_q = q;
+}
+
+jpmorgan::trade_summary jpmorgan::kernels::summarizeScalar(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n)
+{
+   trade_summary result {};
+   for(size_t i=0; i<n; ++i)
+   {
+      result.price_x_quantity += ( price[i] * quantity[i] );
+      result.quantity += quantity[i];
+      if( indicator[i] ) { result.sell_quantity += quantity[i]; } else { result.buy_quantity += quantity[i]; }
+      result.min_price = std::min( result.min_price, price[i] );
+      result.max_price = std::max( result.max_price, price[i] );
+   }
+   result.count = n;
+   return result;
+}
+
+void jpmorgan::kernels::divideScalar(const double* numerator, const double* denominator, double* result, size_t n)
+{
+   for(size_t i=0; i<n; ++i) { result[i] = ( numerator[i] / denominator[i] ); }
+}
+
+void jpmorgan::kernels::relativeDeviationScalar(const double* value, const double* reference, double* result, size_t n)
+{
+   const double nan = std::numeric_limits<double>::quiet_NaN();
+   for(size_t i=0; i<n; ++i) { result[i] = ( 0.0 < reference[i] ? ( value[i] - reference[i] ) / reference[i] : nan ); }
+}
+
+#ifdef JPMORGAN_X86_KERNELS
+
+/*** SSE2, always there on x86_64 ***/
+
+void jpmorgan::kernels::sumPriceQuantitySse2(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q)
+{
+   const __m128i magic_i = _mm_set1_epi64x( 0x4330000000000000LL ); // 2^52 as double bits
+   const __m128d magic_d = _mm_set1_pd( 4503599627370496.0 );
+
+   __m128d pxq = _mm_setzero_pd();
+   __m128i q = _mm_setzero_si128();
+
+   size_t i = 0;
+   for(; i + 2 <= n; i += 2)
+   {
+      __m128i qi = _mm_loadu_si128( reinterpret_cast<const __m128i*>(quantity + i) );
+      __m128d qd = _mm_sub_pd( _mm_castsi128_pd( _mm_or_si128(qi, magic_i) ), magic_d );
+      pxq = _mm_add_pd( pxq, _mm_mul_pd( _mm_loadu_pd(price + i), qd ) );
+      q = _mm_add_epi64( q, qi );
+   }
+
+   alignas(16) double pxq_lanes[2];
+   alignas(16) std::uint64_t q_lanes[2];
+   _mm_store_pd( pxq_lanes, pxq );
+   _mm_store_si128( reinterpret_cast<__m128i*>(q_lanes), q );
+
+   double tail_pxq {0.0};
+   unsigned long long tail_q {0};
+   sumPriceQuantityScalar( price + i, quantity + i, n - i, tail_pxq, tail_q );
+
+   s_pxq = ( pxq_lanes[0] + pxq_lanes[1] ) + tail_pxq;
+   s_q = q_lanes[0] + q_lanes[1] + tail_q;
+}
+
+jpmorgan::trade_summary jpmorgan::kernels::summarizeSse2(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n)
+{
+   const __m128i magic_i = _mm_set1_epi64x( 0x4330000000000000LL );
+   const __m128d magic_d = _mm_set1_pd( 4503599627370496.0 );
+
+   __m128d pxq = _mm_setzero_pd();
+   __m128i q = _mm_setzero_si128();
+   __m128i sell = _mm_setzero_si128();
+   __m128d low = _mm_set1_pd( std::numeric_limits<double>::infinity() );
+   __m128d high = _mm_set1_pd( -std::numeric_limits<double>::infinity() );
+
+   size_t i = 0;
+   for(; i + 2 <= n; i += 2)
+   {
+      __m128i qi = _mm_loadu_si128( reinterpret_cast<const __m128i*>(quantity + i) );
+      __m128d qd = _mm_sub_pd( _mm_castsi128_pd( _mm_or_si128(qi, magic_i) ), magic_d );
+      __m128d p = _mm_loadu_pd( price + i );
+      // no 64 bits compare on SSE2, the mask is built from both indicators
+      __m128i is_sell = _mm_set_epi64x( -static_cast<long long>( indicator[i+1] != 0 ), -static_cast<long long>( indicator[i] != 0 ) );
+
+      pxq = _mm_add_pd( pxq, _mm_mul_pd( p, qd ) );
+      q = _mm_add_epi64( q, qi );
+      sell = _mm_add_epi64( sell, _mm_and_si128( qi, is_sell ) );
+      low = _mm_min_pd( low, p );
+      high = _mm_max_pd( high, p );
+   }
+
+   alignas(16) double pxq_lanes[2], low_lanes[2], high_lanes[2];
+   alignas(16) std::uint64_t q_lanes[2], sell_lanes[2];
+   _mm_store_pd( pxq_lanes, pxq );
+   _mm_store_pd( low_lanes, low );
+   _mm_store_pd( high_lanes, high );
+   _mm_store_si128( reinterpret_cast<__m128i*>(q_lanes), q );
+   _mm_store_si128( reinterpret_cast<__m128i*>(sell_lanes), sell );
+
+   trade_summary result {};
+   result.price_x_quantity = pxq_lanes[0] + pxq_lanes[1];
+   result.quantity = q_lanes[0] + q_lanes[1];
+   result.sell_quantity = sell_lanes[0] + sell_lanes[1];
+   result.buy_quantity = result.quantity - result.sell_quantity;
+   result.min_price = std::min( low_lanes[0], low_lanes[1] );
+   result.max_price = std::max( high_lanes[0], high_lanes[1] );
+   result.count = i;
+
+   result.merge( summarizeScalar( price + i, quantity + i, indicator + i, n - i ) );
+   return result;
+}
+
+void jpmorgan::kernels::divideSse2(const double* numerator, const double* denominator, double* result, size_t n)
+{
+   size_t i = 0;
+   for(; i + 2 <= n; i += 2) { _mm_storeu_pd( result + i, _mm_div_pd( _mm_loadu_pd(numerator + i), _mm_loadu_pd(denominator + i) ) ); }
+   divideScalar( numerator + i, denominator + i, result + i, n - i );
+}
+
+// lanes whose reference isn't positive are masked to NaN, no branch
+void jpmorgan::kernels::relativeDeviationSse2(const double* value, const double* reference, double* result, size_t n)
+{
+   const __m128d zero = _mm_setzero_pd();
+   const __m128d nan = _mm_set1_pd( std::numeric_limits<double>::quiet_NaN() );
+   size_t i = 0;
+   for(; i + 2 <= n; i += 2)
+   {
+      __m128d r = _mm_loadu_pd( reference + i );
+      __m128d deviation = _mm_div_pd( _mm_sub_pd( _mm_loadu_pd(value + i), r ), r );
+      __m128d positive = _mm_cmpgt_pd( r, zero );
+      _mm_storeu_pd( result + i, _mm_or_pd( _mm_and_pd( positive, deviation ), _mm_andnot_pd( positive, nan ) ) );
+   }
+   relativeDeviationScalar( value + i, reference + i, result + i, n - i );
+}
+
+/*** AVX2 ***/
+
+void jpmorgan::kernels::sumPriceQuantityAvx2(const double* price, const std::uint64_t* quantity, size_t n, double& s_pxq, unsigned long long& s_q)
+{
+   const __m256i magic_i = _mm256_set1_epi64x( 0x4330000000000000LL );
+   const __m256d magic_d = _mm256_set1_pd( 4503599627370496.0 );
+
+   // two accumulators hide the latency of the additions
+   __m256d pxq0 = _mm256_setzero_pd(), pxq1 = _mm256_setzero_pd();
+   __m256i q0 = _mm256_setzero_si256(), q1 = _mm256_setzero_si256();
+
+   size_t i = 0;
+   for(; i + 8 <= n; i += 8)
+   {
+      __m256i qi0 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(quantity + i) );
+      __m256i qi1 = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(quantity + i + 4) );
+      __m256d qd0 = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_or_si256(qi0, magic_i) ), magic_d );
+      __m256d qd1 = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_or_si256(qi1, magic_i) ), magic_d );
+      pxq0 = _mm256_add_pd( pxq0, _mm256_mul_pd( _mm256_loadu_pd(price + i), qd0 ) );
+      pxq1 = _mm256_add_pd( pxq1, _mm256_mul_pd( _mm256_loadu_pd(price + i + 4), qd1 ) );
+      q0 = _mm256_add_epi64( q0, qi0 );
+      q1 = _mm256_add_epi64( q1, qi1 );
+   }
+
+   alignas(32) double pxq_lanes[4];
+   alignas(32) std::uint64_t q_lanes[4];
+   _mm256_store_pd( pxq_lanes, _mm256_add_pd( pxq0, pxq1 ) );
+   _mm256_store_si256( reinterpret_cast<__m256i*>(q_lanes), _mm256_add_epi64( q0, q1 ) );
+
+   double tail_pxq {0.0};
+   unsigned long long tail_q {0};
+   sumPriceQuantityScalar( price + i, quantity + i, n - i, tail_pxq, tail_q );
+
+   s_pxq = ( (pxq_lanes[0] + pxq_lanes[1]) + (pxq_lanes[2] + pxq_lanes[3]) ) + tail_pxq;
+   s_q = q_lanes[0] + q_lanes[1] + q_lanes[2] + q_lanes[3] + tail_q;
+}
+
+jpmorgan::trade_summary jpmorgan::kernels::summarizeAvx2(const double* price, const std::uint64_t* quantity, const std::uint8_t* indicator, size_t n)
+{
+   const __m256i magic_i = _mm256_set1_epi64x( 0x4330000000000000LL );
+   const __m256d magic_d = _mm256_set1_pd( 4503599627370496.0 );
+   const __m256i zero = _mm256_setzero_si256();
+
+   __m256d pxq = _mm256_setzero_pd();
+   __m256i q = _mm256_setzero_si256();
+   __m256i buy = _mm256_setzero_si256();
+   __m256d low = _mm256_set1_pd( std::numeric_limits<double>::infinity() );
+   __m256d high = _mm256_set1_pd( -std::numeric_limits<double>::infinity() );
+
+   size_t i = 0;
+   for(; i + 4 <= n; i += 4)
+   {
+      __m256i qi = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(quantity + i) );
+      __m256d qd = _mm256_sub_pd( _mm256_castsi256_pd( _mm256_or_si256(qi, magic_i) ), magic_d );
+      __m256d p = _mm256_loadu_pd( price + i );
+
+      // four indicator bytes widened to 64 bits lanes, all ones where it's a buy
+      std::int32_t packed;
+      std::copy( indicator + i, indicator + i + 4, reinterpret_cast<std::uint8_t*>(&packed) );
+      __m256i is_buy = _mm256_cmpeq_epi64( _mm256_cvtepu8_epi64( _mm_cvtsi32_si128(packed) ), zero );
+
+      pxq = _mm256_add_pd( pxq, _mm256_mul_pd( p, qd ) );
+      q = _mm256_add_epi64( q, qi );
+      buy = _mm256_add_epi64( buy, _mm256_and_si256( qi, is_buy ) );
+      low = _mm256_min_pd( low, p );
+      high = _mm256_max_pd( high, p );
+   }
+
+   alignas(32) double pxq_lanes[4], low_lanes[4], high_lanes[4];
+   alignas(32) std::uint64_t q_lanes[4], buy_lanes[4];
+   _mm256_store_pd( pxq_lanes, pxq );
+   _mm256_store_pd( low_lanes, low );
+   _mm256_store_pd( high_lanes, high );
+   _mm256_store_si256( reinterpret_cast<__m256i*>(q_lanes), q );
+   _mm256_store_si256( reinterpret_cast<__m256i*>(buy_lanes), buy );
+
+   trade_summary result {};
+   result.price_x_quantity = ( pxq_lanes[0] + pxq_lanes[1] ) + ( pxq_lanes[2] + pxq_lanes[3] );
+   result.quantity = q_lanes[0] + q_lanes[1] + q_lanes[2] + q_lanes[3];
+   result.buy_quantity = buy_lanes[0] + buy_lanes[1] + buy_lanes[2] + buy_lanes[3];
+   result.sell_quantity = result.quantity - result.buy_quantity;
+   result.min_price = std::min( std::min( low_lanes[0], low_lanes[1] ), std::min( low_lanes[2], low_lanes[3] ) );
+   result.max_price = std::max( std::max( high_lanes[0], high_lanes[1] ), std::max( high_lanes[2], high_lanes[3] ) );
+   result.count = i;
+
+   result.merge( summarizeScalar( price + i, quantity + i, indicator + i, n - i ) );
+   return result;
+}
+
+void jpmorgan::kernels::divideAvx2(const double* numerator, const double* denominator, double* result, size_t n)
+{
+   size_t i = 0;
+   for(; i + 4 <= n; i += 4) { _mm256_storeu_pd( result + i, _mm256_div_pd( _mm256_loadu_pd(numerator + i), _mm256_loadu_pd(denominator + i) ) ); }
+   divideScalar( numerator + i, denominator + i, result + i, n - i );
+}
+
+void jpmorgan::kernels::relativeDeviationAvx2(const double* value, const double* reference, double* result, size_t n)
+{
+   const __m256d zero = _mm256_setzero_pd();
+   const __m256d nan = _mm256_set1_pd( std::numeric_limits<double>::quiet_NaN() );
+   size_t i = 0;
+   for(; i + 4 <= n; i += 4)
+   {
+      __m256d r = _mm256_loadu_pd( reference + i );
+      __m256d deviation = _mm256_div_pd( _mm256_sub_pd( _mm256_loadu_pd(value + i), r ), r );
+      __m256d positive = _mm256_cmp_pd( r, zero, _CMP_GT_OQ );
+      _mm256_storeu_pd( result + i, _mm256_blendv_pd( nan, deviation, positive ) );
+   }
+   relativeDeviationScalar( value + i, reference + i, result + i, n - i );
+}
+
+#endif // JPMORGAN_X86_KERNELS
+
+#endif // KERNELS_HPP
@@ -0,0 +1,132 @@
+#ifndef KINDS_HPP
+#define KINDS_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Kernels.hpp"
+#include "Span.hpp"
+#include "Symbols.hpp"
+
+namespace jpmorgan {
+
+// Common and Preferred stocks as two compile-time kinds, each one kept in its own columns: the
+// kind is known by the array a stock sits in, so screening the whole exchange never asks
+// 'isCommon()' and ratios are plain divisions over contiguous doubles, see 'divide' in Kernels.hpp.
+
+// Only what the ratios need is kept here (price and dividends); trades still live in every Stock.
+// Rows are packed, a removed stock is swapped with the last one of its kind.
+
+/**** PROPER INTERFACE *****/
+
+struct common_kind {
+   static constexpr bool preferred = false;
+   static constexpr double dividend(double last_dividend, double /*par_value*/, double /*fixed_dividend*/) { return last_dividend; }
+};
+
+struct preferred_kind {
+   static constexpr bool preferred = true;
+   static constexpr double dividend(double /*last_dividend*/, double par_value, double fixed_dividend) { return ( fixed_dividend * par_value ); }
+};
+
+template<typename Kind>
+class KindColumns
+{
+public:
+  using kind = Kind;
+
+  inline size_t add(SymbolId id, double price, double last_dividend, double par_value, double fixed_dividend); // its row
+  inline SymbolId remove(size_t row); // the stock now in 'row', i.e. the last one moved there
+  inline void setPrice(size_t row, double price);
+  inline void clear();
+
+  // one value per row, 'out' as big as size()
+  inline void dividendYields(span<double> out) const;
+  inline void p_e_ratios(span<double> out) const;
+
+  inline size_t size() const;
+  inline bool empty() const;
+  inline span<const SymbolId> ids() const;
+  inline span<const double> prices() const;
+  inline span<const double> dividends() const; // the yield numerator of this kind
+  inline span<const double> lastDividends() const;
+
+private:
+  std::vector<SymbolId> row_ids {};
+  std::vector<double> row_prices {};
+  std::vector<double> row_dividends {};
+  std::vector<double> row_last_dividends {};
+};
+
+using CommonColumns = KindColumns<common_kind>;
+using PreferredColumns = KindColumns<preferred_kind>;
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+template<typename Kind>
+size_t jpmorgan::KindColumns<Kind>::add(SymbolId id, double price, double last_dividend, double par_value, double fixed_dividend)
+{
+   row_ids.push_back( id );
+   row_prices.push_back( price );
+   row_dividends.push_back( Kind::dividend( last_dividend, par_value, fixed_dividend ) );
+   row_last_dividends.push_back( last_dividend );
+   return row_ids.size() - 1;
+}
+
+template<typename Kind>
+jpmorgan::SymbolId jpmorgan::KindColumns<Kind>::remove(size_t row)
+{
+   size_t last = row_ids.size() - 1;
+   row_ids[row] = row_ids[last];
+   row_prices[row] = row_prices[last];
+   row_dividends[row] = row_dividends[last];
+   row_last_dividends[row] = row_last_dividends[last];
+
+   row_ids.pop_back();
+   row_prices.pop_back();
+   row_dividends.pop_back();
+   row_last_dividends.pop_back();
+   return ( row < row_ids.size() ? row_ids[row] : SymbolId{} );
+}
+
+template<typename Kind>
+void jpmorgan::KindColumns<Kind>::setPrice(size_t row, double price) { row_prices[row] = price; }
+
+template<typename Kind>
+void jpmorgan::KindColumns<Kind>::clear()
+{
+   row_ids.clear();
+   row_prices.clear();
+   row_dividends.clear();
+   row_last_dividends.clear();
+}
+
+// same results as Stock::dividendYield, a zero price gives infinity there too
+template<typename Kind>
+void jpmorgan::KindColumns<Kind>::dividendYields(span<double> out) const
+{
+   divide( row_dividends.data(), row_prices.data(), out.data(), row_ids.size() );
+}
+
+template<typename Kind>
+void jpmorgan::KindColumns<Kind>::p_e_ratios(span<double> out) const
+{
+   divide( row_prices.data(), row_last_dividends.data(), out.data(), row_ids.size() );
+}
+
+template<typename Kind>
+size_t jpmorgan::KindColumns<Kind>::size() const { return row_ids.size(); }
+template<typename Kind>
+bool jpmorgan::KindColumns<Kind>::empty() const { return row_ids.empty(); }
+template<typename Kind>
+jpmorgan::span<const jpmorgan::SymbolId> jpmorgan::KindColumns<Kind>::ids() const { return row_ids; }
+template<typename Kind>
+jpmorgan::span<const double> jpmorgan::KindColumns<Kind>::prices() const { return row_prices; }
+template<typename Kind>
+jpmorgan::span<const double> jpmorgan::KindColumns<Kind>::dividends() const { return row_dividends; }
+template<typename Kind>
+jpmorgan::span<const double> jpmorgan::KindColumns<Kind>::lastDividends() const { return row_last_dividends; }
+
+#endif // KINDS_HPP
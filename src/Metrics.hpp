@@ -0,0 +1,235 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "Clock.hpp"
+
+namespace jpmorgan {
+
+// Hot path instrumentation, only compiled in with JPMORGAN_METRICS defined (cmake -DJPMORGAN_METRICS=ON):
+// without it the JPMORGAN_METRICS_* macros are nothing at all and no code path changes.
+
+// Latencies go into log-linear histograms, HDR style: exact up to 15 ticks, then 16 buckets for every
+// power of two, so any value is known within 1/16 of itself. Recording is one relaxed 'fetch_add' on
+// the bucket (plus a rare one on the max), no lock and no allocation, so shards on other threads can
+// record into the same histogram and 'dump' can read it any time while the exchange keeps going.
+
+// Latencies are CPU time stamp counter ticks (steady clock nanoseconds elsewhere), turned into
+// nanoseconds only when dumped.
+
+/**** PROPER INTERFACE *****/
+
+class Histogram
+{
+public:
+  static constexpr unsigned sub_bucket_bits = 4;
+  static constexpr size_t sub_buckets = size_t{1} << sub_bucket_bits;
+  static constexpr size_t bucket_count = ( 64 - sub_bucket_bits + 1 ) * sub_buckets;
+
+  inline void record(std::uint64_t value);
+
+  inline std::uint64_t count() const;
+  inline std::uint64_t max() const;
+  inline std::uint64_t percentile(double p) const; // highest value of the bucket 'p' (0..1) falls in, max at most
+  inline void reset(); // not atomic as a whole, values recorded meanwhile may survive
+
+  static inline size_t bucketOf(std::uint64_t value);
+  static inline std::uint64_t lowestOf(size_t bucket);
+
+private:
+  std::atomic<std::uint64_t> buckets[bucket_count] {};
+  std::atomic<std::uint64_t> highest {0};
+};
+
+namespace metrics {
+
+inline std::uint64_t ticks();
+inline double nanosecondsPerTick(); // calibrated once
+
+} // namespace metrics
+
+// everything the exchange records, one per process
+struct exchange_metrics {
+   Histogram add_trade {};        // Trade::addTrade
+   Histogram stock_price {};      // Trade::stockPrice
+   Histogram all_share_index {};  // GBCE::allShareIndex
+   Histogram clear_old_trades {}; // GBCE::clearOldTrades
+   Histogram window_trades {};    // trades left in window 0 after Trade::clearOldTrades, not a latency
+
+   std::atomic<std::uint64_t> trades_in {0};
+   std::atomic<std::uint64_t> trades_expired {0};    // dropped from the stores
+   std::atomic<std::uint64_t> index_recomputes {0};
+   std::atomic<std::uint64_t> index_cached {0};      // recomputes avoided, nothing changed since the last one
+   std::atomic<std::uint64_t> symbols_non_found {0};
+
+   inline void reset();
+   inline void dump(std::ostream& out) const; // text, one line per histogram & counter
+};
+
+inline exchange_metrics& exchangeMetrics();
+
+// records the ticks from construction to destruction
+class ScopedTimer
+{
+public:
+  inline explicit ScopedTimer(Histogram& target);
+  inline ~ScopedTimer();
+
+  ScopedTimer(const ScopedTimer&) =delete;
+  ScopedTimer& operator=(const ScopedTimer&) =delete;
+
+private:
+  Histogram& histogram;
+  std::uint64_t start {0};
+};
+
+} // namespace jpmorgan
+
+#ifdef JPMORGAN_METRICS
+// one timer name per line, so several timers can share a scope or nest without shadowing
+#define JPMORGAN_METRICS_CONCAT_(a, b) a##b
+#define JPMORGAN_METRICS_CONCAT(a, b) JPMORGAN_METRICS_CONCAT_(a, b)
+#define JPMORGAN_METRICS_TIME(histogram) ::jpmorgan::ScopedTimer JPMORGAN_METRICS_CONCAT(metrics_timer_, __LINE__) { ::jpmorgan::exchangeMetrics().histogram }
+#define JPMORGAN_METRICS_RECORD(histogram, value) ::jpmorgan::exchangeMetrics().histogram.record( (value) )
+#define JPMORGAN_METRICS_COUNT(counter, n) ::jpmorgan::exchangeMetrics().counter.fetch_add( (n), std::memory_order_relaxed )
+#else
+#define JPMORGAN_METRICS_TIME(histogram) ((void)0)
+#define JPMORGAN_METRICS_RECORD(histogram, value) ((void)0)
+#define JPMORGAN_METRICS_COUNT(counter, n) ((void)0)
+#endif
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+// below 2 * sub_buckets the bucket is the value itself, above it the top 'sub_bucket_bits + 1' bits pick it
+size_t jpmorgan::Histogram::bucketOf(std::uint64_t value)
+{
+   if( value < sub_buckets ) { return static_cast<size_t>( value ); }
+   unsigned shift = static_cast<unsigned>( 63 - __builtin_clzll( value ) ) - sub_bucket_bits;
+   return sub_buckets * shift + static_cast<size_t>( value >> shift );
+}
+
+std::uint64_t jpmorgan::Histogram::lowestOf(size_t bucket)
+{
+   if( bucket < 2 * sub_buckets ) { return bucket; }
+   unsigned shift = static_cast<unsigned>( bucket / sub_buckets ) - 1;
+   return static_cast<std::uint64_t>( bucket - sub_buckets * shift ) << shift;
+}
+
+void jpmorgan::Histogram::record(std::uint64_t value)
+{
+   buckets[bucketOf( value )].fetch_add( 1, std::memory_order_relaxed );
+
+   std::uint64_t seen = highest.load( std::memory_order_relaxed );
+   while( value > seen && !highest.compare_exchange_weak( seen, value, std::memory_order_relaxed ) ) {}
+}
+
+std::uint64_t jpmorgan::Histogram::count() const
+{
+   std::uint64_t result {0};
+   for(const auto& bucket : buckets) { result += bucket.load( std::memory_order_relaxed ); }
+   return result;
+}
+
+std::uint64_t jpmorgan::Histogram::max() const { return highest.load( std::memory_order_relaxed ); }
+
+std::uint64_t jpmorgan::Histogram::percentile(double p) const
+{
+   std::uint64_t total = count();
+   if( 0 == total ) { return 0; }
+
+   std::uint64_t rank = static_cast<std::uint64_t>( p * total + 0.5 );
+   if( rank < 1 ) { rank = 1; }
+
+   std::uint64_t seen {0};
+   for(size_t b=0; b<bucket_count; ++b)
+   {
+      seen += buckets[b].load( std::memory_order_relaxed );
+      if( seen >= rank )
+      {
+         std::uint64_t top = ( b + 1 < bucket_count ? lowestOf( b + 1 ) - 1 : ~std::uint64_t{0} );
+         return ( top < max() ? top : max() );
+      }
+   }
+   return max();
+}
+
+void jpmorgan::Histogram::reset()
+{
+   for(auto& bucket : buckets) { bucket.store( 0, std::memory_order_relaxed ); }
+   highest.store( 0, std::memory_order_relaxed );
+}
+
+std::uint64_t jpmorgan::metrics::ticks()
+{
+#ifdef JPMORGAN_TSC_CLOCK
+   return __rdtsc();
+#else
+   return static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
+
+// same measure as Clock::calibrate
+double jpmorgan::metrics::nanosecondsPerTick()
+{
+#ifdef JPMORGAN_TSC_CLOCK
+   static const double calibrated = []() {
+      auto steady_start = std::chrono::steady_clock::now();
+      std::uint64_t ticks_start = __rdtsc();
+
+      auto steady_end = steady_start;
+      while( steady_end - steady_start < std::chrono::milliseconds(2) ) { steady_end = std::chrono::steady_clock::now(); }
+      std::uint64_t ticks_end = __rdtsc();
+
+      double elapsed = std::chrono::duration<double, std::nano>( steady_end - steady_start ).count();
+      return ( ticks_end > ticks_start ? elapsed / ( ticks_end - ticks_start ) : 1.0 );
+   }();
+   return calibrated;
+#else
+   return 1.0;
+#endif
+}
+
+jpmorgan::exchange_metrics& jpmorgan::exchangeMetrics()
+{
+   static exchange_metrics instance {};
+   return instance;
+}
+
+void jpmorgan::exchange_metrics::reset()
+{
+   for(auto* histogram : { &add_trade, &stock_price, &all_share_index, &clear_old_trades, &window_trades }) { histogram->reset(); }
+   for(auto* counter : { &trades_in, &trades_expired, &index_recomputes, &index_cached, &symbols_non_found }) { counter->store( 0, std::memory_order_relaxed ); }
+}
+
+void jpmorgan::exchange_metrics::dump(std::ostream& out) const
+{
+   double ns = metrics::nanosecondsPerTick();
+   auto line = [&out](const char* name, const Histogram& histogram, double scale, const char* unit) {
+      out << name << " count=" << histogram.count();
+      for(auto p : { 0.5, 0.9, 0.99, 0.999 }) { out << " p" << p * 100 << "=" << histogram.percentile( p ) * scale << unit; }
+      out << " max=" << histogram.max() * scale << unit << "\n";
+   };
+
+   line( "add_trade", add_trade, ns, "ns" );
+   line( "stock_price", stock_price, ns, "ns" );
+   line( "all_share_index", all_share_index, ns, "ns" );
+   line( "clear_old_trades", clear_old_trades, ns, "ns" );
+   line( "window_trades", window_trades, 1.0, "" );
+
+   out << "trades_in " << trades_in.load( std::memory_order_relaxed ) << "\n"
+       << "trades_expired " << trades_expired.load( std::memory_order_relaxed ) << "\n"
+       << "index_recomputes " << index_recomputes.load( std::memory_order_relaxed ) << "\n"
+       << "index_cached " << index_cached.load( std::memory_order_relaxed ) << "\n"
+       << "symbols_non_found " << symbols_non_found.load( std::memory_order_relaxed ) << "\n";
+}
+
+jpmorgan::ScopedTimer::ScopedTimer(Histogram& target) : histogram{target}, start{metrics::ticks()} {}
+
+jpmorgan::ScopedTimer::~ScopedTimer() { histogram.record( metrics::ticks() - start ); }
+
+#endif // METRICS_HPP
@@ -0,0 +1,110 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace jpmorgan {
+
+// Memory for trade stores shared by every stock of an exchange. Blocks come in power-of-two sizes and
+// a released block is kept on a free list for the next store asking for that size, so a ring growing
+// in one stock reuses what another stock released. An arena can be reserved upfront: once it's big
+// enough for every window, ingestion never reaches the heap, not even while warming up.
+
+// No thread-safe at all, as the exchange itself. It must outlive every store using it.
+
+/**** PROPER INTERFACE *****/
+
+class BlockPool
+{
+public:
+  inline explicit BlockPool(size_t arena_bytes = 0);
+  inline ~BlockPool();
+
+  BlockPool(const BlockPool&) =delete;
+  BlockPool& operator=(const BlockPool&) =delete;
+
+  inline void* allocate(size_t bytes);
+  inline void deallocate(void* block, size_t bytes); // same 'bytes' as asked for when allocated
+
+  inline size_t getArenaSize() const;
+  inline size_t getArenaUsed() const;
+  inline size_t getHeapBlocks() const; // blocks the arena had no room for
+
+private:
+  static constexpr size_t min_block = 64; // a cache line
+  static constexpr size_t size_classes = 64;
+
+  struct free_block { free_block* next; };
+
+  static inline size_t sizeClass(size_t bytes); // log2 of the block size
+
+  char* arena {nullptr};
+  size_t arena_size {0};
+  size_t arena_used {0};
+  free_block* free_lists[size_classes] {};
+  std::vector<void*> heap_blocks {};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::BlockPool::BlockPool(size_t arena_bytes) : arena_size{arena_bytes}
+{
+   if( 0 < arena_size ) { arena = static_cast<char*>( ::operator new( arena_size, std::align_val_t{min_block} ) ); }
+}
+
+jpmorgan::BlockPool::~BlockPool()
+{
+   for(void* block : heap_blocks) { ::operator delete( block, std::align_val_t{min_block} ); }
+   if( nullptr != arena ) { ::operator delete( arena, std::align_val_t{min_block} ); }
+}
+
+size_t jpmorgan::BlockPool::sizeClass(size_t bytes)
+{
+   size_t k = 6; // min_block
+   while( ( static_cast<size_t>(1) << k ) < bytes ) { ++k; }
+   return k;
+}
+
+void* jpmorgan::BlockPool::allocate(size_t bytes)
+{
+   size_t k = sizeClass( bytes );
+   if( nullptr != free_lists[k] )
+   {
+      free_block* block = free_lists[k];
+      free_lists[k] = block->next;
+      return block;
+   }
+
+   size_t block_size = static_cast<size_t>(1) << k;
+   if( arena_used + block_size <= arena_size )
+   {
+      void* block = arena + arena_used;
+      arena_used += block_size; // multiples of a cache line, so every block starts on one
+      return block;
+   }
+
+   heap_blocks.push_back( nullptr );
+   heap_blocks.back() = ::operator new( block_size, std::align_val_t{min_block} );
+   return heap_blocks.back();
+}
+
+void jpmorgan::BlockPool::deallocate(void* block, size_t bytes)
+{
+   if( nullptr == block ) { return; }
+
+   size_t k = sizeClass( bytes );
+   free_block* released = static_cast<free_block*>( block );
+   released->next = free_lists[k];
+   free_lists[k] = released;
+}
+
+size_t jpmorgan::BlockPool::getArenaSize() const { return arena_size; }
+size_t jpmorgan::BlockPool::getArenaUsed() const { return arena_used; }
+size_t jpmorgan::BlockPool::getHeapBlocks() const { return heap_blocks.size(); }
+
+#endif // POOL_HPP
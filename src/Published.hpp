@@ -0,0 +1,129 @@
+#ifndef PUBLISHED_HPP
+#define PUBLISHED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Exceptions.hpp"
+#include "Symbols.hpp"
+#include "Clock.hpp"
+#include "SeqLock.hpp"
+#include "Screen.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Read side of an exchange for risk & display threads polling far more often than trades arrive.
+// The thread owning the exchange calls 'publish' now and then (i.e. after every packet or every few
+// milliseconds); readers on any thread then get the All Share Index and the price, VWAP, yield &
+// P/E of any stock out of seqlocked rows, without waiting, without any lock and without touching the
+// exchange nor its trades at all.
+
+// Every row is consistent on its own. Rows of the same 'publish' share its version, the one the index
+// row carries as well, so a reader after figures of one moment can check them against each other.
+
+// Rows are allocated once, one cache line each, for SymbolIds below the capacity: readers look stocks
+// up by id, the symbol table belongs to the writer.
+
+/**** PROPER INTERFACE *****/
+
+struct published_stock {
+   double price {0.0};
+   double stock_price {0.0}; // window 0 VWAP
+   double dividend_yield {0.0};
+   double p_e_ratio {0.0};
+   std::uint64_t version {0}; // 0 means never published
+   bool listed {false};
+};
+
+struct published_index {
+   double all_share_index {0.0};
+   timestamp time {}; // exchange clock when published
+   std::uint64_t version {0};
+   size_t stocks {0}; // listed ones
+};
+
+class PublishedExchange
+{
+public:
+  inline explicit PublishedExchange(size_t capacity);
+
+  PublishedExchange(const PublishedExchange&) =delete;
+  PublishedExchange& operator=(const PublishedExchange&) =delete;
+
+  // writer, the thread owning the exchange; throws publish_capacity_exceeded before publishing anything
+  inline void publish(const GlobalBeverageCorporationExchange& gbce);
+
+  // readers, any thread
+  inline published_stock at(SymbolId id) const; // throws stock_non_found past the capacity
+  inline published_index index() const;
+  inline double allShareIndex() const;
+  inline double stockPrice(SymbolId id) const;
+  inline std::uint64_t getVersion() const;
+  inline size_t capacity() const;
+
+private:
+  struct alignas(64) row {
+     SeqLock<published_stock> stock {};
+  };
+
+  std::unique_ptr<row[]> rows {};
+  size_t row_count {0};
+  SeqLock<published_index> published {};
+
+  // writer only
+  ExchangeScreen screen {};
+  std::vector<bool> listed {}; // as last published
+  std::uint64_t version {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::PublishedExchange::PublishedExchange(size_t capacity) : rows{ new row[capacity] }, row_count{capacity}, listed( capacity, false ) {}
+
+// figures come out of one screen snapshot, so they are those of the very same 'now'
+void jpmorgan::PublishedExchange::publish(const GlobalBeverageCorporationExchange& gbce)
+{
+   size_t slots = gbce.getSlotCount();
+   if( slots > row_count ) { throw publish_capacity_exceeded(); }
+
+   screen.snapshot( gbce );
+   ++version;
+
+   span<const double> prices = screen.prices();
+   span<const double> vwaps = screen.vwaps();
+   span<const double> yields = screen.values( ExchangeScreen::dividend_yield );
+   span<const double> p_e_ratios = screen.values( ExchangeScreen::p_e_ratio );
+   for(size_t r=0; r<screen.size(); ++r)
+   {
+      SymbolId id = screen.getSymbolId(r);
+      rows[id].stock.store( published_stock{ prices[r], vwaps[r], yields[r], p_e_ratios[r], version, true } );
+   }
+
+   // removed since the last time
+   for(SymbolId id=0; id<slots; ++id)
+   {
+      if( listed[id] && !gbce.isListed(id) ) { rows[id].stock.store( published_stock{ 0.0, 0.0, 0.0, 0.0, version, false } ); }
+      listed[id] = gbce.isListed(id);
+   }
+
+   published.store( published_index{ gbce.allShareIndex(), gbce.getClock().now(), version, gbce.size() } );
+}
+
+jpmorgan::published_stock jpmorgan::PublishedExchange::at(SymbolId id) const
+{
+   if( id >= row_count ) { throw stock_non_found(); }
+   return rows[id].stock.load();
+}
+
+jpmorgan::published_index jpmorgan::PublishedExchange::index() const { return published.load(); }
+double jpmorgan::PublishedExchange::allShareIndex() const { return published.load().all_share_index; }
+double jpmorgan::PublishedExchange::stockPrice(SymbolId id) const { return at(id).stock_price; }
+std::uint64_t jpmorgan::PublishedExchange::getVersion() const { return published.load().version; }
+size_t jpmorgan::PublishedExchange::capacity() const { return row_count; }
+
+#endif // PUBLISHED_HPP
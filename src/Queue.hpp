@@ -0,0 +1,113 @@
+#ifndef QUEUE_HPP
+#define QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace jpmorgan {
+
+// Bounded lock-free queue for many producers and just one consumer (D. Vyukov's design).
+// Every cell carries a sequence number telling whether it's ready to be written or read, so
+// producers only compete on one compare & swap and the consumer never does an atomic read-modify-write.
+
+// When the queue is full 'push' returns false: producers decide whether to retry or to drop.
+
+/**** PROPER INTERFACE *****/
+
+template<typename T>
+class MpscQueue
+{
+public:
+  explicit MpscQueue(size_t capacity = 1024); // rounded up to a power of two
+
+  MpscQueue(const MpscQueue&) =delete;
+  MpscQueue& operator=(const MpscQueue&) =delete;
+
+  inline bool push(const T& element); // any thread
+  inline bool pop(T& element); // only the consumer thread
+
+  inline size_t capacity() const;
+
+private:
+  struct cell {
+    std::atomic<size_t> sequence {0};
+    T data {};
+  };
+
+  static constexpr size_t cache_line {64};
+
+  std::unique_ptr<cell[]> buffer {};
+  size_t mask {0};
+
+  // producers & consumer positions kept on cache lines of their own, away from the read-only fields above
+  // (C++17 'new' honours the alignment, so queues on the heap get it as well)
+  alignas(cache_line) std::atomic<size_t> enqueue_position {0};
+  alignas(cache_line) size_t dequeue_position {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+template<typename T>
+jpmorgan::MpscQueue<T>::MpscQueue(size_t capacity)
+{
+   size_t size = 2;
+   while( size < capacity ) { size *= 2; }
+
+   buffer.reset( new cell[size] );
+   mask = size - 1;
+   for(size_t i=0; i<size; ++i) { buffer[i].sequence.store( i, std::memory_order_relaxed ); }
+}
+
+template<typename T>
+bool jpmorgan::MpscQueue<T>::push(const T& element)
+{
+   size_t position = enqueue_position.load( std::memory_order_relaxed );
+   cell* target {nullptr};
+
+   for(;;)
+   {
+      target = &buffer[ position & mask ];
+      size_t sequence = target->sequence.load( std::memory_order_acquire );
+      std::ptrdiff_t difference = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( position );
+
+      if( 0 == difference )
+      {
+         // free cell, try to claim it
+         if( enqueue_position.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) ) { break; }
+      }
+      else if( 0 > difference )
+      {
+         // the consumer hasn't read it yet: full
+         return false;
+      }
+      else
+      {
+         // another producer was faster
+         position = enqueue_position.load( std::memory_order_relaxed );
+      }
+   }
+
+   target->data = element;
+   target->sequence.store( position + 1, std::memory_order_release );
+   return true;
+}
+
+template<typename T>
+bool jpmorgan::MpscQueue<T>::pop(T& element)
+{
+   cell* source = &buffer[ dequeue_position & mask ];
+   if( source->sequence.load( std::memory_order_acquire ) != dequeue_position + 1 ) { return false; }
+
+   element = source->data;
+   source->sequence.store( dequeue_position + mask + 1, std::memory_order_release );
+   ++dequeue_position;
+   return true;
+}
+
+template<typename T>
+size_t jpmorgan::MpscQueue<T>::capacity() const { return ( mask + 1 ); }
+
+#endif // QUEUE_HPP
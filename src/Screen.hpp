@@ -0,0 +1,113 @@
+#ifndef SCREEN_HPP
+#define SCREEN_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Kernels.hpp"
+#include "Kinds.hpp"
+#include "Span.hpp"
+#include "Symbols.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Whole exchange screening, i.e. every 50ms over thousands of symbols. Dividend yields and P/E ratios
+// come from the exchange's own Common & Preferred columns and the 'divide' kernel, just like
+// GBCE::ratios, so rows go Common ones first; the screen only adds the VWAP of every stock and its
+// deviation from the price, out of the 'relativeDeviation' kernel. Stocks are read by the ids the kind
+// columns hold, all of them listed: no symbol lookup, no bounds check, no exception, no branch on the kind.
+
+// Columns are reused between snapshots, so a screen running all day doesn't allocate once warmed up.
+
+/**** PROPER INTERFACE *****/
+
+class ExchangeScreen
+{
+public:
+  enum metric_type : unsigned char { dividend_yield, p_e_ratio, vwap_deviation };
+
+  inline void snapshot(const GlobalBeverageCorporationExchange& gbce); // copies columns & calculates the metrics
+
+  // rows of the 'k' highest (or lowest) values, best first; NaN and infinite rows (no price yet,
+  // no dividend) are never selected
+  inline void top(metric_type metric, size_t k, std::vector<size_t>& rows, bool highest = true) const;
+
+  inline size_t size() const;
+  inline bool empty() const;
+  inline SymbolId getSymbolId(size_t row) const;
+  inline span<const SymbolId> ids() const;
+  inline span<const double> prices() const;
+  inline span<const double> vwaps() const; // window 0 stock price
+  inline span<const double> values(metric_type metric) const;
+
+private:
+  template<typename Columns>
+  inline void copy(const Columns& columns, size_t first);
+
+  std::vector<SymbolId> row_ids {};
+  std::vector<double> row_prices {};
+  std::vector<double> row_vwaps {};
+  std::vector<double> metrics[3] {}; // by metric_type
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+// rows [first, first + columns.size())
+template<typename Columns>
+void jpmorgan::ExchangeScreen::copy(const Columns& columns, size_t first)
+{
+   std::copy( columns.ids().begin(), columns.ids().end(), row_ids.begin() + first );
+   std::copy( columns.prices().begin(), columns.prices().end(), row_prices.begin() + first );
+   columns.dividendYields( span<double>{ metrics[dividend_yield].data() + first, columns.size() } );
+   columns.p_e_ratios( span<double>{ metrics[p_e_ratio].data() + first, columns.size() } );
+}
+
+void jpmorgan::ExchangeScreen::snapshot(const GlobalBeverageCorporationExchange& gbce)
+{
+   const CommonColumns& commons = gbce.getCommons();
+   const PreferredColumns& preferreds = gbce.getPreferreds();
+   size_t n = commons.size() + preferreds.size();
+   for(auto* column : { &row_prices, &row_vwaps, &metrics[0], &metrics[1], &metrics[2] }) { column->resize( n ); }
+   row_ids.resize( n );
+
+   copy( commons, 0 );
+   copy( preferreds, commons.size() );
+
+   timestamp right_now = gbce.getClock().now(); // the same 'now' for every stock
+   for(size_t row=0; row<n; ++row) { row_vwaps[row] = gbce[ row_ids[row] ].stockPrice( right_now ); }
+
+   // NaN until the stock trades inside its window
+   relativeDeviation( row_prices.data(), row_vwaps.data(), metrics[vwap_deviation].data(), n );
+}
+
+// partial selection over row numbers, O(n + k log k)
+void jpmorgan::ExchangeScreen::top(metric_type metric, size_t k, std::vector<size_t>& rows, bool highest) const
+{
+   const std::vector<double>& value = metrics[metric];
+
+   rows.clear();
+   for(size_t row=0; row<value.size(); ++row) { if( std::isfinite( value[row] ) ) { rows.push_back( row ); } }
+
+   auto better = [&value, highest](size_t a, size_t b) { return ( highest ? value[a] > value[b] : value[a] < value[b] ); };
+   if( k < rows.size() )
+   {
+      std::nth_element( rows.begin(), rows.begin() + k, rows.end(), better );
+      rows.resize( k );
+   }
+   std::sort( rows.begin(), rows.end(), better );
+}
+
+size_t jpmorgan::ExchangeScreen::size() const { return row_ids.size(); }
+bool jpmorgan::ExchangeScreen::empty() const { return row_ids.empty(); }
+jpmorgan::SymbolId jpmorgan::ExchangeScreen::getSymbolId(size_t row) const { return row_ids[row]; }
+jpmorgan::span<const jpmorgan::SymbolId> jpmorgan::ExchangeScreen::ids() const { return row_ids; }
+jpmorgan::span<const double> jpmorgan::ExchangeScreen::prices() const { return row_prices; }
+jpmorgan::span<const double> jpmorgan::ExchangeScreen::vwaps() const { return row_vwaps; }
+jpmorgan::span<const double> jpmorgan::ExchangeScreen::values(metric_type metric) const { return metrics[metric]; }
+
+#endif // SCREEN_HPP
@@ -0,0 +1,89 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace jpmorgan {
+
+// A value written by one thread and read by any number of them (sequence lock). The writer never
+// waits: the sequence is odd while a store is going on and moves on by two for every store. Readers
+// never write anything shared, so dozens of them polling don't fight over a cache line; they just
+// copy the value and try again in the rare case the sequence moved meanwhile.
+
+// The value is kept as relaxed atomic words, so a reader overlapping a store is no data race: its
+// copy is simply thrown away (H. Boehm, "Can Seqlocks Get Along With Programming Language Memory Models?").
+
+/**** PROPER INTERFACE *****/
+
+template<typename T>
+class SeqLock
+{
+  static_assert( std::is_trivially_copyable<T>::value, "values are copied word by word" );
+
+public:
+  SeqLock() = default;
+  inline explicit SeqLock(const T& value);
+
+  SeqLock(const SeqLock&) =delete;
+  SeqLock& operator=(const SeqLock&) =delete;
+
+  inline void store(const T& value); // only the writer thread
+  inline T load() const; // any thread
+
+  inline std::uint64_t getSequence() const; // stores so far times two, odd while storing
+
+private:
+  static constexpr size_t words = ( sizeof(T) + sizeof(std::uint64_t) - 1 ) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint64_t> sequence {0};
+  std::atomic<std::uint64_t> data[words] {};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+template<typename T>
+jpmorgan::SeqLock<T>::SeqLock(const T& value) { store( value ); }
+
+template<typename T>
+void jpmorgan::SeqLock<T>::store(const T& value)
+{
+   std::uint64_t buffer[words] {};
+   std::memcpy( buffer, &value, sizeof(T) );
+
+   std::uint64_t current = sequence.load( std::memory_order_relaxed );
+   sequence.store( current + 1, std::memory_order_relaxed );
+   std::atomic_thread_fence( std::memory_order_release );
+
+   for(size_t w=0; w<words; ++w) { data[w].store( buffer[w], std::memory_order_relaxed ); }
+
+   sequence.store( current + 2, std::memory_order_release );
+}
+
+template<typename T>
+T jpmorgan::SeqLock<T>::load() const
+{
+   std::uint64_t buffer[words];
+   std::uint64_t before {0};
+   do
+   {
+      before = sequence.load( std::memory_order_acquire );
+      for(size_t w=0; w<words; ++w) { buffer[w] = data[w].load( std::memory_order_relaxed ); }
+      std::atomic_thread_fence( std::memory_order_acquire );
+   }
+   while( ( before & 1 ) || before != sequence.load( std::memory_order_relaxed ) );
+
+   T result;
+   std::memcpy( &result, buffer, sizeof(T) );
+   return result;
+}
+
+template<typename T>
+std::uint64_t jpmorgan::SeqLock<T>::getSequence() const { return sequence.load( std::memory_order_acquire ); }
+
+#endif // SEQLOCK_HPP
@@ -0,0 +1,307 @@
+#ifndef SHARDEDGBCE_HPP
+#define SHARDEDGBCE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Exceptions.hpp"
+#include "Symbols.hpp"
+#include "Clock.hpp"
+#include "Queue.hpp"
+#include "ConcurrentGBCE.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Several exchanges, one per worker thread, each one owning a partition of the stocks: symbol 'id'
+// lives in shard 'id % shards'. Producers route every trade or price to the owning shard through
+// its bounded lock-free queue; no stock is ever touched by two threads.
+
+// Every shard applies its queue in batches while holding its own mutex, the only one readers take,
+// so a query waits for at most one batch of one shard. The All Share Index adds up the logarithm
+// sums of every shard: exp( (s1 + ... + sn) / (c1 + ... + cn) ).
+
+// Stocks must be listed and settings made before 'start'. Trades are stamped by the exchange clock when
+// pushed, so neither a busy worker nor a late 'sync' after 'stop' moves them in their windows. That clock
+// is read on the producer's thread: a coarse or manual one may still be refreshed or moved meanwhile.
+
+/**** PROPER INTERFACE *****/
+
+class ShardedExchange
+{
+public:
+  inline explicit ShardedExchange(size_t shards = std::thread::hardware_concurrency(), size_t queue_capacity = 4096);
+  inline ~ShardedExchange(); // stops the workers
+
+  ShardedExchange(const ShardedExchange&) =delete;
+  ShardedExchange& operator=(const ShardedExchange&) =delete;
+
+  // before start
+  inline SymbolId addStock(std::string_view symbol, double last_dividend, double par_value, double fixed_dividend = 0.0);
+  inline void setBorder( std::chrono::milliseconds new_border );
+  inline void setClock( const Clock& clock ); // every shard, it must outlive this exchange
+  inline void setPrice(SymbolId id, double price);
+
+  inline void start(bool pin = true); // one worker per shard, pinned to a core when possible
+  inline void stop(); // applies whatever is pending first
+
+  // producers, any thread: false when the owning shard's queue is full
+  inline bool pushTrade(SymbolId id, unsigned long quantity, bool indicator);
+  inline bool pushPrice(SymbolId id, double price);
+  inline SymbolId getSymbolId(std::string_view symbol) const;
+
+  // readers, any thread
+  inline void sync(); // waits until everything pushed so far is applied
+  inline double stockPrice(SymbolId id);
+  inline double getPrice(SymbolId id);
+  inline size_t getTradeSize(SymbolId id);
+  inline double allShareIndex();
+
+  inline size_t getShardCount() const;
+  inline size_t size() const;
+
+private:
+  struct routed_event {
+     SymbolId id {0}; // inside the shard
+     ingest_event event {};
+  };
+
+  struct shard {
+     explicit shard(size_t queue_capacity) : queue{queue_capacity} {}
+
+     GlobalBeverageCorporationExchange exchange {};
+     MpscQueue<routed_event> queue;
+     std::mutex mutex {};
+     std::thread worker {};
+     std::atomic<unsigned long long> pushed {0};
+     std::atomic<unsigned long long> applied {0};
+  };
+
+  static constexpr size_t batch_size = 256;
+
+  inline shard& owner(SymbolId id) const;
+  inline SymbolId local(SymbolId id) const;
+  inline bool push(SymbolId id, const ingest_event& event);
+  inline size_t apply(shard& s); // mutex already taken
+  inline void run(shard& s);
+
+  SymbolTable symbols {};
+  std::vector<std::unique_ptr<shard>> shards {};
+  std::atomic<bool> running {false};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::ShardedExchange::ShardedExchange(size_t n, size_t queue_capacity)
+{
+   if( 0 == n ) { n = 1; }
+   for(size_t i=0; i<n; ++i) { shards.emplace_back( new shard( queue_capacity ) ); }
+}
+
+jpmorgan::ShardedExchange::~ShardedExchange() { stop(); }
+
+jpmorgan::ShardedExchange::shard& jpmorgan::ShardedExchange::owner(SymbolId id) const
+{
+   if( id >= symbols.size() ) { throw stock_non_found(); }
+   return *shards[ id % shards.size() ];
+}
+
+// stocks are listed round robin, so ids inside a shard go 0, 1, 2...
+jpmorgan::SymbolId jpmorgan::ShardedExchange::local(SymbolId id) const { return static_cast<SymbolId>( id / shards.size() ); }
+
+jpmorgan::SymbolId jpmorgan::ShardedExchange::addStock(std::string_view symbol, double last_dividend, double par_value, double fixed_dividend)
+{
+   SymbolId id {};
+   if( symbols.find( symbol, id ) ) { return id; }
+
+   shard& s = *shards[ symbols.size() % shards.size() ];
+   std::lock_guard<std::mutex> lock( s.mutex );
+   s.exchange.addStock( symbol, last_dividend, par_value, fixed_dividend );
+   return symbols.intern( symbol );
+}
+
+void jpmorgan::ShardedExchange::setBorder( std::chrono::milliseconds new_border )
+{
+   for(auto& s : shards) {
+      std::lock_guard<std::mutex> lock( s->mutex );
+      s->exchange.setBorder( new_border );
+   }
+}
+
+void jpmorgan::ShardedExchange::setClock( const Clock& clock )
+{
+   for(auto& s : shards) {
+      std::lock_guard<std::mutex> lock( s->mutex );
+      s->exchange.setClock( clock );
+   }
+}
+
+void jpmorgan::ShardedExchange::setPrice(SymbolId id, double price)
+{
+   shard& s = owner( id );
+   std::lock_guard<std::mutex> lock( s.mutex );
+   s.exchange.setPrice( local(id), price );
+}
+
+jpmorgan::SymbolId jpmorgan::ShardedExchange::getSymbolId(std::string_view symbol) const { return symbols.at( symbol ); }
+
+void jpmorgan::ShardedExchange::start(bool pin)
+{
+   if( running.exchange( true ) ) { return; }
+
+   unsigned int cores = std::max( 1u, std::thread::hardware_concurrency() );
+   for(size_t i=0; i<shards.size(); ++i)
+   {
+      shard& s = *shards[i];
+      s.worker = std::thread( [this, &s]() { run( s ); } );
+#ifdef __linux__
+      if( pin )
+      {
+         cpu_set_t cpus;
+         CPU_ZERO( &cpus );
+         CPU_SET( static_cast<int>( i % cores ), &cpus );
+         pthread_setaffinity_np( s.worker.native_handle(), sizeof(cpu_set_t), &cpus ); // best effort
+      }
+#else
+      (void) pin;
+      (void) cores;
+#endif
+   }
+}
+
+void jpmorgan::ShardedExchange::stop()
+{
+   if( !running.exchange( false ) ) { return; }
+   for(auto& s : shards) { if( s->worker.joinable() ) { s->worker.join(); } }
+}
+
+bool jpmorgan::ShardedExchange::push(SymbolId id, const ingest_event& event)
+{
+   shard& s = owner( id );
+   if( !s.queue.push( routed_event{ local(id), event } ) ) { return false; }
+   s.pushed.fetch_add( 1, std::memory_order_release );
+   return true;
+}
+
+bool jpmorgan::ShardedExchange::pushTrade(SymbolId id, unsigned long quantity, bool indicator)
+{
+   // the clock pointer only changes before start; the time of coarse & manual clocks is atomic, so
+   // their owner may refresh or move them while producers push
+   timestamp time = owner( id ).exchange.getClock().now();
+   return push( id, ingest_event{ ingest_event::trade, indicator, quantity, 0.0, time } );
+}
+
+bool jpmorgan::ShardedExchange::pushPrice(SymbolId id, double price)
+{
+   if( 0.0 > price ) { throw unexpected_negative_value(); }
+   return push( id, ingest_event{ ingest_event::price, false, 0, price } );
+}
+
+size_t jpmorgan::ShardedExchange::apply(shard& s)
+{
+   size_t n {0};
+   routed_event routed {};
+   while( n < batch_size && s.queue.pop( routed ) )
+   {
+      if( ingest_event::price == routed.event.kind ) { s.exchange.setPrice( routed.id, routed.event.value ); }
+      else { s.exchange.addTrade( routed.id, routed.event.time, routed.event.quantity, routed.event.indicator ); }
+      ++n;
+   }
+   if( 0 < n ) { s.applied.fetch_add( n, std::memory_order_release ); }
+   return n;
+}
+
+// spins while there is work, yields when idle; pending events are applied before leaving
+void jpmorgan::ShardedExchange::run(shard& s)
+{
+   size_t idle {0};
+   while( true )
+   {
+      bool more = running.load( std::memory_order_acquire );
+
+      size_t n {0};
+      {
+         std::lock_guard<std::mutex> lock( s.mutex );
+         n = apply( s );
+      }
+
+      if( 0 < n ) { idle = 0; continue; }
+      if( !more ) { break; }
+      if( ++idle < 64 ) { std::this_thread::yield(); } else { std::this_thread::sleep_for( std::chrono::microseconds(50) ); }
+   }
+}
+
+// without workers the caller applies the queues itself
+void jpmorgan::ShardedExchange::sync()
+{
+   for(auto& s : shards)
+   {
+      unsigned long long target = s->pushed.load( std::memory_order_acquire );
+      while( s->applied.load( std::memory_order_acquire ) < target )
+      {
+         if( running.load( std::memory_order_acquire ) ) { std::this_thread::yield(); continue; }
+         std::lock_guard<std::mutex> lock( s->mutex );
+         apply( *s );
+      }
+   }
+}
+
+double jpmorgan::ShardedExchange::stockPrice(SymbolId id)
+{
+   shard& s = owner( id );
+   std::lock_guard<std::mutex> lock( s.mutex );
+   return s.exchange.stockPrice( local(id) );
+}
+
+double jpmorgan::ShardedExchange::getPrice(SymbolId id)
+{
+   shard& s = owner( id );
+   std::lock_guard<std::mutex> lock( s.mutex );
+   return s.exchange.getPrice( local(id) );
+}
+
+size_t jpmorgan::ShardedExchange::getTradeSize(SymbolId id)
+{
+   shard& s = owner( id );
+   std::lock_guard<std::mutex> lock( s.mutex );
+   return s.exchange.at( local(id) ).getTradeSize();
+}
+
+// partial logarithm sums, one shard at a time
+double jpmorgan::ShardedExchange::allShareIndex()
+{
+   double log_sum {0.0};
+   size_t count {0};
+   size_t zero_prices {0};
+   for(auto& s : shards)
+   {
+      std::lock_guard<std::mutex> lock( s->mutex );
+      const ShareIndex& partial = s->exchange.getShareIndex();
+      log_sum += partial.getLogSum();
+      count += partial.size();
+      zero_prices += partial.getZeroPrices();
+   }
+
+   if( 0 == count || 0 < zero_prices ) { return 0.0; }
+   return std::exp( log_sum / count );
+}
+
+size_t jpmorgan::ShardedExchange::getShardCount() const { return shards.size(); }
+size_t jpmorgan::ShardedExchange::size() const { return symbols.size(); }
+
+#endif // SHARDEDGBCE_HPP
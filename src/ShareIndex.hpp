@@ -0,0 +1,111 @@
+#ifndef SHAREINDEX_HPP
+#define SHAREINDEX_HPP
+
+#include <cmath>
+#include <cstddef>
+
+#include "Exceptions.hpp"
+#include "Vwap.hpp"
+#include "Metrics.hpp"
+
+namespace jpmorgan {
+
+// All Share Index as the geometric mean of every stock price, kept in log space:
+// (p1 * p2 * ... * pn)^(1/n) = exp( (log p1 + ... + log pn) / n )
+// Each price tick just swaps one logarithm in a running (compensated) sum, so no pass over the
+// stocks is ever needed and there is no overflow multiplying thousands of prices.
+
+// Zero prices have no logarithm: they are counted apart and any of them makes the index zero,
+// as the product would. Stocks joining or leaving the index are handled the same way.
+
+/**** PROPER INTERFACE *****/
+
+class ShareIndex
+{
+public:
+  inline void add(double price); // a new stock
+  inline void remove(double price); // a stock leaving, with its current price
+  inline void update(double old_price, double new_price);
+  inline void clear();
+
+  inline double value() const; // zero when there are no stocks
+  inline bool hasChanged() const; // next 'value' recalculates
+  inline size_t size() const;
+  inline size_t getZeroPrices() const;
+  inline double getLogSum() const; // partial sums of several indexes can be combined, i.e. shards
+
+private:
+  compensated_sum log_sum {};
+  size_t count {0};
+  size_t zero_prices {0};
+
+  // exp() only when something changed
+  mutable bool changed {false};
+  mutable double last_value {0.0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+void jpmorgan::ShareIndex::add(double price)
+{
+   if( 0.0 > price ) { throw unexpected_negative_value(); }
+
+   if( 0.0 == price ) { ++zero_prices; } else { log_sum.add( std::log(price) ); }
+   ++count;
+   changed = true;
+}
+
+void jpmorgan::ShareIndex::remove(double price)
+{
+   if( 0 == count ) { return; }
+
+   // last one leaving: start again from an exact zero
+   if( 1 == count ) { clear(); return; }
+
+   if( 0.0 == price ) { --zero_prices; } else { log_sum.subtract( std::log(price) ); }
+   --count;
+   if( zero_prices == count ) { log_sum.reset(); } // no logarithm left at all
+   changed = true;
+}
+
+void jpmorgan::ShareIndex::update(double old_price, double new_price)
+{
+   if( 0.0 > new_price ) { throw unexpected_negative_value(); }
+   if( old_price == new_price ) { return; }
+
+   if( 0.0 == old_price ) { --zero_prices; } else { log_sum.subtract( std::log(old_price) ); }
+   if( 0.0 == new_price ) { ++zero_prices; } else { log_sum.add( std::log(new_price) ); }
+   if( zero_prices == count ) { log_sum.reset(); } // no logarithm left at all
+   changed = true;
+}
+
+void jpmorgan::ShareIndex::clear()
+{
+   log_sum.reset();
+   count = 0;
+   zero_prices = 0;
+   changed = true;
+}
+
+double jpmorgan::ShareIndex::value() const
+{
+   if( changed )
+   {
+      JPMORGAN_METRICS_COUNT( index_recomputes, 1 );
+      if( 0 == count || 0 < zero_prices ) { last_value = 0.0; }
+      else { last_value = std::exp( log_sum.value() / count ); }
+      changed = false;
+   }
+   else { JPMORGAN_METRICS_COUNT( index_cached, 1 ); }
+
+   return last_value;
+}
+
+size_t jpmorgan::ShareIndex::size() const { return count; }
+bool jpmorgan::ShareIndex::hasChanged() const { return changed; }
+size_t jpmorgan::ShareIndex::getZeroPrices() const { return zero_prices; }
+double jpmorgan::ShareIndex::getLogSum() const { return log_sum.value(); }
+
+#endif // SHAREINDEX_HPP
@@ -0,0 +1,214 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Feed.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Load generator for capacity planning: lists up to hundreds of thousands of stocks and pushes
+// trades & price ticks at a given rate of virtual time. The exchange runs on a manual clock moved
+// to every event, so a minute of trading takes whatever the engine needs and nothing more, while
+// windows, expiry & the All Share Index behave as they would in real time.
+
+// Four event streams, each one at its own pace and merged in time order:
+//  * trades on random stocks, at the stock's price (SyntheticFeed, so a seed always gives the same run)
+//  * price ticks on random stocks, either uniform or a random walk from the last price
+//  * All Share Index queries, i.e. a display refreshed every 50ms
+//  * clearOldTrades, as a housekeeping timer would
+
+/**** PROPER INTERFACE *****/
+
+struct simulation_config {
+   enum price_type : unsigned char { uniform, walk };
+
+   size_t symbols {1000};
+   double trade_rate {100000.0}; // per second of virtual time
+   double price_rate {10000.0};
+   std::chrono::milliseconds duration {60 * 1000}; // virtual
+   std::chrono::milliseconds window {_15min};
+   std::chrono::milliseconds index_interval {50};
+   std::chrono::milliseconds clear_interval {20};
+   price_type prices {walk};
+   std::uint64_t seed {0x5eed};
+};
+
+struct simulation_report {
+   size_t trades {0};
+   size_t price_ticks {0};
+   size_t index_queries {0};
+   size_t index_recomputes {0}; // queries after some price changed, the others are cached
+   size_t clears {0};
+   double virtual_seconds {0.0};
+   double wall_seconds {0.0};
+   size_t peak_rss_kb {0}; // whole process
+
+   inline double tradesPerSecond() const; // wall clock
+   inline double recomputesPerSecond() const;
+};
+
+// "--symbols 1000 --rate 100000 --price-rate 10000 --seconds 60 --window 900 --index-ms 50 --clear-ms 20 --price walk|uniform --seed 1"
+// throws unexpected_option, also for infinities and values past what the run can represent
+inline simulation_config parseSimulation(const std::vector<std::string>& options);
+
+inline simulation_report simulate(const simulation_config& config);
+
+inline size_t peakRssKb();
+
+// for the console
+inline std::ostream &operator<<(std::ostream &stream, const simulation_report& report)
+{
+   stream << "virtual time = " << report.virtual_seconds << " s, wall time = " << report.wall_seconds << " s" << std::endl;
+   stream << "trades = " << report.trades << ", " << report.tradesPerSecond() << " trades/s" << std::endl;
+   stream << "price ticks = " << report.price_ticks << ", clears = " << report.clears << std::endl;
+   stream << "index queries = " << report.index_queries << ", recomputes = " << report.index_recomputes << ", " << report.recomputesPerSecond() << " recomputes/s" << std::endl;
+   stream << "peak RSS = " << report.peak_rss_kb / 1024.0 << " MB" << std::endl;
+   return stream;
+}
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+double jpmorgan::simulation_report::tradesPerSecond() const { return ( 0.0 < wall_seconds ? trades / wall_seconds : 0.0 ); }
+double jpmorgan::simulation_report::recomputesPerSecond() const { return ( 0.0 < wall_seconds ? index_recomputes / wall_seconds : 0.0 ); }
+
+jpmorgan::simulation_config jpmorgan::parseSimulation(const std::vector<std::string>& options)
+{
+   // virtual time goes in nanoseconds of a long long, events at most one per nanosecond
+   constexpr double max_seconds {1e9};
+   constexpr double max_rate {1e9};
+   constexpr double max_symbols { static_cast<double>( std::numeric_limits<SymbolId>::max() ) };
+
+   simulation_config config {};
+   for(size_t i=0; i<options.size(); i+=2)
+   {
+      if( i + 1 >= options.size() ) { throw unexpected_option(); }
+      const std::string& name = options[i];
+      const std::string& value = options[i + 1];
+
+      char* end {nullptr};
+      double number = std::strtod( value.c_str(), &end );
+      bool numeric = ( !value.empty() && '\0' == *end && std::isfinite( number ) && 0.0 <= number );
+
+      if( "--price" == name )
+      {
+         if( "walk" == value ) { config.prices = simulation_config::walk; }
+         else if( "uniform" == value ) { config.prices = simulation_config::uniform; }
+         else { throw unexpected_option(); }
+      }
+      else if( "--seed" == name )
+      {
+         // every 64 bits of it, a double would only keep 53; strtoull alone takes signs and blanks
+         if( value.empty() || value.find_first_not_of( "0123456789" ) != std::string::npos ) { throw unexpected_option(); }
+         errno = 0;
+         unsigned long long seed = std::strtoull( value.c_str(), nullptr, 10 );
+         if( ERANGE == errno ) { throw unexpected_option(); }
+         config.seed = static_cast<std::uint64_t>( seed );
+      }
+      else if( !numeric ) { throw unexpected_option(); }
+      else if( "--symbols" == name && 1.0 <= number && number <= max_symbols ) { config.symbols = static_cast<size_t>( number ); }
+      else if( "--rate" == name && number <= max_rate ) { config.trade_rate = number; }
+      else if( "--price-rate" == name && number <= max_rate ) { config.price_rate = number; }
+      else if( "--seconds" == name && number <= max_seconds ) { config.duration = std::chrono::milliseconds( std::llround( number * 1000 ) ); }
+      else if( "--window" == name && 0.0 < number && number <= max_seconds ) { config.window = std::chrono::milliseconds( std::llround( number * 1000 ) ); }
+      else if( "--index-ms" == name && number <= max_seconds * 1000 ) { config.index_interval = std::chrono::milliseconds( std::llround( number ) ); }
+      else if( "--clear-ms" == name && number <= max_seconds * 1000 ) { config.clear_interval = std::chrono::milliseconds( std::llround( number ) ); }
+      else { throw unexpected_option(); }
+   }
+   return config;
+}
+
+// a zero rate or interval turns that stream off
+jpmorgan::simulation_report jpmorgan::simulate(const simulation_config& config)
+{
+   using nanoseconds = std::chrono::nanoseconds;
+
+   SyntheticFeed feed { config.seed };
+   Clock clock { Clock::manual };
+   GlobalBeverageCorporationExchange gbce;
+   gbce.setClock( clock );
+   gbce.setBorder( config.window );
+   for(size_t i=0; i<config.symbols; ++i)
+   {
+      SymbolId id = gbce.addStock( "S" + std::to_string(i), feed.price( 0.0, 20.0 ), 100.0, ( 0 == i % 5 ? 0.02 : 0.0 ) );
+      gbce.setPrice( id, feed.price( 1.0, 200.0 ) );
+   }
+
+   // next event of every stream, nanoseconds of virtual time since the start
+   const double never = std::numeric_limits<double>::infinity();
+   const double end = std::chrono::duration<double, std::nano>( config.duration ).count();
+   auto step = [never](double per_second) { return ( 0.0 < per_second ? 1e9 / per_second : never ); };
+   auto every = [never](std::chrono::milliseconds interval) { return ( 0 < interval.count() ? std::chrono::duration<double, std::nano>( interval ).count() : never ); };
+   const double trade_step = step( config.trade_rate ), price_step = step( config.price_rate );
+   const double index_step = every( config.index_interval ), clear_step = every( config.clear_interval );
+   double next_trade = ( never == trade_step ? never : 0.0 ), next_price = ( never == price_step ? never : 0.0 );
+   double next_index = index_step, next_clear = clear_step;
+
+   simulation_report report {};
+   timestamp start = clock.now();
+   auto wall_start = std::chrono::steady_clock::now();
+   for(;;)
+   {
+      double next = std::min( std::min( next_trade, next_price ), std::min( next_index, next_clear ) );
+      if( next >= end ) { break; }
+      clock.set( start + nanoseconds( static_cast<long long>( next ) ) );
+
+      if( next == next_trade )
+      {
+         gbce.addTrade( static_cast<SymbolId>( feed.index( config.symbols ) ), feed.quantity(), feed.indicator() );
+         ++report.trades;
+         next_trade = report.trades * trade_step;
+      }
+      else if( next == next_price )
+      {
+         SymbolId id = static_cast<SymbolId>( feed.index( config.symbols ) );
+         double price = ( simulation_config::walk == config.prices ? std::max( 0.01, gbce.getPrice(id) * ( 1.0 + 0.002 * ( 2.0 * feed.uniform() - 1.0 ) ) ) : feed.price( 1.0, 200.0 ) );
+         gbce.setPrice( id, price );
+         ++report.price_ticks;
+         next_price = report.price_ticks * price_step;
+      }
+      else if( next == next_index )
+      {
+         if( gbce.getShareIndex().hasChanged() ) { ++report.index_recomputes; }
+         gbce.allShareIndex();
+         ++report.index_queries;
+         next_index = ( report.index_queries + 1 ) * index_step;
+      }
+      else
+      {
+         gbce.clearOldTrades();
+         ++report.clears;
+         next_clear = ( report.clears + 1 ) * clear_step;
+      }
+   }
+
+   report.wall_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - wall_start ).count();
+   report.virtual_seconds = end / 1e9;
+   report.peak_rss_kb = peakRssKb();
+   return report;
+}
+
+size_t jpmorgan::peakRssKb()
+{
+   struct rusage usage {};
+   if( 0 != ::getrusage( RUSAGE_SELF, &usage ) ) { return 0; }
+   return static_cast<size_t>( usage.ru_maxrss ); // kilobytes on Linux
+}
+
+#endif // SIMULATION_HPP
@@ -0,0 +1,330 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Exceptions.hpp"
+#include "Symbols.hpp"
+#include "Span.hpp"
+#include "Journal.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Whole exchange state in one binary file, i.e. for a warm standby or a restart during the day:
+//
+//   snapshot_header                          32 bytes
+//   borders of every window                  i64 milliseconds each
+//   one snapshot_stock per id + its symbol   removed stocks too, so ids stay the same; padded to 8 bytes
+//   journal_record of every trade kept       stock by stock, then the current price of every stock
+//
+// Trades and prices are journal records on purpose: loading is just 'replay' over the mapped file,
+// which sizes every ring once and rebuilds the windows, the wheel and the All Share Index.
+
+// Capturing copies the exchange into memory, the only moment ingestion has to wait; writing the
+// file can then go on in the background. Two buffers are kept, so the next capture doesn't wait
+// for the previous file unless it's still being written when a third one is asked for.
+
+/**** PROPER INTERFACE *****/
+
+struct snapshot_header {
+   char magic[8] {};
+   std::uint32_t version {0};
+   std::uint32_t windows {0};
+   std::uint64_t stocks {0}; // ids, listed or not
+   std::uint64_t records {0};
+};
+
+struct snapshot_stock {
+   double last_dividend {0.0};
+   double par_value {0.0};
+   double fixed_dividend {0.0};
+   double price {0.0};
+   std::uint32_t symbol_length {0};
+   std::uint8_t listed {0};
+   std::uint8_t reserved[3] {};
+};
+
+static_assert( sizeof(snapshot_header) == 32, "snapshot headers are written as they are in memory" );
+static_assert( sizeof(snapshot_stock) == 40, "snapshot stocks are written as they are in memory" );
+
+static constexpr char snapshot_magic[8] = { 'G', 'B', 'C', 'E', 'S', 'N', 'A', 'P' };
+static constexpr std::uint32_t snapshot_version = 1;
+
+class SnapshotWriter
+{
+public:
+  SnapshotWriter() = default;
+  inline ~SnapshotWriter(); // waits for the file being written, if any
+
+  SnapshotWriter(const SnapshotWriter&) =delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) =delete;
+
+  inline void capture(const GlobalBeverageCorporationExchange& gbce);
+  // last capture, blocking; written aside and renamed, so 'path' is always whole. A background save is
+  // waited for first (its error thrown), so both never share the file aside and the latest one wins
+  inline void save(const std::string& path);
+  inline void saveInBackground(const std::string& path);
+  inline void wait(); // throws snapshot_io_error if the background save failed
+
+  inline span<const char> bytes() const; // last capture
+
+private:
+  static inline void write(const std::vector<char>& buffer, const std::string& path);
+
+  std::vector<char> buffers[2] {};
+  size_t last {0}; // buffer of the last capture
+  std::thread writer {};
+  size_t writing {0}; // buffer the writer is on
+  bool failed {false};
+};
+
+// read-only mapping of a snapshot file
+class SnapshotReader
+{
+public:
+  inline explicit SnapshotReader(const std::string& path);
+  inline ~SnapshotReader();
+
+  SnapshotReader(const SnapshotReader&) =delete;
+  SnapshotReader& operator=(const SnapshotReader&) =delete;
+
+  inline span<const char> bytes() const;
+
+private:
+  int file {-1};
+  char* base {nullptr};
+  size_t length {0};
+};
+
+// into a new exchange, no stock listed nor window added yet; nothing is journaled
+// throws unexpected_snapshot_format
+inline void restoreSnapshot(GlobalBeverageCorporationExchange& gbce, span<const char> bytes);
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+namespace jpmorgan {
+namespace snapshot {
+
+inline size_t padded(size_t bytes) { return ( bytes + 7 ) & ~static_cast<size_t>(7); }
+
+} // namespace snapshot
+} // namespace jpmorgan
+
+jpmorgan::SnapshotWriter::~SnapshotWriter()
+{
+   if( writer.joinable() ) { writer.join(); }
+}
+
+// sized first, so the buffer is allocated once and then just reused
+void jpmorgan::SnapshotWriter::capture(const GlobalBeverageCorporationExchange& gbce)
+{
+   size_t target = 1 - last;
+   if( writer.joinable() && writing == target ) { writer.join(); }
+
+   size_t stocks = gbce.getSlotCount();
+   size_t records {0};
+   size_t length = sizeof(snapshot_header) + gbce.getWindowCount() * sizeof(std::int64_t);
+   for(SymbolId id=0; id<stocks; ++id)
+   {
+      length += sizeof(snapshot_stock) + snapshot::padded( gbce.getSymbol(id).size() );
+      if( gbce.isListed(id) ) { records += gbce.at(id).getTradeSize() + 1; }
+   }
+   length += records * sizeof(journal_record);
+
+   std::vector<char>& buffer = buffers[target];
+   buffer.resize( length ); // no zeroing once it's big enough
+   char* p = buffer.data();
+
+   snapshot_header header {};
+   std::memcpy( header.magic, snapshot_magic, sizeof(snapshot_magic) );
+   header.version = snapshot_version;
+   header.windows = static_cast<std::uint32_t>( gbce.getWindowCount() );
+   header.stocks = stocks;
+   header.records = records;
+   std::memcpy( p, &header, sizeof(header) );
+   p += sizeof(header);
+
+   for(Trade::window_id w=0; w<gbce.getWindowCount(); ++w)
+   {
+      std::int64_t border = gbce.getBorder(w).count();
+      std::memcpy( p, &border, sizeof(border) );
+      p += sizeof(border);
+   }
+
+   for(SymbolId id=0; id<stocks; ++id)
+   {
+      const std::string& symbol = gbce.getSymbol(id);
+      snapshot_stock entry {};
+      entry.symbol_length = static_cast<std::uint32_t>( symbol.size() );
+      entry.listed = gbce.isListed(id);
+      if( entry.listed )
+      {
+         const Stock& stock = gbce.at(id);
+         entry.last_dividend = stock.getLastDividend();
+         entry.par_value = stock.getParValue();
+         entry.fixed_dividend = stock.getFixedDividend();
+         entry.price = stock.getPrice();
+      }
+      std::memcpy( p, &entry, sizeof(entry) );
+      std::memcpy( p + sizeof(entry), symbol.data(), symbol.size() );
+      std::memset( p + sizeof(entry) + symbol.size(), 0, snapshot::padded( symbol.size() ) - symbol.size() );
+      p += sizeof(entry) + snapshot::padded( symbol.size() );
+   }
+
+   journal_record record {};
+   for(SymbolId id=0; id<stocks; ++id)
+   {
+      if( !gbce.isListed(id) ) { continue; }
+      for(const auto& trade : gbce.at(id).getTrades())
+      {
+         record.setTimestamp( trade.first );
+         record.value = trade.second.price;
+         record.quantity = trade.second.quantity;
+         record.id = id;
+         record.kind = journal_record::trade;
+         record.indicator = trade.second.indicator;
+         std::memcpy( p, &record, sizeof(record) );
+         p += sizeof(record);
+      }
+   }
+
+   // prices last, trades already carry their own
+   for(SymbolId id=0; id<stocks; ++id)
+   {
+      if( !gbce.isListed(id) ) { continue; }
+      record = journal_record{};
+      record.value = gbce.getPrice(id);
+      record.id = id;
+      record.kind = journal_record::price;
+      std::memcpy( p, &record, sizeof(record) );
+      p += sizeof(record);
+   }
+
+   last = target;
+}
+
+jpmorgan::span<const char> jpmorgan::SnapshotWriter::bytes() const { return buffers[last]; }
+
+void jpmorgan::SnapshotWriter::write(const std::vector<char>& buffer, const std::string& path)
+{
+   std::string aside = path + ".tmp";
+   int file = ::open( aside.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+   if( 0 > file ) { throw snapshot_io_error(); }
+
+   const char* data = buffer.data();
+   size_t length = buffer.size();
+   while( 0 < length )
+   {
+      ssize_t written = ::write( file, data, length );
+      if( 0 > written ) { ::close( file ); throw snapshot_io_error(); }
+      data += written;
+      length -= static_cast<size_t>( written );
+   }
+
+   bool synced = ( 0 == ::fsync( file ) );
+   ::close( file );
+   if( !synced || 0 != std::rename( aside.c_str(), path.c_str() ) ) { throw snapshot_io_error(); }
+}
+
+void jpmorgan::SnapshotWriter::save(const std::string& path)
+{
+   wait();
+   write( buffers[last], path );
+}
+
+void jpmorgan::SnapshotWriter::saveInBackground(const std::string& path)
+{
+   wait();
+   writing = last;
+   failed = false;
+   writer = std::thread( [this, path]() {
+      try { write( buffers[writing], path ); } catch( ... ) { failed = true; }
+   });
+}
+
+void jpmorgan::SnapshotWriter::wait()
+{
+   if( writer.joinable() ) { writer.join(); }
+   if( failed ) { failed = false; throw snapshot_io_error(); }
+}
+
+jpmorgan::SnapshotReader::SnapshotReader(const std::string& path)
+{
+   file = ::open( path.c_str(), O_RDONLY );
+   if( 0 > file ) { throw snapshot_io_error(); }
+
+   struct stat status {};
+   if( 0 != ::fstat( file, &status ) ) { ::close( file ); throw snapshot_io_error(); }
+   length = static_cast<size_t>( status.st_size );
+   if( length < sizeof(snapshot_header) ) { ::close( file ); throw unexpected_snapshot_format(); }
+
+   void* address = ::mmap( nullptr, length, PROT_READ, MAP_SHARED, file, 0 );
+   if( MAP_FAILED == address ) { ::close( file ); throw snapshot_io_error(); }
+   base = static_cast<char*>( address );
+
+   ::madvise( base, length, MADV_SEQUENTIAL );
+}
+
+jpmorgan::SnapshotReader::~SnapshotReader()
+{
+   ::munmap( base, length );
+   ::close( file );
+}
+
+jpmorgan::span<const char> jpmorgan::SnapshotReader::bytes() const { return span<const char>{ base, length }; }
+
+// stocks are listed in id order and removed ones right away, so a symbol listed again after being
+// removed gets its later id back as well
+void jpmorgan::restoreSnapshot(GlobalBeverageCorporationExchange& gbce, span<const char> bytes)
+{
+   const char* p = bytes.data();
+   const char* end = bytes.data() + bytes.size();
+
+   snapshot_header header {};
+   if( bytes.size() < sizeof(header) ) { throw unexpected_snapshot_format(); }
+   std::memcpy( &header, p, sizeof(header) );
+   if( 0 != std::memcmp( header.magic, snapshot_magic, sizeof(snapshot_magic) ) || snapshot_version != header.version || 0 == header.windows ) { throw unexpected_snapshot_format(); }
+   p += sizeof(header);
+
+   if( static_cast<size_t>( end - p ) < header.windows * sizeof(std::int64_t) ) { throw unexpected_snapshot_format(); }
+   for(std::uint32_t w=0; w<header.windows; ++w, p += sizeof(std::int64_t))
+   {
+      std::int64_t border {0};
+      std::memcpy( &border, p, sizeof(border) );
+      if( 0 == w ) { gbce.setBorder( std::chrono::milliseconds( border ) ); } else { gbce.addWindow( std::chrono::milliseconds( border ) ); }
+   }
+
+   for(std::uint64_t id=0; id<header.stocks; ++id)
+   {
+      snapshot_stock entry {};
+      if( static_cast<size_t>( end - p ) < sizeof(entry) ) { throw unexpected_snapshot_format(); }
+      std::memcpy( &entry, p, sizeof(entry) );
+      p += sizeof(entry);
+      if( static_cast<size_t>( end - p ) < snapshot::padded( entry.symbol_length ) ) { throw unexpected_snapshot_format(); }
+
+      std::string_view symbol { p, entry.symbol_length };
+      p += snapshot::padded( entry.symbol_length );
+      if( id != gbce.addStock( symbol, entry.last_dividend, entry.par_value, entry.fixed_dividend ) ) { throw unexpected_snapshot_format(); }
+      if( !entry.listed ) { gbce.removeStock( static_cast<SymbolId>( id ) ); }
+   }
+
+   if( static_cast<size_t>( end - p ) != header.records * sizeof(journal_record) ) { throw unexpected_snapshot_format(); }
+   gbce.replay( span<const journal_record>{ reinterpret_cast<const journal_record*>( p ), static_cast<size_t>( header.records ) } );
+}
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,50 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cstddef>
+#include <vector>
+#include <array>
+
+namespace jpmorgan {
+
+// Just enough of C++20 std::span for C++17: a view over contiguous elements owned by someone else.
+
+/**** PROPER INTERFACE *****/
+
+template<typename T>
+class span
+{
+public:
+  using element_type = T;
+  using iterator = T*;
+
+  constexpr span() = default;
+  constexpr span(T* data, size_t size) : pointer{data}, length{size} {}
+  constexpr span(T* first, T* last) : pointer{first}, length{ static_cast<size_t>(last - first) } {}
+  template<size_t N>
+  constexpr span(T (&array)[N]) : pointer{array}, length{N} {}
+  template<typename U, typename Allocator>
+  span(std::vector<U, Allocator>& vector) : pointer{vector.data()}, length{vector.size()} {}
+  template<typename U, typename Allocator>
+  span(const std::vector<U, Allocator>& vector) : pointer{vector.data()}, length{vector.size()} {}
+  template<typename U, size_t N>
+  span(std::array<U, N>& array) : pointer{array.data()}, length{N} {}
+  template<typename U, size_t N>
+  span(const std::array<U, N>& array) : pointer{array.data()}, length{N} {}
+
+  constexpr T* data() const { return pointer; }
+  constexpr size_t size() const { return length; }
+  constexpr bool empty() const { return ( 0 == length ); }
+  constexpr T& operator[](size_t i) const { return pointer[i]; }
+  constexpr T* begin() const { return pointer; }
+  constexpr T* end() const { return pointer + length; }
+  constexpr span subspan(size_t offset, size_t count) const { return span{ pointer + offset, count }; }
+
+private:
+  T* pointer {nullptr};
+  size_t length {0};
+};
+
+} // namespace jpmorgan
+
+#endif // SPAN_HPP
@@ -3,13 +3,17 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
 #include <chrono>
 #include <string>
 #include <exception>
 #include <cmath>
 
 #include "Exceptions.hpp"
+#include "Clock.hpp"
+#include "Span.hpp"
 #include "Trade.hpp"
+#include "Bars.hpp"
 
 namespace jpmorgan {
 
@@ -19,6 +23,9 @@ namespace jpmorgan {
  
 // if the penalty of having that extra 'fixed dividend' double is greater than vtable and more complex implementation,
 // then this design should be changed.
+
+// Screens over the whole exchange don't pay the branch either: the exchange keeps Common and Preferred
+// stocks apart as compile-time kinds too (see Kinds.hpp) and calculates every ratio in bulk.
 	
 // As well composition with "Trade" class is chosen to simplify ctors and associated methods.
 
@@ -28,13 +35,13 @@ class Stock
 {
 public:
 
-  explicit Stock(std::string symbol, double last_dividend = 0.0, double par_value = 0.0, double fixed_dividend = 0.0); // possibly Preferred
+  inline explicit Stock(std::string symbol, double last_dividend = 0.0, double par_value = 0.0, double fixed_dividend = 0.0); // possibly Preferred
 
-  inline Stock();
-  inline Stock(const Stock&);
-  inline Stock(Stock&&);
-  inline Stock& operator=(const Stock&) =delete;
-  inline Stock&& operator=(Stock&&) =delete;
+  Stock() = default;
+  Stock(const Stock&) = default;
+  Stock(Stock&&) noexcept = default;
+  Stock& operator=(const Stock&) = default;
+  Stock& operator=(Stock&&) noexcept = default;
 
   inline std::string getSymbol() const;
   inline bool isCommon() const;
@@ -42,8 +49,22 @@ public:
 
   // for testing
   inline void setBorder( std::chrono::milliseconds new_border );
+  inline void setClock( const Clock& clock ); // it must outlive this stock
+  inline void setPool( BlockPool* pool ); // for its trades, it must outlive this stock
+
+  // extra windows over the same trades, i.e. 1s, 5s, 1m & 15m; window 0 is the one set by 'setBorder'
+  inline Trade::window_id addWindow( std::chrono::milliseconds border );
+  inline size_t getWindowCount() const;
+  inline window_stats windowStats( Trade::window_id w ) const;
+
+  // OHLCV bars fed by every trade, i.e. 1m bars for a day
+  using bars_id = size_t;
+  inline bars_id addBars( std::chrono::milliseconds interval, size_t capacity = 1024 );
+  inline const BarBuilder& getBars( bars_id b ) const;
+  inline void closeBars( const timestamp& right_now );
 
   inline size_t getTradeSize() const;
+  inline const Trade& getTrades() const;
   inline void setPrice(double price);
   inline double getPrice() const;
   inline void setLastDividend(double price);
@@ -52,13 +73,20 @@ public:
   inline double getFixedDividend() const;
   inline void setFixedDividendPercentage(double price);
   inline double getFixedDividendPercentage() const;
+  inline double getParValue() const;
 
   inline void addTrade(unsigned long quantity, bool indicator, double price);
   inline void addTrade(unsigned long quantity, bool indicator); // price private memeber of Stock class
+  inline void addTrade(const timestamp& time, unsigned long quantity, bool indicator, double price);
+  inline void addTrade(const timestamp& time, unsigned long quantity, bool indicator);
+  inline void addTrades(const timestamp& time, span<const trade_data> trades); // all or nothing
   inline double stockPrice() const;
+  inline double stockPrice(const timestamp& right_now) const; // i.e. one clock read for many stocks
   inline double stockPriceAndClear(); 
   inline void clearOldTrades();
+  inline void clearOldTrades(const timestamp& right_now);
   inline void clear();
+  inline void reserve(size_t trades); // in total, as for 'Trade'
 
   inline double dividendYield() const; // use price member as ticker price
   inline double dividendYield(double ticker_price) const;
@@ -67,10 +95,6 @@ public:
 
   inline friend std::ostream &operator<<(std::ostream &stream, const jpmorgan::Stock& stock);
 
-  // optimization for GBCE All Share Index
-  inline bool hasChanged( double exponent );
-  inline double getPricePow() const; 
-
 private:
 
   // only mutable at init 
@@ -78,6 +102,7 @@ private:
 
   // special functions
   Trade trade {};
+  std::vector<BarBuilder> bars {};
 
   // getters & setters
   double price {}; 
@@ -85,11 +110,6 @@ private:
   double fixed_dividend {0.0};
   double par_value {}; 
 
-  // optimization for GBCE All Share Index
-  double previous_exponent {};
-  double previous_price {};
-  double price_pow {};
-
 };
 
 // for debugging
@@ -113,67 +133,27 @@ std::ostream &operator<<(std::ostream &stream, const jpmorgan::Stock& stock)
 
 /****** INLINE FUNTIONS DEFINITIONS **********/
 
-jpmorgan::Stock::Stock()
-{
-  symbol= ""; 
-  trade = Trade{};
-  price = 0.0; 
-  last_dividend = 0.0;
-  fixed_dividend = 0.0;
-  par_value = 0.0; 
-  previous_exponent = 0.0;
-  previous_price = 0.0;
-  price_pow = 0.0;
-}
+void jpmorgan::Stock::setBorder( std::chrono::milliseconds new_border ) { trade.setBorder( new_border ); }
+void jpmorgan::Stock::setClock( const Clock& clock ) { trade.setClock( clock ); }
+void jpmorgan::Stock::setPool( BlockPool* pool ) { trade.setPool( pool ); }
 
-jpmorgan::Stock::Stock(const Stock& s)
-{
-  symbol= s.symbol; 
-  trade = s.trade;
-  price = s.price; 
-  last_dividend = s.last_dividend;
-  fixed_dividend = s.fixed_dividend;
-  par_value = s.par_value; 
-  previous_exponent = s.previous_exponent;
-  previous_price = s.previous_price;
-  price_pow = s.price_pow;
-}
+jpmorgan::Trade::window_id jpmorgan::Stock::addWindow( std::chrono::milliseconds border ) { return trade.addWindow( border ); }
+size_t jpmorgan::Stock::getWindowCount() const { return trade.getWindowCount(); }
+jpmorgan::window_stats jpmorgan::Stock::windowStats( Trade::window_id w ) const { return trade.stats( w ); }
 
-jpmorgan::Stock::Stock(Stock&& s)
+jpmorgan::Stock::bars_id jpmorgan::Stock::addBars( std::chrono::milliseconds interval, size_t capacity )
 {
-  symbol= s.symbol; 
-  trade = s.trade;
-  price = s.price; 
-  last_dividend = s.last_dividend;
-  fixed_dividend = s.fixed_dividend;
-  par_value = s.par_value; 
-  previous_exponent = s.previous_exponent;
-  previous_price = s.previous_price;
-  price_pow = s.price_pow;
+  bars.emplace_back( interval, capacity );
+  return bars.size() - 1;
 }
-
-void jpmorgan::Stock::setBorder( std::chrono::milliseconds new_border ) { trade.setBorder( new_border ); }
+const jpmorgan::BarBuilder& jpmorgan::Stock::getBars( bars_id b ) const { return bars.at(b); }
+void jpmorgan::Stock::closeBars( const timestamp& right_now ) { for(auto& builder : bars) { builder.close( right_now ); } }
 
 size_t jpmorgan::Stock::getTradeSize() const { return trade.size(); }
-
-// optimization for GBCE All Share Index
-bool jpmorgan::Stock::hasChanged( double exponent )
-{
-   bool changed = ( (exponent != previous_exponent) || (price != previous_price) );
-
-   if( changed )
-   {
-      previous_price = price;
-      previous_exponent = exponent;
-      price_pow = std::pow( price, exponent );
-   }
-
-   return changed;
-}
-double jpmorgan::Stock::getPricePow() const { return price_pow; } 
+const jpmorgan::Trade& jpmorgan::Stock::getTrades() const { return trade; }
 
 jpmorgan::Stock::Stock(std::string s, double l_d, double p_v, double f_d) :
- symbol{s}, trade{}, price{}, last_dividend{l_d}, fixed_dividend{f_d}, par_value{p_v}, previous_exponent{}, previous_price{}, price_pow{}
+ symbol{s}, trade{}, price{}, last_dividend{l_d}, fixed_dividend{f_d}, par_value{p_v}
 {
   if( symbol.empty() ) { throw unexpected_empty_string(); }
   if( 0.0 > last_dividend || 0.0 > par_value || 0.0 > fixed_dividend ) { throw unexpected_negative_value(); }
@@ -210,6 +190,7 @@ void jpmorgan::Stock::setFixedDividendPercentage(double d)
   fixed_dividend = ( d / 100.0 ); 
 }
 double jpmorgan::Stock::getFixedDividendPercentage() const { return ( fixed_dividend * 100.0 ); }
+double jpmorgan::Stock::getParValue() const { return par_value; }
 
 double jpmorgan::Stock::dividendYield(double ticker_price) const
 {
@@ -239,9 +220,22 @@ void jpmorgan::Stock::addTrade(unsigned long quantity, bool indicator, double p)
     if( 0.0 > quantity ) { throw unexpected_negative_value(); }
     if( 0.0 > p ) { throw unexpected_negative_value(); }
 
-    trade.addTrade(quantity, indicator, price);
+    addTrade(trade.getClock().now(), quantity, indicator, p);
 } 
 
+void jpmorgan::Stock::addTrade(const timestamp& time, unsigned long quantity, bool indicator, double p) // p->price
+{
+    if( 0.0 > p ) { throw unexpected_negative_value(); }
+
+    trade.addTrade(time, quantity, indicator, p);
+    for(auto& builder : bars) { builder.add(time, p, quantity); }
+}
+
+void jpmorgan::Stock::addTrade(const timestamp& time, unsigned long quantity, bool indicator)
+{
+    addTrade(time, quantity, indicator, this->price); // price private memeber of Stock class
+}
+
 void jpmorgan::Stock::addTrade(unsigned long quantity, bool indicator)
 {
     if( 0.0 > quantity ) { throw unexpected_negative_value(); }
@@ -250,9 +244,20 @@ void jpmorgan::Stock::addTrade(unsigned long quantity, bool indicator)
     addTrade(quantity, indicator, this->price); // price private memeber of Stock class
 } 
 
+void jpmorgan::Stock::addTrades(const timestamp& time, span<const trade_data> trades)
+{
+    for(const auto& data : trades) { if( 0.0 > data.price ) { throw unexpected_negative_value(); } }
+
+    trade.addTrades(time, trades);
+    for(auto& builder : bars) { for(const auto& data : trades) { builder.add(time, data.price, data.quantity); } }
+}
+
 double jpmorgan::Stock::stockPrice() const { return trade.stockPrice(); }
+double jpmorgan::Stock::stockPrice(const timestamp& right_now) const { return trade.stockPrice( right_now ); }
 double jpmorgan::Stock::stockPriceAndClear() { return trade.stockPriceAndClear(); }
 void jpmorgan::Stock::clearOldTrades() { trade.clearOldTrades(); }
+void jpmorgan::Stock::clearOldTrades(const timestamp& right_now) { trade.clearOldTrades( right_now ); }
 void jpmorgan::Stock::clear() { trade.clear(); }
+void jpmorgan::Stock::reserve(size_t trades) { trade.reserve( trades ); }
 
 #endif // STOCK_HPP
@@ -0,0 +1,229 @@
+#ifndef SUBSCRIPTIONS_HPP
+#define SUBSCRIPTIONS_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <string_view>
+
+#include "Exceptions.hpp"
+#include "Symbols.hpp"
+#include "Clock.hpp"
+#include "Queue.hpp"
+#include "GBCE.hpp"
+
+namespace jpmorgan {
+
+// Push side of an exchange: clients register for the All Share Index or the VWAP of given stocks and
+// only hear about them when the value moved beyond their threshold, instead of polling. The thread
+// owning the exchange calls 'notify' now and then (i.e. after every packet or from a timer); only
+// subscribed figures are looked at, at most once per call, so the cost follows subscriptions and not
+// trades.
+
+// Coalescing is per subscriber: once an update went out, its figure isn't even looked at until the
+// interval is over, then the next 'notify' sends a single update with the value of that moment, so a
+// burst of 10k trades gives one update per interval and costs next to nothing in between. A value
+// back within the threshold by then sends nothing at all.
+
+// Updates go either to a callback, run on the notifying thread, or into a lock-free queue drained by
+// the client's own thread; a full queue drops the update and counts it, the next 'notify' tries again.
+// Subscribing & unsubscribing belong to the notifying thread as well.
+
+/**** PROPER INTERFACE *****/
+
+struct change_update {
+   enum kind_type : unsigned char { index, vwap };
+
+   size_t subscription {0};
+   kind_type kind {index};
+   SymbolId id {0}; // vwap only
+   double value {0.0};
+   double previous {std::numeric_limits<double>::quiet_NaN()}; // last one sent to this subscriber, NaN on the first update
+   timestamp time {}; // exchange clock
+};
+
+struct subscription_options {
+   enum threshold_type : unsigned char { absolute, relative };
+
+   double threshold {0.0}; // zero means any change
+   threshold_type kind {absolute}; // relative to the last value sent, i.e. 0.001 for 10 basis points
+   std::chrono::milliseconds interval {0}; // at least between two updates, exchange clock
+};
+
+class ChangeNotifier
+{
+public:
+  using subscription_id = size_t;
+  using callback_type = std::function<void(const change_update&)>;
+  using queue_type = MpscQueue<change_update>;
+
+  inline explicit ChangeNotifier(const GlobalBeverageCorporationExchange& gbce); // it must outlive the notifier
+
+  ChangeNotifier(const ChangeNotifier&) =delete;
+  ChangeNotifier& operator=(const ChangeNotifier&) =delete;
+
+  inline subscription_id subscribeIndex(callback_type callback, const subscription_options& options = {});
+  inline subscription_id subscribeIndex(queue_type& queue, const subscription_options& options = {}); // it must outlive the subscription
+  // stocks must be listed, throws stock_non_found
+  inline subscription_id subscribeStock(std::string_view symbol, callback_type callback, const subscription_options& options = {});
+  inline subscription_id subscribeStock(SymbolId id, callback_type callback, const subscription_options& options = {});
+  inline subscription_id subscribeStock(std::string_view symbol, queue_type& queue, const subscription_options& options = {});
+  inline subscription_id subscribeStock(SymbolId id, queue_type& queue, const subscription_options& options = {});
+  inline void unsubscribe(subscription_id subscription); // even from its own callback
+
+  inline size_t notify(); // updates sent
+  inline size_t notify(const timestamp& right_now);
+
+  inline size_t size() const; // active subscriptions
+  inline size_t getDropped() const; // updates lost to full queues
+
+private:
+  struct subscription {
+     change_update::kind_type kind {change_update::index};
+     SymbolId id {0};
+     subscription_options options {};
+     callback_type callback {};
+     queue_type* queue {nullptr};
+     bool active {false};
+
+     // as last sent
+     double value {std::numeric_limits<double>::quiet_NaN()};
+     timestamp time {};
+  };
+
+  inline subscription_id add(subscription&& added);
+  static inline bool moved(const subscription& s, double value);
+
+  const GlobalBeverageCorporationExchange* gbce {nullptr};
+  std::deque<subscription> subscriptions {}; // ids are positions, never reused; callbacks may subscribe while running
+  size_t active {0};
+  size_t dropped {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::ChangeNotifier::ChangeNotifier(const GlobalBeverageCorporationExchange& exchange) : gbce(&exchange) {}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::add(subscription&& added)
+{
+   added.active = true;
+   subscriptions.push_back( std::move(added) );
+   ++active;
+   return subscriptions.size() - 1;
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeIndex(callback_type callback, const subscription_options& options)
+{
+   subscription added {};
+   added.options = options;
+   added.callback = std::move(callback);
+   return add( std::move(added) );
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeIndex(queue_type& queue, const subscription_options& options)
+{
+   subscription added {};
+   added.options = options;
+   added.queue = &queue;
+   return add( std::move(added) );
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeStock(std::string_view symbol, callback_type callback, const subscription_options& options)
+{
+   return subscribeStock( gbce->getSymbolId( symbol ), std::move(callback), options );
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeStock(SymbolId id, callback_type callback, const subscription_options& options)
+{
+   if( !gbce->isListed( id ) ) { throw stock_non_found(); }
+   subscription added {};
+   added.kind = change_update::vwap;
+   added.id = id;
+   added.options = options;
+   added.callback = std::move(callback);
+   return add( std::move(added) );
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeStock(std::string_view symbol, queue_type& queue, const subscription_options& options)
+{
+   return subscribeStock( gbce->getSymbolId( symbol ), queue, options );
+}
+
+jpmorgan::ChangeNotifier::subscription_id jpmorgan::ChangeNotifier::subscribeStock(SymbolId id, queue_type& queue, const subscription_options& options)
+{
+   if( !gbce->isListed( id ) ) { throw stock_non_found(); }
+   subscription added {};
+   added.kind = change_update::vwap;
+   added.id = id;
+   added.options = options;
+   added.queue = &queue;
+   return add( std::move(added) );
+}
+
+void jpmorgan::ChangeNotifier::unsubscribe(subscription_id id)
+{
+   if( id >= subscriptions.size() || !subscriptions[id].active ) { return; }
+   subscriptions[id].active = false;
+   --active;
+}
+
+bool jpmorgan::ChangeNotifier::moved(const subscription& s, double value)
+{
+   if( std::isnan( s.value ) ) { return true; } // nothing sent yet
+
+   double change = std::fabs( value - s.value );
+   if( 0.0 >= s.options.threshold ) { return ( 0.0 < change ); }
+   double limit = ( subscription_options::relative == s.options.kind ? s.options.threshold * std::fabs( s.value ) : s.options.threshold );
+   return ( change > limit );
+}
+
+size_t jpmorgan::ChangeNotifier::notify() { return notify( gbce->getClock().now() ); }
+
+size_t jpmorgan::ChangeNotifier::notify(const timestamp& right_now)
+{
+   // the index is looked at once whoever asks for it, and only when somebody does
+   bool index_read {false};
+   double index_value {0.0};
+
+   size_t sent {0};
+   // subscriptions added by callbacks wait for the next call
+   for(size_t i=0, n=subscriptions.size(); i<n; ++i)
+   {
+      subscription& s = subscriptions[i];
+      if( !s.active ) { continue; }
+      if( !std::isnan( s.value ) && right_now - s.time < s.options.interval ) { continue; }
+
+      double value {0.0};
+      if( change_update::index == s.kind )
+      {
+         if( !index_read ) { index_value = gbce->allShareIndex(); index_read = true; }
+         value = index_value;
+      }
+      else
+      {
+         if( !gbce->isListed( s.id ) ) { continue; }
+         value = gbce->at( s.id ).stockPrice( right_now );
+      }
+
+      if( !moved( s, value ) ) { continue; }
+
+      change_update update { i, s.kind, s.id, value, s.value, right_now };
+      if( nullptr != s.queue && !s.queue->push( update ) ) { ++dropped; continue; }
+
+      s.value = value;
+      s.time = right_now;
+      ++sent;
+      if( nullptr == s.queue ) { s.callback( update ); }
+   }
+   return sent;
+}
+
+size_t jpmorgan::ChangeNotifier::size() const { return active; }
+size_t jpmorgan::ChangeNotifier::getDropped() const { return dropped; }
+
+#endif // SUBSCRIPTIONS_HPP
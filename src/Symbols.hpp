@@ -0,0 +1,93 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Exceptions.hpp"
+
+namespace jpmorgan {
+
+// Tickers are turned into dense integer ids once, when the stock is listed, so that the hot path
+// is just an array index. Names are still searchable without building any std::string: the table
+// is a sorted flat vector looked up with std::string_view.
+
+/**** PROPER INTERFACE *****/
+
+using SymbolId = unsigned int;
+
+class SymbolTable
+{
+public:
+  inline SymbolId intern(std::string_view symbol); // new id only if not there yet
+  inline void erase(std::string_view symbol); // the id is never handed out again
+  inline bool find(std::string_view symbol, SymbolId& id) const;
+  inline SymbolId at(std::string_view symbol) const; // throws stock_non_found
+
+  inline const std::string& name(SymbolId id) const;
+  inline size_t size() const;
+
+private:
+  using entry = std::pair<std::string, SymbolId>;
+
+  inline std::vector<entry>::const_iterator lowerBound(std::string_view symbol) const;
+
+  std::vector<entry> sorted {}; // by name
+  std::vector<std::string> names {}; // by id
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+std::vector<jpmorgan::SymbolTable::entry>::const_iterator jpmorgan::SymbolTable::lowerBound(std::string_view symbol) const
+{
+   return std::lower_bound( sorted.cbegin(), sorted.cend(), symbol,
+                            [](const entry& e, std::string_view s) { return std::string_view{e.first} < s; } );
+}
+
+jpmorgan::SymbolId jpmorgan::SymbolTable::intern(std::string_view symbol)
+{
+   auto position = lowerBound( symbol );
+   if( sorted.cend() != position && position->first == symbol ) { return position->second; }
+
+   SymbolId id = static_cast<SymbolId>( names.size() );
+   names.emplace_back( symbol );
+   sorted.emplace( position, names.back(), id );
+   return id;
+}
+
+void jpmorgan::SymbolTable::erase(std::string_view symbol)
+{
+   auto position = lowerBound( symbol );
+   if( sorted.cend() != position && position->first == symbol ) { sorted.erase( position ); }
+}
+
+bool jpmorgan::SymbolTable::find(std::string_view symbol, SymbolId& id) const
+{
+   auto position = lowerBound( symbol );
+   if( sorted.cend() == position || position->first != symbol ) { return false; }
+
+   id = position->second;
+   return true;
+}
+
+jpmorgan::SymbolId jpmorgan::SymbolTable::at(std::string_view symbol) const
+{
+   SymbolId id {};
+   if( !find( symbol, id ) ) { throw stock_non_found(); }
+   return id;
+}
+
+const std::string& jpmorgan::SymbolTable::name(SymbolId id) const
+{
+   if( id >= names.size() ) { throw stock_non_found(); }
+   return names[id];
+}
+
+size_t jpmorgan::SymbolTable::size() const { return names.size(); }
+
+#endif // SYMBOLS_HPP
@@ -0,0 +1,191 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jpmorgan {
+
+// Work-stealing thread pool for coarse tasks, i.e. whole backtest runs of very different lengths.
+// Every worker has its own deque: tasks submitted from outside are dealt round robin, tasks
+// submitted by a task go to its worker's deque. A worker takes its newest task first (still warm in
+// its cache) and, once out of work, steals the oldest one of another worker, the biggest left.
+
+// Deques are guarded by a mutex each: with tasks of milliseconds or more nobody waits on them, and
+// there is no lock-free deque to get wrong. Only idle workers sleep on the pool-wide condition.
+
+/**** PROPER INTERFACE *****/
+
+class WorkStealingPool
+{
+public:
+  using task_type = std::function<void()>;
+
+  inline explicit WorkStealingPool(size_t threads = std::thread::hardware_concurrency()); // one at least
+  inline ~WorkStealingPool(); // runs whatever is left, then joins
+
+  WorkStealingPool(const WorkStealingPool&) =delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) =delete;
+
+  inline void submit(task_type task); // any thread
+  inline void wait(); // until every task submitted so far ran, not from a task; rethrows the first task exception
+
+  inline size_t size() const;
+  inline size_t getSteals() const;
+
+private:
+  struct worker {
+     std::mutex lock {};
+     std::deque<task_type> tasks {};
+  };
+
+  // which worker of which pool the calling thread is, if any
+  struct worker_mark {
+     const WorkStealingPool* pool {nullptr};
+     size_t index {0};
+  };
+
+  inline bool take(size_t self, task_type& task);
+  inline void run(size_t self);
+  static inline worker_mark& mark();
+
+  std::vector<std::unique_ptr<worker>> workers {};
+  std::vector<std::thread> threads {};
+
+  std::mutex sleeping {};
+  std::condition_variable wake {}; // workers: something queued or stopping
+  std::condition_variable idle {}; // 'wait': nothing pending
+  std::atomic<size_t> queued {0}; // in some deque
+  std::atomic<size_t> pending {0}; // queued or running
+  std::atomic<size_t> next {0}; // round robin
+  std::atomic<size_t> steals {0};
+  bool stopping {false};
+  std::exception_ptr failure {};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::WorkStealingPool::WorkStealingPool(size_t n)
+{
+   if( 0 == n ) { n = 1; }
+   for(size_t i=0; i<n; ++i) { workers.emplace_back( new worker() ); }
+   for(size_t i=0; i<n; ++i) { threads.emplace_back( [this, i]() { run(i); } ); }
+}
+
+jpmorgan::WorkStealingPool::~WorkStealingPool()
+{
+   {
+      std::lock_guard<std::mutex> guard( sleeping );
+      stopping = true;
+   }
+   wake.notify_all();
+   for(auto& thread : threads) { thread.join(); }
+}
+
+jpmorgan::WorkStealingPool::worker_mark& jpmorgan::WorkStealingPool::mark()
+{
+   static thread_local worker_mark current {};
+   return current;
+}
+
+void jpmorgan::WorkStealingPool::submit(task_type task)
+{
+   const worker_mark& self = mark();
+   size_t target = ( this == self.pool ? self.index : next.fetch_add( 1, std::memory_order_relaxed ) % workers.size() );
+
+   // counted before it can be taken, so counters never go below zero
+   pending.fetch_add( 1 );
+   queued.fetch_add( 1 );
+   {
+      std::lock_guard<std::mutex> guard( workers[target]->lock );
+      workers[target]->tasks.push_back( std::move(task) );
+   }
+
+   // a worker between checking 'queued' and sleeping still holds the mutex, so it can't miss this
+   { std::lock_guard<std::mutex> guard( sleeping ); }
+   wake.notify_one();
+}
+
+bool jpmorgan::WorkStealingPool::take(size_t self, task_type& task)
+{
+   {
+      std::lock_guard<std::mutex> guard( workers[self]->lock );
+      if( !workers[self]->tasks.empty() )
+      {
+         task = std::move( workers[self]->tasks.back() );
+         workers[self]->tasks.pop_back();
+         queued.fetch_sub( 1 );
+         return true;
+      }
+   }
+
+   for(size_t i=1; i<workers.size(); ++i)
+   {
+      worker& victim = *workers[( self + i ) % workers.size()];
+      std::lock_guard<std::mutex> guard( victim.lock );
+      if( !victim.tasks.empty() )
+      {
+         task = std::move( victim.tasks.front() );
+         victim.tasks.pop_front();
+         queued.fetch_sub( 1 );
+         steals.fetch_add( 1, std::memory_order_relaxed );
+         return true;
+      }
+   }
+   return false;
+}
+
+void jpmorgan::WorkStealingPool::run(size_t self)
+{
+   mark() = worker_mark{ this, self };
+
+   for(;;)
+   {
+      task_type task;
+      if( take( self, task ) )
+      {
+         try { task(); }
+         catch( ... ) {
+            std::lock_guard<std::mutex> guard( sleeping );
+            if( !failure ) { failure = std::current_exception(); }
+         }
+         if( 1 == pending.fetch_sub( 1 ) )
+         {
+            { std::lock_guard<std::mutex> guard( sleeping ); }
+            idle.notify_all();
+         }
+         continue;
+      }
+
+      std::unique_lock<std::mutex> guard( sleeping );
+      wake.wait( guard, [this]() { return stopping || 0 < queued.load(); } );
+      if( stopping && 0 == queued.load() ) { return; }
+   }
+}
+
+void jpmorgan::WorkStealingPool::wait()
+{
+   std::unique_lock<std::mutex> guard( sleeping );
+   idle.wait( guard, [this]() { return 0 == pending.load(); } );
+   if( failure )
+   {
+      std::exception_ptr rethrown = failure;
+      failure = nullptr;
+      std::rethrow_exception( rethrown );
+   }
+}
+
+size_t jpmorgan::WorkStealingPool::size() const { return workers.size(); }
+size_t jpmorgan::WorkStealingPool::getSteals() const { return steals.load( std::memory_order_relaxed ); }
+
+#endif // THREADPOOL_HPP
@@ -0,0 +1,70 @@
+#ifndef TICKS_HPP
+#define TICKS_HPP
+
+#include <cmath>
+#include <cstdint>
+
+namespace jpmorgan {
+
+// Prices as whole ticks, i.e. 1/10000 of a currency unit unless JPMORGAN_TICKS_PER_UNIT says otherwise.
+// Prices stay double at the API edge (trades, stocks, journal, feed); with JPMORGAN_TICK_PRICES every
+// window sums ticks x quantity into 128-bit integers instead, so adding and later subtracting a trade
+// gives back exactly what was there, whatever the order trades came in or left. A primary and its
+// standby fed the same trades then agree on every VWAP bit for bit.
+
+// 128 bits are far beyond any window: a million trades of 2^32 shares each, priced a million
+// currency units, add up to about 2^85 ticks.
+
+/**** PROPER INTERFACE *****/
+
+#ifndef JPMORGAN_TICKS_PER_UNIT
+#define JPMORGAN_TICKS_PER_UNIT 10000
+#endif
+
+using ticks = std::int64_t;
+__extension__ typedef __int128 notional; // ticks x quantity
+
+static constexpr ticks ticks_per_unit = JPMORGAN_TICKS_PER_UNIT;
+
+inline ticks toTicks(double price); // nearest tick, ties to even
+inline double toPrice(ticks price);
+inline double toPrice(notional value); // i.e. a price x quantity sum back to currency units
+
+// running sum of prices x quantities as ticks, see VwapWindow
+class tick_sum
+{
+public:
+  using value_type = notional;
+
+  static inline notional product(double price, unsigned long quantity);
+
+  inline void add(notional value);
+  inline void add(const tick_sum& other); // i.e. a batch
+  inline void subtract(notional value);
+  inline double value() const; // currency units
+  inline double divide(unsigned long long quantity) const; // value() / quantity without rounding value() first, i.e. a VWAP
+  inline notional getTicks() const;
+  inline void reset();
+private:
+  notional sum {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::ticks jpmorgan::toTicks(double price) { return static_cast<ticks>( std::lrint( price * ticks_per_unit ) ); }
+double jpmorgan::toPrice(ticks price) { return static_cast<double>( price ) / ticks_per_unit; }
+double jpmorgan::toPrice(notional value) { return static_cast<double>( value ) / ticks_per_unit; }
+
+jpmorgan::notional jpmorgan::tick_sum::product(double price, unsigned long quantity) { return static_cast<notional>( toTicks( price ) ) * quantity; }
+
+void jpmorgan::tick_sum::add(notional v) { sum += v; }
+void jpmorgan::tick_sum::add(const tick_sum& other) { sum += other.sum; }
+void jpmorgan::tick_sum::subtract(notional v) { sum -= v; }
+double jpmorgan::tick_sum::value() const { return toPrice( sum ); }
+double jpmorgan::tick_sum::divide(unsigned long long quantity) const { return static_cast<double>( sum ) / ( static_cast<double>( quantity ) * ticks_per_unit ); }
+jpmorgan::notional jpmorgan::tick_sum::getTicks() const { return sum; }
+void jpmorgan::tick_sum::reset() { sum = 0; }
+
+#endif // TICKS_HPP
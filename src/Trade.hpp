@@ -4,51 +4,105 @@
 #include <iostream>
 #include <chrono>
 #include <string>
-#include <map>
+#include <vector>
+#include <utility>
+
+#include "Vwap.hpp"
+#include "TradeStore.hpp"
+#include "Clock.hpp"
+#include "Span.hpp"
+#include "Metrics.hpp"
 
 namespace jpmorgan {
 
 /**** PROPER INTERFACE *****/
 
-// supposed just milliseconds precision
-static constexpr std::chrono::milliseconds _15min( 15 * 60 * 1000 ); 	
-static constexpr std::chrono::milliseconds _5sec( 5 * 1000 ); 	
-static constexpr std::chrono::milliseconds _500msec( 5 * 100 ); 	
-
-struct trade_data {
-   unsigned long quantity {0}; // quantity of shares
-   bool indicator {false}; // buy->false or sell->true
-   double price {0.0};
-  
-   inline friend std::ostream &operator<<(std::ostream &stream, const trade_data& data);
-};
-
-// for debugging
-std::ostream &operator<<(std::ostream &stream, const trade_data& data)
-{
-   stream << "quantity = " << data.quantity << ", ";
-   stream << "indicator = " << ( data.indicator ? "sell" : "buy" ) << ", ";
-   stream << "price = " << data.price;
+// rolling figures of one window, everything kept up to date trade by trade
+struct window_stats {
+   double stock_price {0.0}; // volume weighted
+   unsigned long long quantity {0};
+   unsigned long long buy_quantity {0};
+   unsigned long long sell_quantity {0};
+   size_t count {0};
 
-   return stream;
-}
+   inline double imbalance() const; // (buy - sell) / (buy + sell), zero when empty
+};
 
-using timestamp = std::chrono::time_point<std::chrono::system_clock>;
-using trade_pair = std::pair<timestamp, trade_data>;
+// trades are kept in arrival order, which is supposed to be time order as well
+// 'now' comes from an injectable clock (system clock by default) unless it's given explicitly
 
-class Trade : public std::multimap<timestamp, trade_data>
+// Several windows (i.e. 1s, 5s, 1m & 15m) can look at the same trades: each one just keeps where it
+// begins and its own running sums. Window 0 is the one set by 'setBorder' and used by 'stockPrice'.
+class Trade
 {
 public:
+  using const_iterator = TradeStore::const_iterator;
+  using window_id = size_t;
+
+  Trade() = default;
+  Trade(const Trade&) = default;
+  inline Trade(Trade&& other) noexcept; // 'other' is left empty, with just the default window
+  Trade& operator=(const Trade&) = default;
+  inline Trade& operator=(Trade&& other) noexcept;
+
   inline void addTrade(unsigned long quantity, bool indicator, double price);
+  inline void addTrade(const timestamp& time, unsigned long quantity, bool indicator, double price); // i.e. exchange timestamps
+  inline void addTrades(span<const trade_data> trades); // a whole batch sharing one clock read
+  inline void addTrades(const timestamp& time, span<const trade_data> trades);
   inline double stockPrice() const;
+  inline double stockPrice(const timestamp& right_now) const;
   inline void clearOldTrades();
+  inline void clearOldTrades(const timestamp& right_now);
   inline double stockPriceAndClear();
 
+  // everything about the trades inside the border calculated from scratch (SIMD kernels)
+  inline trade_summary summary() const;
+  inline trade_summary summary(const timestamp& right_now) const;
+
+  // the clock must outlive this trade
+  inline void setClock(const Clock& new_clock);
+  inline const Clock& getClock() const;
+
+  // trades stored on the pool from now on, null means heap; the pool must outlive this trade
+  inline void setPool(BlockPool* pool);
+
   inline friend std::ostream &operator<<(std::ostream &stream, const Trade& trade);
 
   inline void setBorder( std::chrono::milliseconds new_border );
+
+  inline window_id addWindow( std::chrono::milliseconds border ); // built from the trades still stored
+  inline size_t getWindowCount() const;
+  inline std::chrono::milliseconds getBorder( window_id w = 0 ) const;
+  inline window_stats stats( window_id w ) const;
+  inline window_stats stats( window_id w, const timestamp& right_now ) const;
+
+  inline size_t size() const;
+  inline bool empty() const;
+  inline void clear();
+  inline void reserve(size_t capacity);
+  inline const_iterator begin() const;
+  inline const_iterator end() const;
+
 private:
-  std::chrono::milliseconds border { _15min }; 
+  // trades before 'begin' are already out of the border and subtracted from the sums
+  struct rolling_window {
+     std::chrono::milliseconds border { _15min };
+     TradeStore::sequence begin {0};
+     VwapWindow<vwap_sum> sums {};
+     unsigned long long sell_quantity {0};
+  };
+
+  const Clock* clock { &Clock::systemClock() };
+
+  inline void expire( rolling_window& window, const timestamp& right_now ) const;
+  inline void rebuild( rolling_window& window ) const;
+  inline rolling_window& window( window_id w ) const; // throws std::out_of_range like 'at'
+  template<typename Function> inline void forEachWindow( Function function ) const;
+
+  // window 0 lives inline, so a moved from trade gets it back without touching the heap
+  TradeStore store {};
+  mutable rolling_window primary {};
+  mutable std::vector<rolling_window> windows {}; // window w is windows[w-1]
 };
 
 /********* INLINE FUNCTION DEFINITIONS ***********/
@@ -67,59 +121,209 @@ std::ostream &operator<<(std::ostream &stream, const Trade& trade)
 
 } // namespace jpmorgan
 
+// there is always a window 0, moved from trades included
+jpmorgan::Trade::Trade(Trade&& other) noexcept : clock{other.clock}, store{ std::move(other.store) }, primary{other.primary}, windows{}
+{
+   windows.swap( other.windows );
+   other.primary = rolling_window{};
+}
+
+jpmorgan::Trade& jpmorgan::Trade::operator=(Trade&& other) noexcept
+{
+   if( this == &other ) { return *this; }
+   clock = other.clock;
+   store = std::move( other.store );
+   primary = other.primary;
+   windows.clear();
+   windows.swap( other.windows ); // 'other' keeps the emptied buffer from here, if any
+   other.primary = rolling_window{};
+   return *this;
+}
+
+double jpmorgan::window_stats::imbalance() const
+{
+   unsigned long long total = buy_quantity + sell_quantity;
+   if( 0 == total ) { return 0.0; }
+   return ( ( static_cast<double>( buy_quantity ) - static_cast<double>( sell_quantity ) ) / static_cast<double>( total ) );
+}
+
+// a wider border could bring back trades already subtracted, so sums are rebuilt from scratch
+void jpmorgan::Trade::rebuild( rolling_window& window ) const
+{
+   window.sums.clear();
+   window.sell_quantity = 0;
+   for(TradeStore::sequence s = store.head(); s != store.tail(); ++s) {
+      window.sums.add( store.getPrice(s), store.getQuantity(s) );
+      if( store.getIndicator(s) ) { window.sell_quantity += store.getQuantity(s); }
+   }
+   window.begin = store.head();
+   expire( window, clock->now() );
+}
+
+jpmorgan::Trade::rolling_window& jpmorgan::Trade::window( window_id w ) const
+{
+   if( 0 == w ) { return primary; }
+   return windows.at( w - 1 );
+}
+
+template<typename Function>
+void jpmorgan::Trade::forEachWindow( Function function ) const
+{
+   function( primary );
+   for(auto& window : windows) { function( window ); }
+}
+
 // basically for testing faster
 void jpmorgan::Trade::setBorder( std::chrono::milliseconds new_border )
 {
-   border = new_border;
+   primary.border = new_border;
+   rebuild( primary );
 }
 
+jpmorgan::Trade::window_id jpmorgan::Trade::addWindow( std::chrono::milliseconds border )
+{
+   windows.push_back( rolling_window{ border } );
+   rebuild( windows.back() );
+   return windows.size();
+}
+
+size_t jpmorgan::Trade::getWindowCount() const { return 1 + windows.size(); }
+std::chrono::milliseconds jpmorgan::Trade::getBorder( window_id w ) const { return window(w).border; }
+
+jpmorgan::window_stats jpmorgan::Trade::stats( window_id w ) const { return stats( w, clock->now() ); }
+
+jpmorgan::window_stats jpmorgan::Trade::stats( window_id w, const timestamp& right_now ) const
+{
+   rolling_window& selected = window(w);
+   expire( selected, right_now );
+
+   window_stats result {};
+   result.stock_price = selected.sums.stockPrice();
+   result.quantity = selected.sums.getQuantity();
+   result.sell_quantity = selected.sell_quantity;
+   result.buy_quantity = result.quantity - result.sell_quantity;
+   result.count = selected.sums.getTradeSize();
+   return result;
+}
+
+void jpmorgan::Trade::setClock(const Clock& new_clock) { clock = &new_clock; }
+const jpmorgan::Clock& jpmorgan::Trade::getClock() const { return *clock; }
+
+void jpmorgan::Trade::setPool(BlockPool* pool) { store.setPool( pool ); }
+
 void jpmorgan::Trade::addTrade(unsigned long quantity, bool indicator, double price)
 {
-   emplace_hint( 
-              /* hint for the position */  end(), trade_pair{ 
-	      /* timestamp */              std::chrono::system_clock::now(), 
+   addTrade( clock->now(), quantity, indicator, price );
+}
+
+// a trade older than the last one is recorded with the last timestamp: time order can't be broken
+void jpmorgan::Trade::addTrade(const timestamp& time, unsigned long quantity, bool indicator, double price)
+{
+   JPMORGAN_METRICS_TIME( add_trade );
+   JPMORGAN_METRICS_COUNT( trades_in, 1 );
+
+   timestamp ordered = time;
+   if( !store.empty() && ordered < store.getTimestamp( store.tail() - 1 ) ) { ordered = store.getTimestamp( store.tail() - 1 ); }
+
+   store.push_back( 
+	      /* timestamp */              ordered, 
 	      /* trade data */             trade_data{ quantity, indicator, price }
-	    } );
+	    );
+
+   forEachWindow( [&](rolling_window& window) {
+      window.sums.add( price, quantity );
+      if( indicator ) { window.sell_quantity += quantity; }
+   } );
 }
 
-// take into account values in the past 15 minutes 
-double jpmorgan::Trade::stockPrice() const
+void jpmorgan::Trade::addTrades(span<const trade_data> trades)
+{
+   if( trades.empty() ) { return; }
+   addTrades( clock->now(), trades );
+}
+
+// the whole batch gets the same timestamp, storage grows at most once and the sums are touched once
+void jpmorgan::Trade::addTrades(const timestamp& time, span<const trade_data> trades)
 {
-   double s_trade_price_x_quantity {0.0};
-   double s_quantity {0.0};
+   if( trades.empty() ) { return; }
+   JPMORGAN_METRICS_COUNT( trades_in, trades.size() );
 
-   // empty supposed means zero result
-   if( this->empty() ) { return 0.0; }
+   timestamp ordered = time;
+   if( !store.empty() && ordered < store.getTimestamp( store.tail() - 1 ) ) { ordered = store.getTimestamp( store.tail() - 1 ); }
 
-   std::chrono::time_point<std::chrono::system_clock> right_now = std::chrono::system_clock::now();
+   store.reserve( store.size() + trades.size() );
 
-   for(const auto& element : *this)
+   vwap_sum s_pxq {}; // compensated like the windows, when they are
+   unsigned long long s_q {0};
+   unsigned long long s_sell {0};
+   for(const auto& data : trades)
    {
-       if( (right_now - element.first) >= border ) { continue; } 
-       s_trade_price_x_quantity += ( element.second.price * element.second.quantity );
-       s_quantity += element.second.quantity;
+      store.push_back( ordered, data );
+      s_pxq.add( vwap_sum::product( data.price, data.quantity ) );
+      s_q += data.quantity;
+      if( data.indicator ) { s_sell += data.quantity; }
    }
 
-   // denominator zero supposed means zero result
-   if( 0.0 >= s_quantity ) { return 0.0; }
+   forEachWindow( [&](rolling_window& window) {
+      window.sums.add( s_pxq, s_q, trades.size() );
+      window.sell_quantity += s_sell;
+   } );
+}
 
-   // numerator 
-   if( 0.0 >= s_trade_price_x_quantity ) { return 0.0; }
-   
-   return ( s_trade_price_x_quantity / s_quantity );
+// advance window begin over trades out of the border, amortized O(1) per trade and window
+void jpmorgan::Trade::expire( rolling_window& window, const timestamp& right_now ) const
+{
+   while( window.begin != store.tail() && (right_now - store.getTimestamp(window.begin)) >= window.border )
+   {
+       window.sums.subtract( store.getPrice(window.begin), store.getQuantity(window.begin) );
+       if( store.getIndicator(window.begin) ) { window.sell_quantity -= store.getQuantity(window.begin); }
+       ++window.begin;
+   }
 }
 
-// clear old trades in order to save memory
-void jpmorgan::Trade::clearOldTrades()
+// take into account values in the past 15 minutes 
+double jpmorgan::Trade::stockPrice() const { return stockPrice( clock->now() ); }
+
+double jpmorgan::Trade::stockPrice(const timestamp& right_now) const
 {
-   if( this->empty() ) { return; }
+   JPMORGAN_METRICS_TIME( stock_price );
+
+   // empty supposed means zero result
+   if( store.empty() ) { return 0.0; }
 
-   std::chrono::time_point<std::chrono::system_clock> right_now = std::chrono::system_clock::now();
+   expire( primary, right_now );
 
-   for(auto& element : *this)
-   {
-       if( (right_now - element.first) >= border ) { erase(element.first); }
-   }
+   return primary.sums.stockPrice();
+}
+
+jpmorgan::trade_summary jpmorgan::Trade::summary() const { return summary( clock->now() ); }
+
+jpmorgan::trade_summary jpmorgan::Trade::summary(const timestamp& right_now) const
+{
+   expire( primary, right_now );
+
+   return store.summarize( primary.begin, store.tail() );
+}
+
+// clear old trades in order to save memory
+void jpmorgan::Trade::clearOldTrades() { clearOldTrades( clock->now() ); }
+
+void jpmorgan::Trade::clearOldTrades(const timestamp& right_now)
+{
+   if( store.empty() ) { return; }
+
+   // everything before the begin of every window is already out of all borders
+   TradeStore::sequence oldest = store.tail();
+   forEachWindow( [&](rolling_window& window) {
+      expire( window, right_now );
+      if( window.begin < oldest ) { oldest = window.begin; }
+   } );
+#ifdef JPMORGAN_METRICS
+   size_t before = store.size();
+#endif
+   store.pop_front_until( oldest );
+   JPMORGAN_METRICS_COUNT( trades_expired, before - store.size() );
+   JPMORGAN_METRICS_RECORD( window_trades, store.tail() - primary.begin );
 }
 
 // clear used trades in order to save memory
@@ -130,4 +334,20 @@ double jpmorgan::Trade::stockPriceAndClear()
    return result;
 }
 
+void jpmorgan::Trade::clear()
+{
+   store.clear();
+   forEachWindow( [&](rolling_window& window) {
+      window.sums.clear();
+      window.sell_quantity = 0;
+      window.begin = store.head();
+   } );
+}
+
+size_t jpmorgan::Trade::size() const { return store.size(); }
+bool jpmorgan::Trade::empty() const { return store.empty(); }
+void jpmorgan::Trade::reserve(size_t capacity) { store.reserve( capacity ); }
+jpmorgan::Trade::const_iterator jpmorgan::Trade::begin() const { return store.begin(); }
+jpmorgan::Trade::const_iterator jpmorgan::Trade::end() const { return store.end(); }
+
 #endif // TRADE_HPP
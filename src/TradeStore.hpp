@@ -0,0 +1,352 @@
+#ifndef TRADESTORE_HPP
+#define TRADESTORE_HPP
+
+#include <iostream>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <cstring>
+#include <new>
+
+#include "Kernels.hpp"
+#include "Clock.hpp"
+#include "Pool.hpp"
+
+namespace jpmorgan {
+
+/**** PROPER INTERFACE *****/
+
+// supposed just milliseconds precision
+static constexpr std::chrono::milliseconds _15min( 15 * 60 * 1000 );
+static constexpr std::chrono::milliseconds _5sec( 5 * 1000 );
+static constexpr std::chrono::milliseconds _500msec( 5 * 100 );
+
+struct trade_data {
+   unsigned long quantity {0}; // quantity of shares
+   bool indicator {false}; // buy->false or sell->true
+   double price {0.0};
+
+   inline friend std::ostream &operator<<(std::ostream &stream, const trade_data& data);
+};
+
+// for debugging
+std::ostream &operator<<(std::ostream &stream, const trade_data& data)
+{
+   stream << "quantity = " << data.quantity << ", ";
+   stream << "indicator = " << ( data.indicator ? "sell" : "buy" ) << ", ";
+   stream << "price = " << data.price;
+
+   return stream;
+}
+
+using trade_pair = std::pair<timestamp, trade_data>;
+
+// Trades arrive already ordered by time, so there is no need for a tree: a growable ring buffer
+// keeps them contiguous, appends at the tail and forgets old ones by just advancing the head.
+
+// Every stored trade gets a 'sequence' number that never changes while it's alive, so positions
+// like the begin of a time window survive head advances and buffer growth.
+
+// The ring is split into columns (timestamp, price, quantity & indicator) so that calculations
+// only read the data they need and SIMD kernels can run straight on them. All the columns share one
+// block of memory, taken from the heap or from a BlockPool shared by the whole exchange.
+
+class TradeStore
+{
+public:
+  using sequence = unsigned long long;
+
+  class const_iterator;
+
+  TradeStore() = default;
+  inline TradeStore(const TradeStore& other);
+  inline TradeStore(TradeStore&& other) noexcept;
+  inline TradeStore& operator=(TradeStore other) noexcept; // copy & swap
+  inline ~TradeStore();
+  inline void swap(TradeStore& other) noexcept;
+
+  inline void setPool(BlockPool* new_pool); // null means heap; trades are kept
+  inline BlockPool* getPool() const;
+
+  inline void push_back(const timestamp& time, const trade_data& data);
+  inline void push_back(const trade_pair& trade);
+  inline void pop_front_until(sequence new_head); // forget everything before 'new_head'
+  inline void clear();
+  inline void reserve(size_t new_capacity);
+
+  inline trade_pair operator[](sequence s) const;
+  inline const timestamp& getTimestamp(sequence s) const;
+  inline double getPrice(sequence s) const;
+  inline unsigned long getQuantity(sequence s) const;
+  inline bool getIndicator(sequence s) const;
+
+  inline sequence head() const; // sequence of the oldest trade
+  inline sequence tail() const; // sequence the next pushed trade will get
+  inline sequence lowerBound(const timestamp& time) const; // first trade not older than 'time'
+
+  // whole calculations on [from, to) with the SIMD kernels
+  inline trade_summary summarize(sequence from, sequence to) const;
+
+  inline size_t size() const;
+  inline bool empty() const;
+  inline size_t capacity() const;
+
+  inline const_iterator begin() const;
+  inline const_iterator end() const;
+
+private:
+  inline void grow(size_t new_slots);
+
+  static inline size_t blockBytes(size_t slots);
+  inline char* allocateBlock(size_t slots) const;
+  inline void releaseBlock(char* old_block, size_t slots) const;
+  inline void bind(char* new_block, size_t new_slots); // columns point into the block
+
+  // [from, to) might wrap around the ring: at most two contiguous pieces
+  template<typename Function>
+  inline void forEachSegment(sequence from, sequence to, Function f) const;
+
+  BlockPool* pool {nullptr};
+  char* block {nullptr};
+  size_t slots {0}; // always a power of two
+
+  timestamp* timestamps {nullptr};
+  double* prices {nullptr};
+  std::uint64_t* quantities {nullptr};
+  std::uint8_t* indicators {nullptr};
+
+  size_t mask {0};
+  sequence first {0};
+  sequence last {0};
+};
+
+// trades are rebuilt from the columns, so it hands out values instead of references
+class TradeStore::const_iterator
+{
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = trade_pair;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = trade_pair;
+
+  const_iterator() = default;
+  const_iterator(const TradeStore* st, sequence sq) : store{st}, s{sq} {}
+
+  reference operator*() const { return (*store)[s]; }
+  const_iterator& operator++() { ++s; return *this; }
+  const_iterator operator++(int) { const_iterator it = *this; ++s; return it; }
+  difference_type operator-(const const_iterator& it) const { return static_cast<difference_type>(s - it.s); }
+
+  bool operator==(const const_iterator& it) const { return s == it.s; }
+  bool operator!=(const const_iterator& it) const { return s != it.s; }
+
+  sequence getSequence() const { return s; }
+
+private:
+  const TradeStore* store {nullptr};
+  sequence s {0};
+};
+
+} // namespace jpmorgan
+
+/****** INLINE FUNCTION DEFINITIONS **********/
+
+size_t jpmorgan::TradeStore::blockBytes(size_t n)
+{
+   return n * ( sizeof(timestamp) + sizeof(double) + sizeof(std::uint64_t) + sizeof(std::uint8_t) );
+}
+
+char* jpmorgan::TradeStore::allocateBlock(size_t n) const
+{
+   if( nullptr != pool ) { return static_cast<char*>( pool->allocate( blockBytes(n) ) ); }
+   return static_cast<char*>( ::operator new( blockBytes(n) ) );
+}
+
+void jpmorgan::TradeStore::releaseBlock(char* old_block, size_t n) const
+{
+   if( nullptr == old_block ) { return; }
+   if( nullptr != pool ) { pool->deallocate( old_block, blockBytes(n) ); } else { ::operator delete( old_block ); }
+}
+
+// widest columns first, every one of them stays aligned
+void jpmorgan::TradeStore::bind(char* new_block, size_t new_slots)
+{
+   block = new_block;
+   slots = new_slots;
+   mask = ( 0 < slots ? slots - 1 : 0 );
+   timestamps = reinterpret_cast<timestamp*>( block );
+   prices = reinterpret_cast<double*>( block + slots * sizeof(timestamp) );
+   quantities = reinterpret_cast<std::uint64_t*>( block + slots * ( sizeof(timestamp) + sizeof(double) ) );
+   indicators = reinterpret_cast<std::uint8_t*>( block + slots * ( sizeof(timestamp) + sizeof(double) + sizeof(std::uint64_t) ) );
+}
+
+// same capacity, so every trade keeps its position
+jpmorgan::TradeStore::TradeStore(const TradeStore& other) : pool{other.pool}, first{other.first}, last{other.last}
+{
+   if( 0 == other.slots ) { return; }
+   bind( allocateBlock( other.slots ), other.slots );
+   std::memcpy( block, other.block, blockBytes( slots ) );
+}
+
+jpmorgan::TradeStore::TradeStore(TradeStore&& other) noexcept { swap( other ); }
+
+jpmorgan::TradeStore& jpmorgan::TradeStore::operator=(TradeStore other) noexcept
+{
+   swap( other );
+   return *this;
+}
+
+jpmorgan::TradeStore::~TradeStore() { releaseBlock( block, slots ); }
+
+void jpmorgan::TradeStore::swap(TradeStore& other) noexcept
+{
+   std::swap( pool, other.pool );
+   std::swap( block, other.block );
+   std::swap( slots, other.slots );
+   std::swap( timestamps, other.timestamps );
+   std::swap( prices, other.prices );
+   std::swap( quantities, other.quantities );
+   std::swap( indicators, other.indicators );
+   std::swap( mask, other.mask );
+   std::swap( first, other.first );
+   std::swap( last, other.last );
+}
+
+void jpmorgan::TradeStore::setPool(BlockPool* new_pool)
+{
+   if( new_pool == pool ) { return; }
+
+   char* old_block = block;
+   BlockPool* old_pool = pool;
+
+   pool = new_pool;
+   if( 0 < slots )
+   {
+      char* new_block = allocateBlock( slots );
+      std::memcpy( new_block, old_block, blockBytes( slots ) );
+      bind( new_block, slots );
+   }
+
+   if( nullptr == old_block ) { return; }
+   if( nullptr != old_pool ) { old_pool->deallocate( old_block, blockBytes( slots ) ); } else { ::operator delete( old_block ); }
+}
+
+jpmorgan::BlockPool* jpmorgan::TradeStore::getPool() const { return pool; }
+
+void jpmorgan::TradeStore::push_back(const timestamp& time, const trade_data& data)
+{
+   if( size() == slots ) { grow( 0 == slots ? 16 : 2 * slots ); }
+
+   size_t position = static_cast<size_t>( last & mask );
+   timestamps[position] = time;
+   prices[position] = data.price;
+   quantities[position] = data.quantity;
+   indicators[position] = data.indicator;
+   ++last;
+}
+
+void jpmorgan::TradeStore::push_back(const trade_pair& trade) { push_back( trade.first, trade.second ); }
+
+void jpmorgan::TradeStore::pop_front_until(sequence new_head)
+{
+   if( new_head > last ) { new_head = last; }
+   if( new_head > first ) { first = new_head; }
+}
+
+// keep the buffer: once the biggest window has been seen there are no more allocations
+void jpmorgan::TradeStore::clear() { first = last; }
+
+// straight to the next power of two: a single allocation & copy whatever the size asked for
+void jpmorgan::TradeStore::reserve(size_t new_capacity)
+{
+   if( slots >= new_capacity ) { return; }
+
+   size_t new_slots = ( 0 == slots ? 16 : slots );
+   while( new_slots < new_capacity ) { new_slots *= 2; }
+   grow( new_slots );
+}
+
+// trades are moved in order so that 'sequence & mask' is still their position
+void jpmorgan::TradeStore::grow(size_t new_slots)
+{
+   TradeStore grown {};
+   grown.pool = pool;
+   grown.bind( allocateBlock( new_slots ), new_slots );
+   grown.first = first;
+   grown.last = last;
+
+   for(sequence s = first; s != last; ++s)
+   {
+      size_t from = static_cast<size_t>( s & mask );
+      size_t to = static_cast<size_t>( s & grown.mask );
+      grown.timestamps[to] = timestamps[from];
+      grown.prices[to] = prices[from];
+      grown.quantities[to] = quantities[from];
+      grown.indicators[to] = indicators[from];
+   }
+
+   swap( grown ); // the old block goes with 'grown'
+}
+
+jpmorgan::trade_pair jpmorgan::TradeStore::operator[](sequence s) const
+{
+   size_t position = static_cast<size_t>( s & mask );
+   return trade_pair{ timestamps[position], trade_data{ static_cast<unsigned long>(quantities[position]), indicators[position] != 0, prices[position] } };
+}
+
+const jpmorgan::timestamp& jpmorgan::TradeStore::getTimestamp(sequence s) const { return timestamps[ s & mask ]; }
+double jpmorgan::TradeStore::getPrice(sequence s) const { return prices[ s & mask ]; }
+unsigned long jpmorgan::TradeStore::getQuantity(sequence s) const { return static_cast<unsigned long>( quantities[ s & mask ] ); }
+bool jpmorgan::TradeStore::getIndicator(sequence s) const { return ( 0 != indicators[ s & mask ] ); }
+
+jpmorgan::TradeStore::sequence jpmorgan::TradeStore::head() const { return first; }
+jpmorgan::TradeStore::sequence jpmorgan::TradeStore::tail() const { return last; }
+
+// binary search, trades are in time order
+jpmorgan::TradeStore::sequence jpmorgan::TradeStore::lowerBound(const timestamp& time) const
+{
+   sequence low = first;
+   sequence high = last;
+   while( low < high )
+   {
+      sequence middle = low + ( high - low ) / 2;
+      if( getTimestamp(middle) < time ) { low = middle + 1; } else { high = middle; }
+   }
+   return low;
+}
+
+template<typename Function>
+void jpmorgan::TradeStore::forEachSegment(sequence from, sequence to, Function f) const
+{
+   if( from < first ) { from = first; }
+   if( to > last ) { to = last; }
+   if( from >= to ) { return; }
+
+   size_t begin = static_cast<size_t>( from & mask );
+   size_t n = static_cast<size_t>( to - from );
+   size_t first_piece = std::min( n, slots - begin );
+
+   f( begin, first_piece );
+   if( first_piece < n ) { f( 0, n - first_piece ); }
+}
+
+jpmorgan::trade_summary jpmorgan::TradeStore::summarize(sequence from, sequence to) const
+{
+   trade_summary result {};
+   forEachSegment( from, to, [&](size_t begin, size_t n) {
+      result.merge( jpmorgan::summarize( prices + begin, quantities + begin, indicators + begin, n ) );
+   });
+   return result;
+}
+
+size_t jpmorgan::TradeStore::size() const { return static_cast<size_t>( last - first ); }
+bool jpmorgan::TradeStore::empty() const { return ( first == last ); }
+size_t jpmorgan::TradeStore::capacity() const { return slots; }
+
+jpmorgan::TradeStore::const_iterator jpmorgan::TradeStore::begin() const { return const_iterator{ this, first }; }
+jpmorgan::TradeStore::const_iterator jpmorgan::TradeStore::end() const { return const_iterator{ this, last }; }
+
+#endif // TRADESTORE_HPP
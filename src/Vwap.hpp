@@ -0,0 +1,172 @@
+#ifndef VWAP_HPP
+#define VWAP_HPP
+
+#include <cstddef>
+#include <cmath>
+
+#include "Ticks.hpp"
+
+namespace jpmorgan {
+
+// Volume Weighted Stock Price kept as running sums: every trade is added once when it enters
+// the window and subtracted once when it ages out, so asking for the price never walks the trades.
+
+// Adding and subtracting the same doubles over and over lets rounding errors pile up, that's why
+// a compensated (Neumaier) summation is used by default. The plain one is there for those who prefer speed,
+// the integer one of Ticks.hpp for those who need exact and reproducible sums (JPMORGAN_TICK_PRICES).
+
+// Every sum tells how a price x quantity looks like to it ('value_type' & 'product'). Batches are
+// summed on their own and then merged, compensation and all, so they drift no more than trades added
+// one by one.
+
+/******** PROPER INTERFACE *************/
+
+class plain_sum
+{
+public:
+  using value_type = double;
+
+  static inline double product(double price, unsigned long quantity);
+
+  inline void add(double value);
+  inline void add(const plain_sum& other); // i.e. a batch
+  inline void subtract(double value);
+  inline double value() const;
+  inline double divide(unsigned long long quantity) const; // value() / quantity
+  inline void reset();
+private:
+  double sum {0.0};
+};
+
+class compensated_sum
+{
+public:
+  using value_type = double;
+
+  static inline double product(double price, unsigned long quantity);
+
+  inline void add(double value);
+  inline void add(const compensated_sum& other); // i.e. a batch
+  inline void subtract(double value);
+  inline double value() const;
+  inline double divide(unsigned long long quantity) const; // value() / quantity
+  inline void reset();
+private:
+  double sum {0.0};
+  double compensation {0.0}; // low-order bits lost by 'sum'
+};
+
+template<typename Sum = compensated_sum>
+class VwapWindow
+{
+public:
+  inline void add(double price, unsigned long quantity);
+  inline void add(const Sum& s_price_x_quantity, unsigned long long s_quantity, size_t n); // n trades at once, i.e. a batch
+  inline void subtract(double price, unsigned long quantity);
+  inline void clear();
+
+  inline double stockPrice() const;
+  inline unsigned long long getQuantity() const;
+  inline size_t getTradeSize() const;
+
+private:
+  Sum s_trade_price_x_quantity {};
+  unsigned long long s_quantity {0}; // integer quantities are summed exactly
+  size_t count {0};
+};
+
+#if defined(JPMORGAN_TICK_PRICES)
+using vwap_sum = tick_sum;
+#elif defined(JPMORGAN_PLAIN_SUMMATION)
+using vwap_sum = plain_sum;
+#else
+using vwap_sum = compensated_sum;
+#endif
+
+} // namespace jpmorgan
+
+/****** INLINE FUNCTION DEFINITIONS **********/
+
+double jpmorgan::plain_sum::product(double price, unsigned long quantity) { return price * quantity; }
+void jpmorgan::plain_sum::add(double v) { sum += v; }
+void jpmorgan::plain_sum::add(const plain_sum& other) { sum += other.sum; }
+void jpmorgan::plain_sum::subtract(double v) { sum -= v; }
+double jpmorgan::plain_sum::value() const { return sum; }
+double jpmorgan::plain_sum::divide(unsigned long long quantity) const { return sum / quantity; }
+void jpmorgan::plain_sum::reset() { sum = 0.0; }
+
+double jpmorgan::compensated_sum::product(double price, unsigned long quantity) { return price * quantity; }
+
+void jpmorgan::compensated_sum::add(double v)
+{
+   double t = sum + v;
+
+   // keep whatever got lost from the smaller operand
+   if( std::fabs(sum) >= std::fabs(v) ) { compensation += ( (sum - t) + v ); }
+   else { compensation += ( (v - t) + sum ); }
+
+   sum = t;
+}
+void jpmorgan::compensated_sum::add(const compensated_sum& other)
+{
+   add( other.sum );
+   compensation += other.compensation;
+}
+void jpmorgan::compensated_sum::subtract(double v) { add(-v); }
+double jpmorgan::compensated_sum::value() const { return ( sum + compensation ); }
+double jpmorgan::compensated_sum::divide(unsigned long long quantity) const { return value() / quantity; }
+void jpmorgan::compensated_sum::reset() { sum = 0.0; compensation = 0.0; }
+
+template<typename Sum>
+void jpmorgan::VwapWindow<Sum>::add(double price, unsigned long quantity)
+{
+   s_trade_price_x_quantity.add( Sum::product( price, quantity ) );
+   s_quantity += quantity;
+   ++count;
+}
+
+template<typename Sum>
+void jpmorgan::VwapWindow<Sum>::add(const Sum& s_pxq, unsigned long long s_q, size_t n)
+{
+   s_trade_price_x_quantity.add( s_pxq );
+   s_quantity += s_q;
+   count += n;
+}
+
+template<typename Sum>
+void jpmorgan::VwapWindow<Sum>::subtract(double price, unsigned long quantity)
+{
+   // an empty window is exactly zero, no matter what rounding says
+   if( 1 >= count ) { clear(); return; }
+
+   s_trade_price_x_quantity.subtract( Sum::product( price, quantity ) );
+   s_quantity -= quantity;
+   --count;
+}
+
+template<typename Sum>
+void jpmorgan::VwapWindow<Sum>::clear()
+{
+   s_trade_price_x_quantity.reset();
+   s_quantity = 0;
+   count = 0;
+}
+
+template<typename Sum>
+double jpmorgan::VwapWindow<Sum>::stockPrice() const
+{
+   // denominator zero supposed means zero result
+   if( 0 == s_quantity ) { return 0.0; }
+
+   if( 0.0 >= s_trade_price_x_quantity.value() ) { return 0.0; }
+
+   return s_trade_price_x_quantity.divide( s_quantity );
+}
+
+template<typename Sum>
+unsigned long long jpmorgan::VwapWindow<Sum>::getQuantity() const { return s_quantity; }
+
+template<typename Sum>
+size_t jpmorgan::VwapWindow<Sum>::getTradeSize() const { return count; }
+
+#endif // VWAP_HPP
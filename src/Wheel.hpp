@@ -0,0 +1,142 @@
+#ifndef WHEEL_HPP
+#define WHEEL_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "Clock.hpp"
+#include "Symbols.hpp"
+#include "TradeStore.hpp"
+
+namespace jpmorgan {
+
+// Timing wheel telling the exchange which stocks have trades going out of the border, so that clearing
+// old trades doesn't visit thousands of idle stocks. Time is cut into slots of border/256 and every
+// slot remembers which stocks got trades during it; once a whole slot is older than the border, just
+// those stocks are asked to forget their old trades and the slot is emptied, keeping its memory.
+
+// A single level is enough: every trade expires exactly one border after it arrived, so no deadline
+// is ever further away than the wheel is long. Being retired up to one slot late only delays freeing
+// memory, prices are still calculated on the exact border by every Trade.
+
+/**** PROPER INTERFACE *****/
+
+class ExpiryWheel
+{
+public:
+  inline explicit ExpiryWheel(std::chrono::milliseconds border = _15min);
+
+  inline void reset(std::chrono::milliseconds new_border); // forgets every slot
+  inline void insert(SymbolId id, const timestamp& time); // 'id' got trades at 'time'
+
+  // retire(id) for every stock with trades in slots already out of the border
+  template<typename Function>
+  inline void advance(const timestamp& right_now, Function retire);
+
+  inline size_t size() const; // pending (slot, stock) entries
+
+private:
+  using slot_number = long long;
+
+  static constexpr size_t slots_per_border = 256;
+  static constexpr size_t wheel_size = 512; // power of two, bigger than slots_per_border + 1
+
+  inline slot_number slotOf(const timestamp& time) const;
+
+  std::chrono::milliseconds border {_15min};
+  timestamp::duration resolution {};
+  std::vector<std::vector<SymbolId>> slots {};
+  std::vector<slot_number> last_slot {}; // by SymbolId, so a stock is recorded once per slot
+  slot_number next {0}; // oldest slot not retired yet
+  bool started {false};
+  size_t pending {0};
+};
+
+} // namespace jpmorgan
+
+/********* INLINE FUNCTION DEFINITIONS ***********/
+
+jpmorgan::ExpiryWheel::ExpiryWheel(std::chrono::milliseconds new_border) : slots( wheel_size )
+{
+   reset( new_border );
+}
+
+void jpmorgan::ExpiryWheel::reset(std::chrono::milliseconds new_border)
+{
+   border = new_border;
+   resolution = std::chrono::duration_cast<timestamp::duration>( border ) / slots_per_border;
+   if( resolution <= timestamp::duration::zero() ) { resolution = timestamp::duration{1}; }
+
+   for(auto& slot : slots) { slot.clear(); }
+   std::fill( last_slot.begin(), last_slot.end(), std::numeric_limits<slot_number>::min() );
+   started = false;
+   pending = 0;
+}
+
+jpmorgan::ExpiryWheel::slot_number jpmorgan::ExpiryWheel::slotOf(const timestamp& time) const
+{
+   return static_cast<slot_number>( time.time_since_epoch() / resolution );
+}
+
+void jpmorgan::ExpiryWheel::insert(SymbolId id, const timestamp& time)
+{
+   slot_number s = slotOf( time );
+
+   if( !started ) { next = s; started = true; }
+   if( s < next ) { s = next; } // already out of the border, goes with the next slot to retire
+
+   // nobody advanced the wheel for a whole border: old slots are merged into the oldest one still
+   // on the wheel, later than due but never earlier
+   if( s >= next + static_cast<slot_number>( wheel_size ) )
+   {
+      slot_number new_next = s - static_cast<slot_number>( wheel_size ) + 1;
+      std::vector<SymbolId>& target = slots[ new_next & ( wheel_size - 1 ) ];
+      for(slot_number k = next; k < new_next && k < next + static_cast<slot_number>( wheel_size ); ++k)
+      {
+         std::vector<SymbolId>& old = slots[ k & ( wheel_size - 1 ) ];
+         if( &old == &target ) { continue; }
+         target.insert( target.end(), old.begin(), old.end() );
+         old.clear();
+      }
+      next = new_next;
+
+      // once per stock is enough, so even a wheel never advanced stays as big as the stocks traded
+      std::sort( target.begin(), target.end() );
+      auto last = std::unique( target.begin(), target.end() );
+      pending -= static_cast<size_t>( target.end() - last );
+      target.erase( last, target.end() );
+   }
+
+   if( id >= last_slot.size() ) { last_slot.resize( id + 1, std::numeric_limits<slot_number>::min() ); }
+   if( last_slot[id] == s ) { return; }
+
+   last_slot[id] = s;
+   slots[ s & ( wheel_size - 1 ) ].push_back( id );
+   ++pending;
+}
+
+// a slot is out once its very end is older than the border
+template<typename Function>
+void jpmorgan::ExpiryWheel::advance(const timestamp& right_now, Function retire)
+{
+   if( !started || 0 == pending ) { return; }
+
+   slot_number limit = slotOf( right_now - border );
+   if( limit - next > static_cast<slot_number>( wheel_size ) ) { next = limit - static_cast<slot_number>( wheel_size ); }
+
+   for(; next < limit && 0 < pending; ++next)
+   {
+      std::vector<SymbolId>& slot = slots[ next & ( wheel_size - 1 ) ];
+      for(SymbolId id : slot) { retire( id ); }
+      pending -= slot.size();
+      slot.clear();
+   }
+   if( next < limit ) { next = limit; }
+}
+
+size_t jpmorgan::ExpiryWheel::size() const { return pending; }
+
+#endif // WHEEL_HPP
@@ -4,12 +4,15 @@
 #include <thread>
 #include <exception>
 #include <random>
+#include <functional>
+#include <vector>
 
 #include "version.hpp"
 #include "Exceptions.hpp"
 #include "Trade.hpp"
 #include "Stock.hpp"
 #include "GBCE.hpp"
+#include "Simulation.hpp"
 
 template<typename T>
 class RandomNumber {
@@ -26,6 +29,13 @@ class RandomNumber {
 int main(int argc, char** argv)
 {
   try {
+        // capacity planning: as many trades as the engine can take on a virtual clock
+        if( 1 < argc && std::string("--simulate") == argv[1] ) {
+           jpmorgan::simulation_config config = jpmorgan::parseSimulation( std::vector<std::string>( argv + 2, argv + argc ) );
+           std::cout << jpmorgan::simulate( config );
+           return 0;
+        }
+
         jpmorgan::GlobalBeverageCorporationExchange GBCE;
         GBCE.addStock("TEA",  0.0, 100.0);
         GBCE.addStock("POP",  8.0, 100.0);
@@ -46,20 +56,21 @@ int main(int argc, char** argv)
 
         std::cout << std::endl;
 
-	for(auto& element : GBCE) {
+	// for testing we'd better not wait for 15 minutes
+	// 5 secs can do the trick to choose latest trades
+        GBCE.setBorder( jpmorgan::_5sec );
 
-	   // for testing we'd better not wait for 15 minutes
-	   // 5 secs can do the trick to choose latest trades
-           element.second.setBorder( jpmorgan::_5sec );
+	for(const auto& stock : GBCE) {
 
+	   jpmorgan::SymbolId id = GBCE.getSymbolId( stock.getSymbol() );
 
 	   std::time_t ctime_value = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
-	   element.second.setPrice ( price_generator() );
+	   GBCE.setPrice ( id, price_generator() );
 
 	   std::cout << std::ctime( &ctime_value ) << " GBCE All Share Index = " << GBCE.allShareIndex() << std::endl;
 	   
 	   for(size_t i=0; i<10; ++i) { 	
-	    element.second.addTrade ( quantity_generator(), bool_generator() < 1 );
+	    GBCE.addTrade ( id, quantity_generator(), bool_generator() < 1 );
 	   }
 
 	   // wait just a sec and only the last 5 secs trades will be used
@@ -72,6 +83,12 @@ int main(int argc, char** argv)
 
 	return 0;
 
+   } catch ( const unexpected_option& ) {
+
+	std::cerr << "Usage: " << argv[0] << " [--simulate [--symbols 1000] [--rate 100000] [--price-rate 10000] [--seconds 60]" << std::endl;
+	std::cerr << "          [--window 900] [--index-ms 50] [--clear-ms 20] [--price walk|uniform] [--seed 24301]]" << std::endl;
+	return -3;
+
    } catch ( const std::exception& e ) {
 
 	std::cerr << e.what() << std::endl;
@@ -0,0 +1,7 @@
+#ifndef VERSION_HPP
+#define VERSION_HPP
+
+/// \brief static const VERSION_INFO to be checked out using 'strings' command
+static const char* VERSION_INFO __attribute__((used)) __attribute__((nocommon)) = "VERSION_INFO: master 2142edb [Fri Oct 16 22:31:11 UTC 2026] @vm";  
+
+#endif // VERSION_HPP
@@ -5,14 +5,96 @@
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <sstream>
 
 #include <boost/test/unit_test.hpp>
 #include "version.hpp"
 
 // software under test
+#include "Clock.hpp"
+#include "Ticks.hpp"
+#include "Vwap.hpp"
+#include "Kernels.hpp"
+#include "TradeStore.hpp"
 #include "Trade.hpp"
 #include "Stock.hpp"
 #include "GBCE.hpp"
+#include "ConcurrentGBCE.hpp"
+#include "Journal.hpp"
+#include "Wheel.hpp"
+#include "Bars.hpp"
+#include "Pool.hpp"
+#include "ShardedGBCE.hpp"
+#include "Screen.hpp"
+#include "FeedHandler.hpp"
+#include "Snapshot.hpp"
+#include "Metrics.hpp"
+#include "SeqLock.hpp"
+#include "Published.hpp"
+#include "Simulation.hpp"
+#include "ThreadPool.hpp"
+#include "Backtest.hpp"
+#include "Subscriptions.hpp"
+
+// every heap allocation of this binary is counted, so tests can prove some paths don't allocate at all:
+// the whole replaceable family goes through malloc & free, so any new matches any delete
+static std::atomic<size_t> heap_allocations {0};
+
+static void* counted_alloc(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+{
+    ++heap_allocations;
+    if( 0 == size ) { size = 1; }
+    void* p = nullptr;
+    if( alignment <= alignof(std::max_align_t) ) { p = std::malloc( size ); }
+    else if( 0 != ::posix_memalign( &p, alignment, size ) ) { p = nullptr; }
+    return p;
+}
+
+void* operator new(std::size_t size)
+{
+    if( void* p = counted_alloc( size ) ) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size)
+{
+    if( void* p = counted_alloc( size ) ) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if( void* p = counted_alloc( size, static_cast<std::size_t>(alignment) ) ) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    if( void* p = counted_alloc( size, static_cast<std::size_t>(alignment) ) ) { return p; }
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc( size ); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_alloc( size ); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return counted_alloc( size, static_cast<std::size_t>(alignment) ); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return counted_alloc( size, static_cast<std::size_t>(alignment) ); }
+
+void operator delete(void* p) noexcept { std::free( p ); }
+void operator delete[](void* p) noexcept { std::free( p ); }
+void operator delete(void* p, std::size_t) noexcept { std::free( p ); }
+void operator delete[](void* p, std::size_t) noexcept { std::free( p ); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free( p ); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free( p ); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free( p ); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free( p ); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free( p ); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free( p ); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free( p ); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free( p ); }
 
 // just logging something ( --log_level=message )
 BOOST_AUTO_TEST_CASE( testMain000 ) {
@@ -34,12 +116,14 @@ BOOST_AUTO_TEST_CASE( testMain001 ) {
     trade.clear();
     BOOST_CHECK_EQUAL(trade.size(), 0);
 
-    BOOST_TEST_MESSAGE(  "   Insert 10 values, one each 500 msec" );
+    BOOST_TEST_MESSAGE(  "   Insert 10 values, one each 500 msec (manual clock, no real sleep)" );
+    jpmorgan::Clock clock { jpmorgan::Clock::manual };
+    trade.setClock( clock );
     trade.setBorder( jpmorgan::_5sec );
     for(size_t i=1; i<11; ++i)
     {
       trade.addTrade( i, i % 2 == 0, 10.0 * i );
-      std::this_thread::sleep_for( jpmorgan::_500msec );
+      clock.advance( jpmorgan::_500msec );
     }
     BOOST_CHECK_EQUAL(trade.size(), 10);
 
@@ -112,3 +196,1626 @@ BOOST_AUTO_TEST_CASE( testMain003 ) {
 
 
 
+
+BOOST_AUTO_TEST_CASE( testMain004 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on 'VwapWindow' class" );
+
+    jpmorgan::VwapWindow<> window;
+
+    BOOST_TEST_MESSAGE(  "   Empty window means zero stock price" );
+    BOOST_CHECK_EQUAL(window.stockPrice(), 0.0);
+
+    BOOST_TEST_MESSAGE(  "   Add and subtract trades as they enter and leave the window" );
+    for(size_t i=1; i<11; ++i) { window.add( 10.0 * i, i ); }
+    window.subtract( 10.0, 1 );
+    BOOST_CHECK_EQUAL(window.getTradeSize(), 9);
+    BOOST_CHECK_EQUAL(window.getQuantity(), 54);
+    BOOST_CHECK(window.stockPrice() >= 71.1111);
+    BOOST_CHECK(window.stockPrice() <= 71.1112);
+
+    BOOST_TEST_MESSAGE(  "   Empty again after subtracting everything" );
+    for(size_t i=2; i<11; ++i) { window.subtract( 10.0 * i, i ); }
+    BOOST_CHECK_EQUAL(window.stockPrice(), 0.0);
+
+    BOOST_TEST_MESSAGE(  "   Compensated sums don't drift on a long sliding window" );
+    jpmorgan::VwapWindow<jpmorgan::compensated_sum> sliding;
+    sliding.add( 1e9, 1 );
+    for(size_t i=0; i<100000; ++i) { sliding.add( 0.1, 3 ); }
+    sliding.subtract( 1e9, 1 );
+    BOOST_CHECK_CLOSE(sliding.stockPrice(), 0.1, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain005 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on SIMD kernels & 'TradeStore' columns" );
+
+    std::vector<double> price;
+    std::vector<std::uint64_t> quantity;
+    std::vector<std::uint8_t> indicator;
+    for(size_t i=0; i<1003; ++i)
+    {
+      price.push_back( 10.0 + (i * 7919) % 1000 / 10.0 );
+      quantity.push_back( 1 + (i * 104729) % 500 );
+      indicator.push_back( i % 3 == 0 );
+    }
+
+    BOOST_TEST_MESSAGE(  "   Every SIMD level gives the scalar result" );
+    jpmorgan::simd detected = jpmorgan::detectedSimd();
+    jpmorgan::setSimd( jpmorgan::simd::scalar );
+    jpmorgan::trade_summary reference = jpmorgan::summarize( price.data(), quantity.data(), indicator.data(), price.size() );
+    std::vector<double> reference_ratio( price.size() ), ratio( price.size() );
+    jpmorgan::divide( price.data(), price.data() + 1, reference_ratio.data(), price.size() - 1 );
+    std::vector<double> vwap( price.size() ), reference_deviation( price.size() ), deviation( price.size() );
+    for(size_t i=0; i<vwap.size(); ++i) { vwap[i] = ( i % 5 == 0 ? 0.0 : ( i % 7 == 0 ? -1.0 : price[ (i + 1) % price.size() ] ) ); }
+    jpmorgan::relativeDeviation( price.data(), vwap.data(), reference_deviation.data(), price.size() );
+    BOOST_CHECK( std::isnan( reference_deviation[0] ) );
+    BOOST_CHECK( std::isnan( reference_deviation[7] ) );
+    BOOST_CHECK_CLOSE(reference_deviation[1], ( price[1] - price[2] ) / price[2], 1e-9);
+    for(jpmorgan::simd level : { jpmorgan::simd::sse2, jpmorgan::simd::avx2 })
+    {
+      jpmorgan::setSimd( level );
+      jpmorgan::trade_summary result = jpmorgan::summarize( price.data(), quantity.data(), indicator.data(), price.size() );
+      BOOST_CHECK_CLOSE(result.price_x_quantity, reference.price_x_quantity, 1e-9);
+      BOOST_CHECK_EQUAL(result.quantity, reference.quantity);
+      BOOST_CHECK_EQUAL(result.buy_quantity, reference.buy_quantity);
+      BOOST_CHECK_EQUAL(result.sell_quantity, reference.sell_quantity);
+      BOOST_CHECK_EQUAL(result.min_price, reference.min_price);
+      BOOST_CHECK_EQUAL(result.max_price, reference.max_price);
+      BOOST_CHECK_EQUAL(result.count, reference.count);
+
+      double pxq {0.0};
+      unsigned long long q {0};
+      jpmorgan::sumPriceQuantity( price.data(), quantity.data(), price.size(), pxq, q );
+      BOOST_CHECK_CLOSE(pxq, reference.price_x_quantity, 1e-9);
+      BOOST_CHECK_EQUAL(q, reference.quantity);
+
+      jpmorgan::divide( price.data(), price.data() + 1, ratio.data(), price.size() - 1 );
+      BOOST_CHECK( ratio == reference_ratio ); // IEEE division, exactly the same
+
+      jpmorgan::relativeDeviation( price.data(), vwap.data(), deviation.data(), price.size() );
+      size_t different {0};
+      for(size_t i=0; i<price.size(); ++i) { if( std::isnan( deviation[i] ) ? !std::isnan( reference_deviation[i] ) : deviation[i] != reference_deviation[i] ) { ++different; } }
+      BOOST_CHECK_EQUAL(different, 0); // NaN where the scalar one gives NaN, exactly the same elsewhere
+    }
+    jpmorgan::setSimd( detected );
+    BOOST_CHECK_EQUAL(reference.buy_quantity + reference.sell_quantity, reference.quantity);
+
+    BOOST_TEST_MESSAGE(  "   Columns wrapped around the ring are summarized as a whole" );
+    jpmorgan::TradeStore store;
+    jpmorgan::timestamp now = std::chrono::system_clock::now();
+    for(size_t i=0; i<10; ++i) { store.push_back( now, jpmorgan::trade_data{ 1, false, 1.0 } ); }
+    store.pop_front_until( store.tail() );
+    for(size_t i=0; i<price.size(); ++i) { store.push_back( now, jpmorgan::trade_data{ quantity[i], indicator[i] != 0, price[i] } ); }
+    jpmorgan::trade_summary stored = store.summarize( store.head(), store.tail() );
+    BOOST_CHECK_EQUAL(stored.count, price.size());
+    BOOST_CHECK_EQUAL(stored.quantity, reference.quantity);
+    BOOST_CHECK_CLOSE(stored.stockPrice(), reference.stockPrice(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain006 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on 'ConcurrentExchange' class (run it under -DSANITIZE_THREAD=ON too)" );
+
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.addStock("TEA",  0.0, 100.0);
+    GBCE.addStock("POP",  8.0, 100.0);
+    GBCE.addStock("ALE", 23.0, 60.0);
+    GBCE.addStock("GIN", 8.0, 100.0, 2.0 / 100.0); // Preferred
+    GBCE.addStock("JOE", 13.0, 250.0);
+
+    jpmorgan::ConcurrentExchange exchange { std::move(GBCE), 64 };
+    const std::vector<std::string> symbols { "TEA", "POP", "ALE", "GIN", "JOE" };
+    for(const auto& symbol : symbols) { BOOST_CHECK( exchange.pushPrice( symbol, 10.0 ) ); }
+
+    BOOST_TEST_MESSAGE(  "   Readers see what the last drain published, nothing newer" );
+    BOOST_CHECK_EQUAL(exchange.getVersion(), 1);
+    BOOST_CHECK_EQUAL(exchange.getPrice("TEA"), 0.0);
+    BOOST_CHECK_EQUAL(exchange.drain(), symbols.size());
+    BOOST_CHECK_EQUAL(exchange.getVersion(), 2);
+    BOOST_CHECK_CLOSE(exchange.getPrice("TEA"), 10.0, 1e-9);
+    BOOST_CHECK_CLOSE(exchange.allShareIndex(), 10.0, 1e-9);
+    BOOST_CHECK( exchange.pushTrade( "TEA", 10, false ) );
+    BOOST_CHECK_EQUAL(exchange.stockPrice("TEA"), 0.0);
+    BOOST_CHECK_EQUAL(exchange.getTradeSize("TEA"), 0);
+    BOOST_CHECK_EQUAL(exchange.drain(), 1);
+    BOOST_CHECK_CLOSE(exchange.stockPrice("TEA"), 10.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Several producers pushing while a drainer and a reader keep going" );
+    const size_t producers {4};
+    const size_t trades_per_producer {2000};
+    std::atomic<bool> done {false};
+    std::vector<std::thread> threads;
+    for(size_t p=0; p<producers; ++p)
+    {
+      threads.emplace_back( [&, p]() {
+        for(size_t i=0; i<trades_per_producer; ++i)
+        {
+          // a full queue just means the reader is late
+          while( !exchange.pushTrade( symbols[ (p + i) % symbols.size() ], 1 + i % 10, i % 2 == 0 ) ) { std::this_thread::yield(); }
+        }
+      });
+    }
+    // Boost.Test assertions aren't thread-safe: the reader only counts, the main thread checks
+    std::thread drainer( [&]() {
+      do { exchange.drain(); } while( !done.load() );
+    });
+    size_t reads {0}, bad_index {0}, bad_price {0};
+    std::thread reader( [&]() {
+      do
+      {
+        ++reads;
+        if( !( exchange.allShareIndex() >= 9.99999 ) ) { ++bad_index; }
+        if( !( exchange.stockPrice("TEA") >= 9.99999 ) ) { ++bad_price; }
+      } while( !done.load() );
+    });
+    for(auto& t : threads) { t.join(); }
+    done.store( true );
+    drainer.join();
+    reader.join();
+    BOOST_CHECK_GT(reads, 0);
+    BOOST_CHECK_EQUAL(bad_index, 0);
+    BOOST_CHECK_EQUAL(bad_price, 0);
+
+    BOOST_TEST_MESSAGE(  "   Every pushed trade ends up in its stock" );
+    exchange.drain();
+    size_t total {0};
+    for(const auto& symbol : symbols) { total += exchange.getTradeSize( symbol ); }
+    BOOST_CHECK_EQUAL(total, 1 + producers * trades_per_producer);
+    BOOST_CHECK( exchange.stockPrice("ALE") <= 10.0001 );
+    BOOST_CHECK( exchange.stockPrice("ALE") >= 9.99999 );
+
+    BOOST_TEST_MESSAGE(  "   Unknown symbols are rejected on the producer side" );
+    BOOST_CHECK_THROW( exchange.pushTrade( "XXX", 1, false ), stock_non_found );
+
+    BOOST_TEST_MESSAGE(  "   Stocks removed before wrapping: the others keep their queues, the removed id gets none" );
+    jpmorgan::GlobalBeverageCorporationExchange trimmed;
+    jpmorgan::SymbolId removed = trimmed.addStock("TEA", 0.0, 100.0);
+    trimmed.addStock("POP", 8.0, 100.0);
+    trimmed.addStock("ALE", 23.0, 60.0);
+    trimmed.removeStock("TEA");
+    jpmorgan::ConcurrentExchange wrapped { std::move(trimmed), 8 };
+    BOOST_CHECK( wrapped.pushPrice( "ALE", 5.0 ) );
+    BOOST_CHECK( wrapped.pushTrade( "ALE", 10, true ) );
+    BOOST_CHECK_THROW( wrapped.pushPrice( removed, 5.0 ), stock_non_found );
+    BOOST_CHECK_THROW( wrapped.pushTrade( removed, 1, false ), stock_non_found );
+    BOOST_CHECK_THROW( wrapped.stockPrice( "TEA" ), stock_non_found );
+    BOOST_CHECK_EQUAL(wrapped.drain(), 2);
+    BOOST_CHECK_CLOSE(wrapped.getPrice("ALE"), 5.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Trades keep the time they were pushed at, however late they are drained" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange timed;
+    timed.setClock( manual );
+    timed.setBorder( jpmorgan::_5sec );
+    timed.addStock("TEA", 0.0, 100.0);
+    jpmorgan::ConcurrentExchange late { std::move(timed), 8 };
+    late.pushPrice( "TEA", 10.0 );
+    late.pushTrade( "TEA", 10, false );
+    manual.advance( std::chrono::seconds(10) );
+    BOOST_CHECK_EQUAL(late.drain(), 2);
+    BOOST_CHECK_EQUAL(late.stockPrice("TEA"), 0.0); // out of the border already
+}
+
+BOOST_AUTO_TEST_CASE( testMain007 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on 'SymbolTable' & id based GBCE" );
+
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    jpmorgan::SymbolId tea = GBCE.addStock("TEA",  0.0, 100.0);
+    jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+
+    BOOST_TEST_MESSAGE(  "   Dense ids in listing order, same id when listed twice" );
+    BOOST_CHECK_EQUAL(tea, 0);
+    BOOST_CHECK_EQUAL(pop, 1);
+    BOOST_CHECK_EQUAL(GBCE.addStock("TEA", 1.0, 1.0), tea);
+    BOOST_CHECK_EQUAL(GBCE.size(), 2);
+    BOOST_CHECK_EQUAL(GBCE.getSymbol(pop), "POP");
+
+    BOOST_TEST_MESSAGE(  "   Names and ids reach the same stock" );
+    std::string_view name {"POP"};
+    BOOST_CHECK_EQUAL(GBCE.getSymbolId(name), pop);
+    GBCE.setPrice(pop, 10.0);
+    BOOST_CHECK_EQUAL(GBCE.getPrice("POP"), 10.0);
+    GBCE.addTrade(pop, 5, false);
+    GBCE.addTrade(name, 5, true);
+    BOOST_CHECK_EQUAL(GBCE.at(pop).getTradeSize(), 2);
+    BOOST_CHECK(GBCE.stockPrice(pop) >= 9.99999);
+    BOOST_CHECK(GBCE.stockPrice(pop) <= 10.0001);
+    BOOST_CHECK_EQUAL(GBCE.dividendYield(pop), GBCE.dividendYield("POP"));
+
+    BOOST_TEST_MESSAGE(  "   Unknown names and ids throw" );
+    BOOST_CHECK_THROW( GBCE.getPrice("XXX"), stock_non_found );
+    BOOST_CHECK_THROW( GBCE.addTrade(jpmorgan::SymbolId{7}, 1, false), stock_non_found );
+}
+
+BOOST_AUTO_TEST_CASE( testMain008 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on 'ShareIndex' class & GBCE incremental All Share Index" );
+
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    jpmorgan::SymbolId tea = GBCE.addStock("TEA",  0.0, 100.0);
+    jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+
+    BOOST_TEST_MESSAGE(  "   Any zero price means zero index" );
+    BOOST_CHECK_EQUAL(GBCE.allShareIndex(), 0.0);
+    GBCE.setPrice(tea, 4.0);
+    BOOST_CHECK_EQUAL(GBCE.allShareIndex(), 0.0);
+
+    BOOST_TEST_MESSAGE(  "   Geometric mean follows every price tick" );
+    GBCE.setPrice(pop, 9.0);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(), 6.0, 1e-9);
+    GBCE.setPrice(pop, 16.0);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(), 8.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Stocks joining and leaving the index" );
+    jpmorgan::SymbolId ale = GBCE.addStock("ALE", 23.0, 60.0);
+    BOOST_CHECK_EQUAL(GBCE.allShareIndex(), 0.0);
+    GBCE.setPrice(ale, 1.0);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(), 4.0, 1e-9);
+    GBCE.removeStock("ALE");
+    BOOST_CHECK_EQUAL(GBCE.size(), 2);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(), 8.0, 1e-9);
+    BOOST_CHECK_THROW( GBCE.setPrice(ale, 1.0), stock_non_found );
+    BOOST_CHECK_THROW( GBCE.getSymbolId("ALE"), stock_non_found );
+    size_t iterated {0};
+    for(const auto& stock : GBCE) { BOOST_CHECK(stock.getSymbol() != "ALE"); ++iterated; }
+    BOOST_CHECK_EQUAL(iterated, 2);
+
+    BOOST_TEST_MESSAGE(  "   No drift after many ticks, two exchanges don't share anything" );
+    jpmorgan::GlobalBeverageCorporationExchange other;
+    other.addStock("GIN", 8.0, 100.0, 2.0 / 100.0);
+    other.setPrice("GIN", 3.0);
+    for(size_t i=1; i<100000; ++i) { GBCE.setPrice(pop, 0.01 * i); }
+    GBCE.setPrice(pop, 16.0);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(), 8.0, 1e-9);
+    BOOST_CHECK_CLOSE(other.allShareIndex(), 3.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain009 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on 'Clock' class & caller supplied timestamps" );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+
+    BOOST_TEST_MESSAGE(  "   Coarse clock only moves when refreshed" );
+    jpmorgan::Clock coarse { jpmorgan::Clock::coarse, start };
+    BOOST_CHECK( coarse.now() == start );
+    coarse.refresh();
+    BOOST_CHECK( coarse.now() >= start );
+
+    BOOST_TEST_MESSAGE(  "   Copies keep the kind and the cached time" );
+    jpmorgan::Clock copied { jpmorgan::Clock::manual, start };
+    copied.advance( std::chrono::seconds(3) );
+    jpmorgan::Clock copy { copied };
+    BOOST_CHECK( copy.getKind() == jpmorgan::Clock::manual );
+    BOOST_CHECK( copy.now() == start + std::chrono::seconds(3) );
+    copy = coarse;
+    BOOST_CHECK( copy.getKind() == jpmorgan::Clock::coarse );
+    BOOST_CHECK( copy.now() == coarse.now() );
+
+    BOOST_TEST_MESSAGE(  "   TSC clock follows system time" );
+    jpmorgan::Clock tsc { jpmorgan::Clock::tsc };
+    jpmorgan::timestamp first = tsc.now();
+    BOOST_CHECK( tsc.now() >= first );
+    BOOST_CHECK( std::chrono::abs( first - std::chrono::system_clock::now() ) < std::chrono::seconds(1) );
+
+    BOOST_TEST_MESSAGE(  "   Exchange timestamps drive the window, the clock only says what 'now' is" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+    GBCE.setBorder( jpmorgan::_5sec );
+    GBCE.setPrice(pop, 10.0);
+    GBCE.addTrade(pop, start - std::chrono::seconds(6), 100, false);
+    GBCE.setPrice(pop, 20.0);
+    GBCE.addTrade(pop, start - std::chrono::seconds(1), 100, true);
+    BOOST_CHECK_CLOSE(GBCE.stockPrice(pop), 20.0, 1e-9);
+    manual.advance( std::chrono::seconds(10) );
+    BOOST_CHECK_EQUAL(GBCE.stockPrice(pop), 0.0);
+    GBCE.clearOldTrades();
+    BOOST_CHECK_EQUAL(GBCE.at(pop).getTradeSize(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Trade price given explicitly is the one recorded" );
+    jpmorgan::Stock stock {"ALE", 23.0, 60.0};
+    stock.setClock( manual );
+    stock.addTrade( 10, false, 42.0 );
+    BOOST_CHECK_CLOSE(stock.stockPrice(), 42.0, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain010 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on batch trade ingestion" );
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, std::chrono::system_clock::now() };
+    jpmorgan::GlobalBeverageCorporationExchange batched;
+    jpmorgan::GlobalBeverageCorporationExchange one_by_one;
+    for(auto* exchange : { &batched, &one_by_one }) {
+       exchange->setClock( manual );
+       exchange->addStock("TEA",  0.0, 100.0);
+       exchange->addStock("POP",  8.0, 100.0);
+       exchange->addStock("ALE", 23.0,  60.0);
+       exchange->setPrice("TEA", 10.0);
+       exchange->setPrice("POP", 20.0);
+       exchange->setPrice("ALE", 30.0);
+    }
+
+    BOOST_TEST_MESSAGE(  "   Same prices as adding trades one by one, events interleaved" );
+    std::vector<jpmorgan::trade_event> packet { {2, 5, false}, {0, 10, true}, {2, 15, true}, {1, 20, false}, {0, 30, false} };
+    batched.addTrades( packet );
+    for(const auto& event : packet) { one_by_one.addTrade( event.id, event.quantity, event.indicator ); }
+    for(jpmorgan::SymbolId id=0; id<3; ++id) {
+       BOOST_CHECK_EQUAL(batched.at(id).getTradeSize(), one_by_one.at(id).getTradeSize());
+       BOOST_CHECK_CLOSE(batched.stockPrice(id), one_by_one.stockPrice(id), 1e-9);
+    }
+
+    BOOST_TEST_MESSAGE(  "   Bulk append on a trade keeps the order" );
+    jpmorgan::Trade trade;
+    trade.setClock( manual );
+    std::vector<jpmorgan::trade_data> trades { {5, false, 10.0}, {15, true, 30.0} };
+    trade.addTrades( trades );
+    std::vector<unsigned long> quantities {};
+    for(const auto& element : trade) { quantities.push_back( element.second.quantity ); }
+    BOOST_CHECK( quantities == std::vector<unsigned long>({ 5, 15 }) );
+    BOOST_CHECK_CLOSE(trade.stockPrice(), 25.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Unknown symbol rejects the whole batch" );
+    std::vector<jpmorgan::trade_event> wrong { {0, 10, true}, {7, 10, true} };
+    BOOST_CHECK_THROW( batched.addTrades( wrong ), stock_non_found );
+    BOOST_CHECK_EQUAL(batched.at(0u).getTradeSize(), 2);
+
+    BOOST_TEST_MESSAGE(  "   Batch timestamps expire together" );
+    batched.setBorder( jpmorgan::_5sec );
+    batched.addTrades( manual.now(), packet );
+    BOOST_CHECK_EQUAL(batched.at(0u).getTradeSize(), 4);
+    manual.advance( std::chrono::seconds(6) );
+    BOOST_CHECK_EQUAL(batched.stockPrice(0u), 0.0);
+    batched.clearOldTrades();
+    BOOST_CHECK_EQUAL(batched.at(0u).getTradeSize(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Batches added at once and expired one by one don't drift" );
+    jpmorgan::Trade drifting;
+    drifting.setClock( manual );
+    drifting.setBorder( jpmorgan::_5sec );
+    for(size_t i=0; i<20000; ++i) {
+       std::vector<jpmorgan::trade_data> batch { {1, false, 1e9 + 0.37 * i}, {3, false, 0.1}, {7, true, 0.13} };
+       drifting.addTrades( batch );
+       manual.advance( std::chrono::milliseconds(100) );
+    }
+    for(size_t i=0; i<60; ++i) {
+       drifting.addTrade( 3, false, 0.1 );
+       manual.advance( std::chrono::milliseconds(100) );
+    }
+    BOOST_CHECK_CLOSE(drifting.stockPrice(), 0.1, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain011 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on trade journal & replay" );
+
+    const std::string path { "testMain011.journal" };
+    std::remove( path.c_str() );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+
+    double index {0.0};
+    double tea_price {0.0};
+    double pop_price {0.0};
+    {
+       jpmorgan::TradeJournal journal { path, jpmorgan::TradeJournal::durable, 64 };
+       jpmorgan::GlobalBeverageCorporationExchange GBCE;
+       GBCE.setClock( manual );
+       GBCE.setJournal( &journal );
+       jpmorgan::SymbolId tea = GBCE.addStock("TEA",  0.0, 100.0);
+       jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+       GBCE.setBorder( jpmorgan::_5sec );
+
+       BOOST_TEST_MESSAGE(  "   Prices and trades are journaled, one by one and in batches" );
+       GBCE.setPrice(tea, 10.0);
+       GBCE.setPrice(pop, 20.0);
+       GBCE.addTrade(tea, start - std::chrono::seconds(10), 100, false); // out of the window on replay
+       GBCE.addTrade(tea, 50, true);
+       std::vector<jpmorgan::trade_event> packet { {pop, 10, false}, {tea, 30, true} };
+       GBCE.addTrades( packet );
+       GBCE.setPrice(tea, 12.0);
+       for(size_t i=0; i<100000; ++i) { GBCE.addTrade(pop, 1, false); } // grows the file
+       BOOST_CHECK_EQUAL(journal.size(), 100007);
+
+       index = GBCE.allShareIndex();
+       tea_price = GBCE.stockPrice(tea);
+       pop_price = GBCE.stockPrice(pop);
+    }
+
+    BOOST_TEST_MESSAGE(  "   Replay rebuilds windows and index" );
+    jpmorgan::JournalReader reader { path };
+    BOOST_CHECK_EQUAL(reader.size(), 100007);
+    jpmorgan::GlobalBeverageCorporationExchange restarted;
+    restarted.setClock( manual );
+    restarted.addStock("TEA",  0.0, 100.0);
+    restarted.addStock("POP",  8.0, 100.0);
+    restarted.setBorder( jpmorgan::_5sec );
+    restarted.replay( reader.records(), start - std::chrono::seconds(5) );
+    BOOST_CHECK_CLOSE(restarted.allShareIndex(), index, 1e-9);
+    BOOST_CHECK_CLOSE(restarted.getPrice("TEA"), 12.0, 1e-9);
+    BOOST_CHECK_CLOSE(restarted.stockPrice("TEA"), tea_price, 1e-9);
+    BOOST_CHECK_CLOSE(restarted.stockPrice("POP"), pop_price, 1e-9);
+    BOOST_CHECK_EQUAL(restarted.at("TEA").getTradeSize(), 2);
+
+    BOOST_TEST_MESSAGE(  "   Reopened journal keeps appending after its last record" );
+    {
+       jpmorgan::TradeJournal journal { path };
+       BOOST_CHECK_EQUAL(journal.size(), 100007);
+       journal.appendPrice( 0, start, 1.0 );
+    }
+    BOOST_CHECK_EQUAL(jpmorgan::JournalReader{ path }.size(), 100008);
+
+    BOOST_TEST_MESSAGE(  "   Anything else is rejected" );
+    std::FILE* other = std::fopen( path.c_str(), "wb" );
+    std::fputs( "not a journal at all, just some text", other );
+    std::fclose( other );
+    BOOST_CHECK_THROW( jpmorgan::JournalReader{ path }, unexpected_journal_format );
+    BOOST_CHECK_THROW( jpmorgan::JournalReader{ "non/existent.journal" }, journal_io_error );
+
+    BOOST_TEST_MESSAGE(  "   Foreign files are left as they are by the writer" );
+    auto file_size = [&path]() {
+       std::FILE* f = std::fopen( path.c_str(), "rb" );
+       std::fseek( f, 0, SEEK_END );
+       long size = std::ftell( f );
+       std::fclose( f );
+       return size;
+    };
+    BOOST_CHECK_THROW( jpmorgan::TradeJournal{ path }, unexpected_journal_format );
+    BOOST_CHECK_EQUAL(file_size(), 36);
+    other = std::fopen( path.c_str(), "wb" );
+    std::fputs( "short", other );
+    std::fclose( other );
+    BOOST_CHECK_THROW( jpmorgan::TradeJournal{ path }, unexpected_journal_format );
+    BOOST_CHECK_EQUAL(file_size(), 5);
+
+    std::remove( path.c_str() );
+}
+
+BOOST_AUTO_TEST_CASE( testMain012 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on expiry wheel" );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    std::vector<jpmorgan::SymbolId> retired {};
+    auto collect = [&](jpmorgan::SymbolId id) { retired.push_back( id ); };
+
+    BOOST_TEST_MESSAGE(  "   A stock is retired once per slot, only after the whole slot is out of the border" );
+    jpmorgan::ExpiryWheel wheel { jpmorgan::_5sec };
+    wheel.insert( 3, start );
+    wheel.insert( 3, start );
+    wheel.insert( 7, start + std::chrono::seconds(2) );
+    BOOST_CHECK_EQUAL(wheel.size(), 2);
+    wheel.advance( start + std::chrono::seconds(4), collect );
+    BOOST_CHECK( retired.empty() );
+    wheel.advance( start + std::chrono::milliseconds(5100), collect );
+    BOOST_CHECK( retired == std::vector<jpmorgan::SymbolId>({ 3 }) );
+    wheel.advance( start + std::chrono::seconds(8), collect );
+    BOOST_CHECK( retired == std::vector<jpmorgan::SymbolId>({ 3, 7 }) );
+    BOOST_CHECK_EQUAL(wheel.size(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Never advanced for ages, nothing is lost" );
+    retired.clear();
+    wheel.insert( 1, start + std::chrono::seconds(10) );
+    wheel.insert( 2, start + std::chrono::hours(1) );
+    wheel.advance( start + std::chrono::hours(2), collect );
+    std::sort( retired.begin(), retired.end() );
+    BOOST_CHECK( retired == std::vector<jpmorgan::SymbolId>({ 1, 2 }) );
+    for(size_t i=0; i<10000; ++i) { wheel.insert( 5, start + std::chrono::hours(3) + std::chrono::milliseconds(20 * i) ); }
+    BOOST_CHECK_LE(wheel.size(), 513);
+
+    BOOST_TEST_MESSAGE(  "   Exchange only frees stocks with old trades, memory follows the window" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    for(size_t i=0; i<2000; ++i) { GBCE.setPrice( GBCE.addStock( "S" + std::to_string(i), 8.0, 100.0 ), 10.0 ); }
+    GBCE.setBorder( jpmorgan::_5sec );
+    for(size_t second=0; second<20; ++second) {
+       for(jpmorgan::SymbolId id=0; id<2000; id+=100) { GBCE.addTrade( id, 10, false ); }
+       manual.advance( std::chrono::seconds(1) );
+       GBCE.clearOldTrades();
+       BOOST_CHECK_LE(GBCE.at(0u).getTradeSize(), 6);
+    }
+    BOOST_CHECK_CLOSE(GBCE.stockPrice(0u), 10.0, 1e-9);
+    manual.advance( std::chrono::seconds(6) );
+    GBCE.clearOldTrades();
+    size_t left {0};
+    for(const auto& stock : GBCE) { left += stock.getTradeSize(); }
+    BOOST_CHECK_EQUAL(left, 0);
+}
+
+BOOST_AUTO_TEST_CASE( testMain013 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on several windows over the same trades" );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+
+    jpmorgan::Trade trade;
+    trade.setClock( manual );
+    trade.setBorder( std::chrono::minutes(1) );
+    jpmorgan::Trade::window_id second = trade.addWindow( std::chrono::seconds(1) );
+    jpmorgan::Trade::window_id five = trade.addWindow( jpmorgan::_5sec );
+    BOOST_CHECK_EQUAL(trade.getWindowCount(), 3);
+
+    BOOST_TEST_MESSAGE(  "   Each window sees its own trades" );
+    trade.addTrade( 100, false, 10.0 ); // buy
+    manual.advance( std::chrono::seconds(3) );
+    trade.addTrade( 300, true, 20.0 ); // sell
+    std::vector<jpmorgan::trade_data> batch { {100, false, 30.0} };
+    trade.addTrades( batch );
+
+    jpmorgan::window_stats last_second = trade.stats( second );
+    BOOST_CHECK_EQUAL(last_second.count, 2);
+    BOOST_CHECK_EQUAL(last_second.quantity, 400);
+    BOOST_CHECK_EQUAL(last_second.sell_quantity, 300);
+    BOOST_CHECK_EQUAL(last_second.buy_quantity, 100);
+    BOOST_CHECK_CLOSE(last_second.stock_price, 22.5, 1e-9);
+    BOOST_CHECK_CLOSE(last_second.imbalance(), -0.5, 1e-9);
+
+    jpmorgan::window_stats last_five = trade.stats( five );
+    BOOST_CHECK_EQUAL(last_five.count, 3);
+    BOOST_CHECK_CLOSE(last_five.stock_price, 20.0, 1e-9);
+    BOOST_CHECK_CLOSE(last_five.imbalance(), -0.2, 1e-9);
+    BOOST_CHECK_CLOSE(trade.stockPrice(), 20.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Trades are kept while the widest window needs them" );
+    manual.advance( std::chrono::seconds(10) );
+    trade.clearOldTrades();
+    BOOST_CHECK_EQUAL(trade.size(), 3);
+    BOOST_CHECK_EQUAL(trade.stats( five ).count, 0);
+    BOOST_CHECK_EQUAL(trade.stats( five ).imbalance(), 0.0);
+    manual.advance( std::chrono::minutes(1) );
+    trade.clearOldTrades();
+    BOOST_CHECK_EQUAL(trade.size(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Exchange windows apply to stocks listed later" );
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    GBCE.setBorder( jpmorgan::_5sec );
+    jpmorgan::Trade::window_id minute = GBCE.addWindow( std::chrono::minutes(1) );
+    jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+    GBCE.setPrice(pop, 10.0);
+    GBCE.addTrade(pop, 10, true);
+    manual.advance( std::chrono::seconds(10) );
+    GBCE.setPrice(pop, 30.0);
+    GBCE.addTrade(pop, 10, false);
+    BOOST_CHECK_CLOSE(GBCE.stockPrice(pop), 30.0, 1e-9);
+    BOOST_CHECK_CLOSE(GBCE.windowStats("POP", minute).stock_price, 20.0, 1e-9);
+    BOOST_CHECK_EQUAL(GBCE.windowStats(pop, minute).imbalance(), 0.0);
+    GBCE.clearOldTrades();
+    BOOST_CHECK_EQUAL(GBCE.at(pop).getTradeSize(), 2);
+}
+
+BOOST_AUTO_TEST_CASE( testMain014 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on OHLCV bars" );
+
+    // on a minute boundary so that bars are easy to follow
+    jpmorgan::timestamp start { std::chrono::duration_cast<jpmorgan::timestamp::duration>( std::chrono::minutes(29000000) ) };
+    jpmorgan::timestamp::duration minute = std::chrono::duration_cast<jpmorgan::timestamp::duration>( std::chrono::minutes(1) );
+
+    BOOST_TEST_MESSAGE(  "   Open, high, low, close, volume & VWAP per interval" );
+    jpmorgan::BarBuilder builder { std::chrono::minutes(1), 4 };
+    builder.add( start + std::chrono::seconds(1), 10.0, 100 );
+    builder.add( start + std::chrono::seconds(20), 14.0, 100 );
+    builder.add( start + std::chrono::seconds(40), 8.0, 200 );
+    builder.add( start + std::chrono::seconds(50), 12.0, 100 );
+    BOOST_CHECK( builder.isOpen() );
+    BOOST_CHECK( builder.empty() );
+    builder.add( start + minute + std::chrono::seconds(5), 20.0, 10 );
+    BOOST_CHECK_EQUAL(builder.size(), 1);
+    const jpmorgan::bar& first = builder[0];
+    BOOST_CHECK( first.start == start );
+    BOOST_CHECK_EQUAL(first.open, 10.0);
+    BOOST_CHECK_EQUAL(first.high, 14.0);
+    BOOST_CHECK_EQUAL(first.low, 8.0);
+    BOOST_CHECK_EQUAL(first.close, 12.0);
+    BOOST_CHECK_EQUAL(first.volume, 500);
+    BOOST_CHECK_EQUAL(first.count, 4);
+    BOOST_CHECK_CLOSE(first.vwap(), 10.4, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Quiet intervals get flat bars, the ring keeps the newest ones" );
+    builder.close( start + 3 * minute + std::chrono::seconds(1) );
+    BOOST_CHECK_EQUAL(builder.size(), 3);
+    BOOST_CHECK( builder[2].start == start + 2 * minute );
+    BOOST_CHECK_EQUAL(builder[2].close, 20.0);
+    BOOST_CHECK_EQUAL(builder[2].volume, 0);
+    BOOST_CHECK( builder.find( start + minute ) == &builder[1] );
+    builder.add( start + 10 * minute, 30.0, 10 );
+    builder.close( start + 11 * minute );
+    BOOST_CHECK_EQUAL(builder.size(), 4);
+    BOOST_CHECK( builder[3].start == start + 10 * minute );
+    BOOST_CHECK( builder[0].start == start + 7 * minute );
+    BOOST_CHECK( nullptr == builder.find( start ) );
+
+    BOOST_TEST_MESSAGE(  "   All Share Index per bar" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    jpmorgan::SymbolId pop = GBCE.addStock("POP",  8.0, 100.0);
+    jpmorgan::Stock::bars_id minutes = GBCE.addBars( std::chrono::minutes(1), 60 );
+    jpmorgan::SymbolId ale = GBCE.addStock("ALE", 23.0,  60.0);
+    GBCE.setPrice(pop, 2.0);
+    GBCE.setPrice(ale, 8.0);
+    GBCE.addTrade(pop, 10, false);
+    GBCE.addTrade(ale, 10, false);
+    manual.advance( std::chrono::minutes(1) );
+    GBCE.setPrice(pop, 4.0);
+    GBCE.addTrade(pop, 10, false);
+    manual.advance( std::chrono::minutes(1) );
+    GBCE.closeBars();
+    BOOST_CHECK_EQUAL(GBCE.getBars(ale, minutes).size(), 2);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(minutes, start), 4.0, 1e-9);
+    BOOST_CHECK_CLOSE(GBCE.allShareIndex(minutes, start + minute), std::sqrt(32.0), 1e-9);
+    BOOST_CHECK_EQUAL(GBCE.allShareIndex(minutes, start + 5 * minute), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE( testMain015 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on Stock moves & allocation free ingestion" );
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, std::chrono::system_clock::now() };
+
+    // copying trades would take blocks of their pool, moving them doesn't
+    BOOST_TEST_MESSAGE(  "   Stocks are really moved, trades and all" );
+    BOOST_CHECK( std::is_nothrow_move_constructible<jpmorgan::Stock>::value );
+    BOOST_CHECK( std::is_nothrow_move_assignable<jpmorgan::Stock>::value );
+    jpmorgan::BlockPool stock_pool { 1 << 20 };
+    std::vector<jpmorgan::Stock> stocks {};
+    for(size_t i=0; i<10; ++i) {
+       stocks.emplace_back( "S" + std::to_string(i), 8.0, 100.0 );
+       stocks.back().setClock( manual );
+       stocks.back().setPool( &stock_pool );
+       for(size_t j=0; j<100; ++j) { stocks.back().addTrade( 10, false, 1.0 ); }
+    }
+    size_t used = stock_pool.getArenaUsed();
+    size_t before = heap_allocations;
+    stocks.reserve( 4 * stocks.capacity() );
+    BOOST_CHECK_EQUAL(heap_allocations - before, 1); // just the new array
+    BOOST_CHECK_EQUAL(stock_pool.getArenaUsed(), used);
+    BOOST_CHECK_EQUAL(stock_pool.getHeapBlocks(), 0);
+    BOOST_CHECK_EQUAL(stocks[9].getTradeSize(), 100);
+    jpmorgan::Stock moved {};
+    moved = std::move( stocks[9] );
+    BOOST_CHECK_EQUAL(moved.getTradeSize(), 100);
+    BOOST_CHECK_EQUAL(moved.getSymbol(), "S9");
+
+    BOOST_TEST_MESSAGE(  "   Moved from trades keep their default window" );
+    BOOST_CHECK_EQUAL(stocks[9].getTradeSize(), 0);
+    BOOST_CHECK_EQUAL(stocks[9].getWindowCount(), 1);
+    stocks[9].setBorder( jpmorgan::_5sec );
+    stocks[9].addTrade( 10, false, 2.0 );
+    BOOST_CHECK_CLOSE(stocks[9].stockPrice(), 2.0, 1e-9);
+    jpmorgan::Trade source;
+    source.setClock( manual );
+    source.addWindow( jpmorgan::_5sec );
+    source.addTrade( 10, false, 1.0 );
+    jpmorgan::Trade target { std::move(source) };
+    BOOST_CHECK_EQUAL(target.getWindowCount(), 2);
+    BOOST_CHECK_EQUAL(source.getWindowCount(), 1);
+    BOOST_CHECK_EQUAL(source.summary().count, 0);
+    source.addTrade( 10, false, 3.0 );
+    BOOST_CHECK_CLOSE(source.stockPrice(), 3.0, 1e-9);
+    target = std::move( source );
+    BOOST_CHECK_EQUAL(target.getWindowCount(), 1);
+    BOOST_CHECK_EQUAL(source.getWindowCount(), 1);
+    source.setBorder( jpmorgan::_5sec );
+    BOOST_CHECK_EQUAL(source.stockPrice(), 0.0);
+
+    BOOST_TEST_MESSAGE(  "   A big enough pool keeps growing trades off the heap" );
+    jpmorgan::BlockPool pool { 64 << 20 };
+    jpmorgan::Trade trade;
+    trade.setClock( manual );
+    trade.setPool( &pool );
+    before = heap_allocations;
+    for(size_t i=0; i<100000; ++i) { trade.addTrade( 10, false, 1.0 ); }
+    BOOST_CHECK_EQUAL(heap_allocations - before, 0);
+    BOOST_CHECK_EQUAL(pool.getHeapBlocks(), 0);
+    trade.setPool( nullptr );
+    BOOST_CHECK_EQUAL(trade.size(), 100000);
+
+    BOOST_TEST_MESSAGE(  "   Steady state ingestion doesn't touch the heap at all" );
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    GBCE.setPool( &pool );
+    for(size_t i=0; i<100; ++i) { GBCE.setPrice( GBCE.addStock( "S" + std::to_string(i), 8.0, 100.0 ), 10.0 ); }
+    GBCE.setBorder( jpmorgan::_5sec );
+    std::vector<jpmorgan::trade_event> packet {};
+    for(jpmorgan::SymbolId id=0; id<100; id+=10) { packet.push_back( jpmorgan::trade_event{ id, 10, true } ); }
+    auto tick = [&](size_t i) {
+       GBCE.addTrade( static_cast<jpmorgan::SymbolId>( i % 100 ), 10, false );
+       if( 0 == i % 10 ) { GBCE.addTrades( packet ); }
+       if( 0 == i % 100 ) { GBCE.clearOldTrades(); GBCE.setPrice( static_cast<jpmorgan::SymbolId>( i % 100 ), 10.0 + ( i % 7 ) ); }
+       manual.advance( std::chrono::milliseconds(1) );
+    };
+    for(size_t i=0; i<15000; ++i) { tick( i ); } // every slot of the expiry wheel used once
+    used = pool.getArenaUsed();
+    before = heap_allocations;
+    for(size_t i=15000; i<45000; ++i) { tick( i ); }
+    BOOST_CHECK_EQUAL(heap_allocations - before, 0);
+    BOOST_CHECK_EQUAL(pool.getArenaUsed(), used); // blocks only recycled
+    BOOST_CHECK_EQUAL(pool.getHeapBlocks(), 0);
+}
+
+BOOST_AUTO_TEST_CASE( testMain016 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on sharded exchange" );
+
+    jpmorgan::ShardedExchange sharded { 4, 256 };
+    jpmorgan::GlobalBeverageCorporationExchange single;
+    for(size_t i=0; i<40; ++i) {
+       std::string symbol = "S" + std::to_string(i);
+       jpmorgan::SymbolId id = sharded.addStock( symbol, 8.0, 100.0 );
+       BOOST_CHECK_EQUAL(id, single.addStock( symbol, 8.0, 100.0 ));
+       sharded.setPrice( id, 1.0 + i );
+       single.setPrice( id, 1.0 + i );
+    }
+    BOOST_CHECK_EQUAL(sharded.getShardCount(), 4);
+    BOOST_CHECK_CLOSE(sharded.allShareIndex(), single.allShareIndex(), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Several producers, every shard on its own thread" );
+    sharded.start();
+    std::vector<std::thread> producers {};
+    for(size_t p=0; p<4; ++p) {
+       producers.emplace_back( [&sharded, p]() {
+          for(size_t i=0; i<10000; ++i) {
+             jpmorgan::SymbolId id = static_cast<jpmorgan::SymbolId>( ( p * 10000 + i ) % 40 );
+             while( !sharded.pushTrade( id, 10, false ) ) { std::this_thread::yield(); }
+          }
+       });
+    }
+    for(auto& producer : producers) { producer.join(); }
+    while( !sharded.pushPrice( sharded.getSymbolId("S7"), 100.0 ) ) { std::this_thread::yield(); }
+    single.setPrice( "S7", 100.0 );
+    sharded.sync();
+
+    size_t trades {0};
+    for(jpmorgan::SymbolId id=0; id<40; ++id) { trades += sharded.getTradeSize( id ); }
+    BOOST_CHECK_EQUAL(trades, 40000);
+    BOOST_CHECK_CLOSE(sharded.stockPrice( 3 ), 4.0, 1e-9);
+    BOOST_CHECK_EQUAL(sharded.getPrice( 7 ), 100.0);
+    BOOST_CHECK_CLOSE(sharded.allShareIndex(), single.allShareIndex(), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Stopped, the caller applies what's pending" );
+    sharded.stop();
+    BOOST_CHECK( sharded.pushTrade( 5, 10, true ) );
+    sharded.sync();
+    BOOST_CHECK_EQUAL(sharded.getTradeSize( 5 ), 1001);
+    BOOST_CHECK_THROW( sharded.pushTrade( 40, 10, true ), stock_non_found );
+
+    BOOST_TEST_MESSAGE(  "   Trades keep the time they were pushed at, however late they are applied" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::ShardedExchange timed { 2, 16 };
+    timed.setClock( manual );
+    timed.setBorder( jpmorgan::_5sec );
+    jpmorgan::SymbolId tea = timed.addStock( "TEA", 0.0, 100.0 );
+    timed.setPrice( tea, 10.0 );
+    BOOST_CHECK( timed.pushTrade( tea, 10, false ) );
+    manual.advance( std::chrono::seconds(10) );
+    timed.sync();
+    BOOST_CHECK_EQUAL(timed.getTradeSize( tea ), 1);
+    BOOST_CHECK_EQUAL(timed.stockPrice( tea ), 0.0); // out of the border already
+}
+
+BOOST_AUTO_TEST_CASE( testMain017 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on bulk ratios by stock kind" );
+
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.addStock( "TEA", 0.0, 100.0 );
+    GBCE.addStock( "POP", 8.0, 100.0 );
+    GBCE.addStock( "ALE", 23.0, 60.0 );
+    GBCE.addStock( "GIN", 8.0, 100.0, 0.02 );
+    GBCE.addStock( "JOE", 13.0, 250.0 );
+    for(const char* symbol : { "TEA", "POP", "ALE", "GIN", "JOE" }) { GBCE.setPrice( symbol, 10.0 + GBCE.getSymbolId(symbol) ); }
+
+    BOOST_CHECK_EQUAL(GBCE.getCommons().size(), 4);
+    BOOST_CHECK_EQUAL(GBCE.getPreferreds().size(), 1);
+    BOOST_CHECK_EQUAL(GBCE.getPreferreds().ids()[0], GBCE.getSymbolId("GIN"));
+
+    BOOST_TEST_MESSAGE(  "   Same ratios as stock by stock" );
+    jpmorgan::ratio_columns ratios {};
+    GBCE.ratios( ratios );
+    BOOST_CHECK_EQUAL(ratios.size(), 5);
+    BOOST_CHECK_EQUAL(ratios.ids.back(), GBCE.getSymbolId("GIN")); // Common ones first
+    for(size_t i=0; i<ratios.size(); ++i) {
+       jpmorgan::SymbolId id = ratios.ids[i];
+       BOOST_CHECK_EQUAL(ratios.dividend_yields[i], GBCE.dividendYield( id ));
+       if( 0.0 == GBCE.at( id ).getLastDividend() ) { BOOST_CHECK( std::isinf( ratios.p_e_ratios[i] ) ); }
+       else { BOOST_CHECK_EQUAL(ratios.p_e_ratios[i], GBCE.p_e_ratio( id )); }
+    }
+    BOOST_CHECK_CLOSE(ratios.dividend_yields.back(), 0.02 * 100.0 / 13.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Removed stocks leave, the rest keep their rows right" );
+    GBCE.removeStock( "POP" );
+    GBCE.setPrice( "JOE", 26.0 );
+    GBCE.ratios( ratios );
+    BOOST_CHECK_EQUAL(ratios.size(), 4);
+    BOOST_CHECK_EQUAL(GBCE.getCommons().size(), 3);
+    for(size_t i=0; i<ratios.size(); ++i) {
+       BOOST_CHECK_NE(ratios.ids[i], 1u);
+       if( 4u == ratios.ids[i] ) {
+          BOOST_CHECK_CLOSE(ratios.dividend_yields[i], 0.5, 1e-9);
+          BOOST_CHECK_CLOSE(ratios.p_e_ratios[i], 2.0, 1e-9);
+       }
+       if( 2u == ratios.ids[i] ) { BOOST_CHECK_CLOSE(ratios.dividend_yields[i], 23.0 / 12.0, 1e-9); }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( testMain018 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on whole exchange screening" );
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    for(size_t i=0; i<103; ++i) {
+       jpmorgan::SymbolId id = GBCE.addStock( "S" + std::to_string(i), static_cast<double>( i % 10 ), 100.0, ( 0 == i % 7 ? 0.02 : 0.0 ) );
+       GBCE.setPrice( id, 10.0 + static_cast<double>( ( i * 37 ) % 100 ) );
+       if( 0 != i % 3 ) { GBCE.addTrade( id, 100, false ); }
+       GBCE.setPrice( id, GBCE.getPrice( id ) * 1.1 );
+    }
+    GBCE.removeStock( "S5" );
+
+    BOOST_TEST_MESSAGE(  "   Every row as stock by stock, on every SIMD level" );
+    jpmorgan::simd detected = jpmorgan::detectedSimd();
+    jpmorgan::ExchangeScreen screen;
+    for(jpmorgan::simd level : { jpmorgan::simd::scalar, jpmorgan::simd::sse2, jpmorgan::simd::avx2 })
+    {
+       jpmorgan::setSimd( level );
+       screen.snapshot( GBCE );
+       BOOST_CHECK_EQUAL(screen.size(), 102);
+       for(size_t row=0; row<screen.size(); ++row)
+       {
+          jpmorgan::SymbolId id = screen.getSymbolId( row );
+          const jpmorgan::Stock& stock = GBCE.at( id );
+          BOOST_CHECK_EQUAL(screen.values( jpmorgan::ExchangeScreen::dividend_yield )[row], stock.dividendYield());
+          if( 0.0 < stock.getLastDividend() ) { BOOST_CHECK_EQUAL(screen.values( jpmorgan::ExchangeScreen::p_e_ratio )[row], stock.p_e_ratio()); }
+          double deviation = screen.values( jpmorgan::ExchangeScreen::vwap_deviation )[row];
+          if( 0 == id % 3 ) { BOOST_CHECK( std::isnan( deviation ) ); }
+          else { BOOST_CHECK_CLOSE(deviation, 0.1, 1e-9); }
+       }
+    }
+    jpmorgan::setSimd( detected );
+
+    BOOST_TEST_MESSAGE(  "   Same rows & ratios as GBCE::ratios" );
+    jpmorgan::ratio_columns ratios {};
+    GBCE.ratios( ratios );
+    screen.snapshot( GBCE );
+    BOOST_CHECK( std::equal( ratios.ids.begin(), ratios.ids.end(), screen.ids().begin(), screen.ids().end() ) );
+    BOOST_CHECK( std::equal( ratios.p_e_ratios.begin(), ratios.p_e_ratios.end(), screen.values( jpmorgan::ExchangeScreen::p_e_ratio ).begin() ) );
+    for(size_t row=0; row<screen.size(); ++row) { BOOST_CHECK_EQUAL(screen.values( jpmorgan::ExchangeScreen::dividend_yield )[row], ratios.dividend_yields[row]); }
+
+    BOOST_TEST_MESSAGE(  "   Top k, best first and without NaN nor infinities" );
+    std::vector<size_t> rows;
+    screen.top( jpmorgan::ExchangeScreen::dividend_yield, 5, rows );
+    BOOST_CHECK_EQUAL(rows.size(), 5);
+    jpmorgan::span<const double> yields = screen.values( jpmorgan::ExchangeScreen::dividend_yield );
+    double fifth = yields[ rows.back() ];
+    for(size_t i=1; i<rows.size(); ++i) { BOOST_CHECK_GE(yields[ rows[i-1] ], yields[ rows[i] ]); }
+    BOOST_CHECK_EQUAL(std::count_if( yields.begin(), yields.end(), [fifth](double y) { return y > fifth; } ), 4);
+
+    screen.top( jpmorgan::ExchangeScreen::vwap_deviation, 1000, rows, false );
+    BOOST_CHECK_EQUAL(rows.size(), 67); // traded ones only, S5 was removed
+
+    screen.top( jpmorgan::ExchangeScreen::p_e_ratio, 1000, rows );
+    BOOST_CHECK_EQUAL(rows.size(), 91); // S0, S10... S100 have no dividend
+    GBCE.addStock( "NEW", 5.0, 100.0 ); // no price yet
+    screen.snapshot( GBCE );
+    screen.top( jpmorgan::ExchangeScreen::dividend_yield, 1, rows );
+    BOOST_CHECK_EQUAL(rows.size(), 1);
+    BOOST_CHECK( "NEW" != GBCE.getSymbol( screen.getSymbolId( rows[0] ) ) );
+    BOOST_CHECK( std::isfinite( screen.values( jpmorgan::ExchangeScreen::dividend_yield )[ rows[0] ] ) );
+}
+
+BOOST_AUTO_TEST_CASE( testMain019 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on binary feed decoding & recording" );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    jpmorgan::FeedEncoder encoder;
+    encoder.addStock( 7, "POP", 8.0, 100.0 );
+    encoder.addStock( 9, "GIN", 8.0, 100.0, 0.02 );
+    encoder.setPrice( 7, start, 10.0 );
+    encoder.setPrice( 9, start, 20.0 );
+    encoder.addTrade( 7, start, 100, false );
+    encoder.addTrade( 9, start, 50, true );
+    encoder.addTrade( 7, start, 300, true );
+    encoder.setPrice( 7, start, 30.0 );
+    encoder.addTrade( 7, start + std::chrono::milliseconds(1), 100, false );
+    BOOST_CHECK_EQUAL(encoder.size(), 2 * 30 + 6 + 3 * 21 + 4 * 18);
+
+    BOOST_TEST_MESSAGE(  "   Prices & trades applied in feed order" );
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.addStock( "TEA", 0.0, 100.0 ); // feed ids are not SymbolIds
+    jpmorgan::GBCEFeedHandler handler { GBCE };
+    BOOST_CHECK_EQUAL(handler.apply( encoder.data(), encoder.size() ), encoder.size());
+    BOOST_CHECK_EQUAL(handler.getMessages(), 9);
+    BOOST_CHECK_EQUAL(GBCE.size(), 3);
+    BOOST_CHECK( GBCE.at( "GIN" ).isPreferred() );
+    BOOST_CHECK_EQUAL(GBCE.getPrice( "POP" ), 30.0);
+    BOOST_CHECK_EQUAL(GBCE.at( "POP" ).getTradeSize(), 3);
+    BOOST_CHECK_CLOSE(GBCE.stockPrice( "POP" ), ( 10.0 * 400 + 30.0 * 100 ) / 500.0, 1e-9);
+    BOOST_CHECK_CLOSE(GBCE.stockPrice( "GIN" ), 20.0, 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Partial messages are left for the next buffer" );
+    jpmorgan::GlobalBeverageCorporationExchange split;
+    jpmorgan::GBCEFeedHandler split_handler { split };
+    size_t consumed = split_handler.apply( encoder.data(), 40 );
+    BOOST_CHECK_EQUAL(consumed, 33); // first stock only
+    BOOST_CHECK_EQUAL(split_handler.apply( encoder.data() + consumed, encoder.size() - consumed ), encoder.size() - consumed);
+    BOOST_CHECK_EQUAL(split.getPrice( "POP" ), 30.0);
+
+    const char garbage[] = { 'X', 0, 0, 0 };
+    BOOST_CHECK_THROW( split_handler.apply( garbage, sizeof(garbage) ), unexpected_feed_format );
+    jpmorgan::FeedEncoder unknown;
+    unknown.addTrade( 3, start, 10, false );
+    BOOST_CHECK_THROW( split_handler.apply( unknown.data(), unknown.size() ), stock_non_found );
+
+    BOOST_TEST_MESSAGE(  "   Feed ids beyond the cap rejected, messages before a faulty one kept" );
+    jpmorgan::GlobalBeverageCorporationExchange capped;
+    jpmorgan::GBCEFeedHandler capped_handler { capped, 16 };
+    jpmorgan::FeedEncoder hostile;
+    hostile.addStock( 0xFFFFFFF0u, "BIG", 8.0, 100.0 );
+    BOOST_CHECK_THROW( capped_handler.apply( hostile.data(), hostile.size() ), unexpected_feed_format );
+    BOOST_CHECK_THROW( handler.apply( hostile.data(), hostile.size() ), unexpected_feed_format ); // default cap
+    BOOST_CHECK_EQUAL(capped.size(), 0);
+
+    jpmorgan::FeedEncoder faulty;
+    faulty.addStock( 15, "POP", 8.0, 100.0 );
+    faulty.setPrice( 15, start, 10.0 );
+    faulty.addTrade( 15, start, 10, false );
+    faulty.addStock( 16, "BIG", 8.0, 100.0 );
+    faulty.addTrade( 15, start, 20, false );
+    BOOST_CHECK_THROW( capped_handler.apply( faulty.data(), faulty.size() ), unexpected_feed_format );
+    BOOST_CHECK_EQUAL(capped_handler.getMessages(), 3);
+    BOOST_CHECK_EQUAL(capped.getPrice( "POP" ), 10.0);
+    BOOST_CHECK_EQUAL(capped.at( "POP" ).getTradeSize(), 1); // batch closed by the stock message
+
+    BOOST_TEST_MESSAGE(  "   Quantities beyond 32 bits rejected by the encoder, not wrapped" );
+    jpmorgan::FeedEncoder huge;
+    huge.addTrade( 0, start, 0xFFFFFFFFul, false );
+    size_t encoded = huge.size();
+    BOOST_CHECK_THROW( huge.addTrade( 0, start, 0x100000000ul, false ), unexpected_feed_format );
+    BOOST_CHECK_EQUAL(huge.size(), encoded);
+
+    BOOST_TEST_MESSAGE(  "   Recorded file mapped back" );
+    const std::string path { "testMain019.feed" };
+    {
+       jpmorgan::FeedRecorder recorder { path };
+       recorder.addStock( 0, "ALE", 23.0, 60.0 );
+       for(size_t i=0; i<10000; ++i) { recorder.addTrade( 0, start + std::chrono::microseconds(i), 10, false ); }
+    }
+    {
+       jpmorgan::FeedReader reader { path };
+       BOOST_CHECK_EQUAL(reader.messages().size(), 33 + 10000 * 18);
+       jpmorgan::GlobalBeverageCorporationExchange recorded;
+       jpmorgan::GBCEFeedHandler recorded_handler { recorded };
+       recorded_handler.apply( reader.messages() );
+       BOOST_CHECK_EQUAL(recorded.at( "ALE" ).getTradeSize(), 10000);
+    }
+    std::remove( path.c_str() );
+    BOOST_CHECK_THROW( jpmorgan::FeedReader{ path }, feed_io_error );
+}
+
+BOOST_AUTO_TEST_CASE( testMain020 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on exchange snapshots" );
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    GBCE.setBorder( jpmorgan::_5sec );
+    GBCE.addWindow( std::chrono::minutes(1) );
+    GBCE.addStock( "TEA", 0.0, 100.0 );
+    GBCE.addStock( "POP", 8.0, 100.0 );
+    GBCE.addStock( "GIN", 8.0, 100.0, 0.02 );
+    GBCE.setPrice( "TEA", 10.0 );
+    GBCE.setPrice( "POP", 20.0 );
+    GBCE.setPrice( "GIN", 30.0 );
+    for(size_t i=0; i<100; ++i) {
+       GBCE.addTrade( static_cast<jpmorgan::SymbolId>( i % 3 ), 10 + i, 0 == i % 2 );
+       manual.advance( std::chrono::milliseconds(100) );
+       if( 50 == i ) { GBCE.setPrice( "POP", 25.0 ); }
+    }
+    GBCE.removeStock( "TEA" );
+    GBCE.addStock( "TEA", 1.0, 100.0 ); // listed again, new id
+    GBCE.setPrice( "TEA", 12.0 );
+
+    BOOST_TEST_MESSAGE(  "   Captured, written in the background & restored" );
+    const std::string path { "testMain020.snapshot" };
+    jpmorgan::SnapshotWriter writer;
+    writer.capture( GBCE );
+    writer.saveInBackground( path );
+    GBCE.addTrade( "GIN", 1000, false ); // ingestion goes on meanwhile
+    writer.capture( GBCE ); // the other buffer
+    writer.wait();
+
+    jpmorgan::GlobalBeverageCorporationExchange restored;
+    restored.setClock( manual );
+    {
+       jpmorgan::SnapshotReader reader { path };
+       jpmorgan::restoreSnapshot( restored, reader.bytes() );
+    }
+    std::remove( path.c_str() );
+
+    BOOST_CHECK_EQUAL(restored.size(), 3);
+    BOOST_CHECK_EQUAL(restored.getSlotCount(), 4);
+    BOOST_CHECK( !restored.isListed( 0 ) );
+    BOOST_CHECK_EQUAL(restored.getSymbolId( "TEA" ), 3);
+    BOOST_CHECK_EQUAL(restored.getBorder( 0 ).count(), 5000);
+    BOOST_CHECK_EQUAL(restored.getBorder( 1 ).count(), 60000);
+    BOOST_CHECK( restored.at( "GIN" ).isPreferred() );
+    BOOST_CHECK_EQUAL(restored.getPrice( "POP" ), 25.0);
+    BOOST_CHECK_EQUAL(restored.at( "GIN" ).getTradeSize(), GBCE.at( "GIN" ).getTradeSize() - 1);
+    BOOST_CHECK_CLOSE(restored.allShareIndex(), GBCE.allShareIndex(), 1e-9);
+    for(const char* symbol : { "POP", "GIN" }) {
+       jpmorgan::window_stats original = GBCE.windowStats( symbol, 1 );
+       jpmorgan::window_stats copy = restored.windowStats( symbol, 1 );
+       if( std::string{"GIN"} == symbol ) { original.quantity -= 1000; }
+       BOOST_CHECK_EQUAL(copy.quantity, original.quantity);
+    }
+    BOOST_CHECK_CLOSE(restored.stockPrice( "POP" ), GBCE.stockPrice( "POP" ), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Second capture has the trade added meanwhile" );
+    jpmorgan::GlobalBeverageCorporationExchange latest;
+    latest.setClock( manual );
+    jpmorgan::restoreSnapshot( latest, writer.bytes() );
+    BOOST_CHECK_EQUAL(latest.at( "GIN" ).getTradeSize(), GBCE.at( "GIN" ).getTradeSize());
+    BOOST_CHECK_CLOSE(latest.stockPrice( "GIN" ), GBCE.stockPrice( "GIN" ), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Saving while a background save goes on: the latest capture ends up whole in the file" );
+    writer.capture( GBCE );
+    writer.saveInBackground( path );
+    GBCE.addTrade( "POP", 500, true );
+    writer.capture( GBCE );
+    writer.save( path );
+    {
+       jpmorgan::SnapshotReader reader { path };
+       BOOST_CHECK( std::equal( reader.bytes().begin(), reader.bytes().end(), writer.bytes().begin(), writer.bytes().end() ) );
+    }
+    BOOST_CHECK( nullptr == std::fopen( ( path + ".tmp" ).c_str(), "r" ) );
+    std::remove( path.c_str() );
+
+    jpmorgan::GlobalBeverageCorporationExchange broken;
+    BOOST_CHECK_THROW( jpmorgan::restoreSnapshot( broken, jpmorgan::span<const char>{ writer.bytes().data(), 40 } ), unexpected_snapshot_format );
+}
+
+BOOST_AUTO_TEST_CASE( testMain021 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on hot path metrics" );
+
+    BOOST_TEST_MESSAGE(  "   Histogram buckets within 1/16 of the value" );
+    BOOST_CHECK_EQUAL(jpmorgan::Histogram::bucketOf( 15 ), 15);
+    BOOST_CHECK_EQUAL(jpmorgan::Histogram::bucketOf( 31 ), 31);
+    BOOST_CHECK_EQUAL(jpmorgan::Histogram::bucketOf( 32 ), 32);
+    BOOST_CHECK_EQUAL(jpmorgan::Histogram::bucketOf( 33 ), 32);
+    BOOST_CHECK_EQUAL(jpmorgan::Histogram::bucketOf( ~std::uint64_t{0} ), jpmorgan::Histogram::bucket_count - 1);
+    for(std::uint64_t value : { 0ull, 7ull, 100ull, 1000ull, 123456789ull, 1ull << 40 }) {
+       std::uint64_t lowest = jpmorgan::Histogram::lowestOf( jpmorgan::Histogram::bucketOf( value ) );
+       BOOST_CHECK( lowest <= value );
+       BOOST_CHECK( value - lowest <= value / 16 );
+    }
+
+    jpmorgan::Histogram histogram;
+    for(std::uint64_t value=1; value<=1000; ++value) { histogram.record( value ); }
+    BOOST_CHECK_EQUAL(histogram.count(), 1000);
+    BOOST_CHECK_EQUAL(histogram.max(), 1000);
+    BOOST_CHECK( histogram.percentile( 0.5 ) >= 500 && histogram.percentile( 0.5 ) <= 500 + 500 / 16 );
+    BOOST_CHECK( histogram.percentile( 0.99 ) >= 990 && histogram.percentile( 0.99 ) <= 1000 );
+    BOOST_CHECK_EQUAL(histogram.percentile( 1.0 ), 1000);
+    histogram.reset();
+    BOOST_CHECK_EQUAL(histogram.count(), 0);
+    BOOST_CHECK_EQUAL(histogram.percentile( 0.5 ), 0);
+
+    BOOST_TEST_MESSAGE(  "   Exchange hot paths recorded" );
+    jpmorgan::exchange_metrics& metrics = jpmorgan::exchangeMetrics();
+    metrics.reset();
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    GBCE.setBorder( jpmorgan::_5sec );
+    GBCE.addStock( "TEA", 0.0, 100.0 );
+    GBCE.addStock( "POP", 8.0, 100.0 );
+    GBCE.setPrice( "TEA", 10.0 );
+    GBCE.setPrice( "POP", 20.0 );
+    for(size_t i=0; i<100; ++i) {
+       GBCE.addTrade( static_cast<jpmorgan::SymbolId>( i % 2 ), 10 + i, true );
+       manual.advance( std::chrono::milliseconds(100) );
+    }
+    BOOST_CHECK_EQUAL(metrics.trades_in.load(), 100);
+    BOOST_CHECK_EQUAL(metrics.add_trade.count(), 100);
+
+    GBCE.allShareIndex();
+    std::uint64_t recomputes = metrics.index_recomputes.load();
+    std::uint64_t cached = metrics.index_cached.load();
+    GBCE.allShareIndex(); // nothing changed in between
+    BOOST_CHECK_EQUAL(metrics.index_recomputes.load(), recomputes);
+    BOOST_CHECK_EQUAL(metrics.index_cached.load(), cached + 1);
+    BOOST_CHECK_EQUAL(metrics.all_share_index.count(), 2);
+
+    GBCE.stockPrice( "TEA" );
+    BOOST_CHECK( 1 <= metrics.stock_price.count() );
+
+    manual.advance( jpmorgan::_5sec );
+    GBCE.clearOldTrades();
+    BOOST_CHECK_EQUAL(metrics.clear_old_trades.count(), 1);
+    BOOST_CHECK_EQUAL(metrics.trades_expired.load(), 100);
+    BOOST_CHECK_EQUAL(metrics.window_trades.max(), 0);
+    BOOST_CHECK_EQUAL(metrics.window_trades.count(), 2);
+
+    BOOST_CHECK_THROW( GBCE.getSymbolId( "GIN" ), stock_non_found );
+    BOOST_CHECK_EQUAL(metrics.symbols_non_found.load(), 1);
+
+    BOOST_TEST_MESSAGE(  "   Dumped as text while running" );
+    std::ostringstream dump;
+    metrics.dump( dump );
+    BOOST_CHECK( std::string::npos != dump.str().find( "add_trade count=100 " ) );
+    BOOST_CHECK( std::string::npos != dump.str().find( "trades_in 100\n" ) );
+    BOOST_CHECK( std::string::npos != dump.str().find( "symbols_non_found 1\n" ) );
+
+    BOOST_TEST_MESSAGE(  "   Timers share a scope and nest" );
+    {
+       JPMORGAN_METRICS_TIME( add_trade );
+       JPMORGAN_METRICS_TIME( stock_price );
+       {
+          JPMORGAN_METRICS_TIME( add_trade );
+       }
+    }
+    BOOST_CHECK_EQUAL(metrics.add_trade.count(), 102);
+    metrics.reset();
+}
+
+BOOST_AUTO_TEST_CASE( testMain022 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on published read snapshots" );
+
+    BOOST_TEST_MESSAGE(  "   Seqlocked values never torn between one writer and several readers" );
+    struct five_words { std::uint64_t w[5]; };
+    jpmorgan::SeqLock<five_words> lock { five_words{ {0, 0, 0, 0, 0} } };
+    std::atomic<bool> done { false };
+    std::atomic<size_t> torn { 0 };
+    std::vector<std::thread> readers;
+    for(size_t r=0; r<3; ++r) {
+       readers.emplace_back( [&]() {
+          std::uint64_t last {0};
+          while( !done.load() ) {
+             five_words value = lock.load();
+             for(auto w : value.w) { if( w != value.w[0] ) { ++torn; } }
+             if( value.w[0] < last ) { ++torn; }
+             last = value.w[0];
+          }
+       });
+    }
+    for(std::uint64_t i=1; i<=200000; ++i) { lock.store( five_words{ {i, i, i, i, i} } ); }
+    done = true;
+    for(auto& reader : readers) { reader.join(); }
+    BOOST_CHECK_EQUAL(torn.load(), 0);
+    BOOST_CHECK_EQUAL(lock.load().w[4], 200000);
+    BOOST_CHECK_EQUAL(lock.getSequence(), 2 * 200001);
+
+    BOOST_TEST_MESSAGE(  "   Exchange figures published" );
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    GBCE.addStock( "TEA", 0.0, 100.0 );
+    GBCE.addStock( "POP", 8.0, 100.0 );
+    GBCE.addStock( "GIN", 8.0, 100.0, 0.02 );
+    GBCE.setPrice( "TEA", 10.0 );
+    GBCE.setPrice( "POP", 20.0 );
+    GBCE.setPrice( "GIN", 40.0 );
+    GBCE.addTrade( "POP", 100, false );
+
+    jpmorgan::PublishedExchange published { 8 };
+    BOOST_CHECK_EQUAL(published.getVersion(), 0);
+    BOOST_CHECK( !published.at( 1 ).listed );
+    published.publish( GBCE );
+
+    jpmorgan::published_stock pop = published.at( GBCE.getSymbolId( "POP" ) );
+    BOOST_CHECK( pop.listed );
+    BOOST_CHECK_EQUAL(pop.version, 1);
+    BOOST_CHECK_EQUAL(pop.price, 20.0);
+    BOOST_CHECK_CLOSE(pop.stock_price, GBCE.stockPrice( "POP" ), 1e-9);
+    BOOST_CHECK_CLOSE(pop.dividend_yield, GBCE.dividendYield( "POP" ), 1e-9);
+    BOOST_CHECK_CLOSE(pop.p_e_ratio, GBCE.p_e_ratio( "POP" ), 1e-9);
+    BOOST_CHECK_CLOSE(published.at( 2 ).dividend_yield, GBCE.dividendYield( "GIN" ), 1e-9);
+    BOOST_CHECK_CLOSE(published.allShareIndex(), GBCE.allShareIndex(), 1e-9);
+    BOOST_CHECK_EQUAL(published.index().stocks, 3);
+    BOOST_CHECK( published.index().time == manual.now() );
+
+    BOOST_TEST_MESSAGE(  "   Nothing changes until published again" );
+    GBCE.setPrice( "POP", 25.0 );
+    GBCE.removeStock( "TEA" );
+    BOOST_CHECK_EQUAL(published.at( 1 ).price, 20.0);
+    BOOST_CHECK( published.at( 0 ).listed );
+    published.publish( GBCE );
+    BOOST_CHECK_EQUAL(published.at( 1 ).price, 25.0);
+    BOOST_CHECK( !published.at( 0 ).listed );
+    BOOST_CHECK_EQUAL(published.at( 0 ).version, 2);
+    BOOST_CHECK_EQUAL(published.getVersion(), 2);
+    BOOST_CHECK_THROW( published.at( 8 ), stock_non_found );
+
+    jpmorgan::PublishedExchange small { 2 };
+    BOOST_CHECK_THROW( small.publish( GBCE ), publish_capacity_exceeded );
+    BOOST_CHECK_EQUAL(small.getVersion(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Readers polling while the exchange publishes" );
+    done = false;
+    std::atomic<size_t> inconsistent { 0 };
+    jpmorgan::SymbolId id = GBCE.getSymbolId( "POP" );
+    readers.clear();
+    for(size_t r=0; r<3; ++r) {
+       readers.emplace_back( [&]() {
+          std::uint64_t last {0};
+          while( !done.load() ) {
+             jpmorgan::published_stock row = published.at( id );
+             if( row.dividend_yield != 8.0 / row.price || row.version < last ) { ++inconsistent; }
+             last = row.version;
+          }
+       });
+    }
+    for(size_t i=0; i<2000; ++i) {
+       GBCE.setPrice( id, 1.0 + i );
+       published.publish( GBCE );
+    }
+    done = true;
+    for(auto& reader : readers) { reader.join(); }
+    BOOST_CHECK_EQUAL(inconsistent.load(), 0);
+    BOOST_CHECK_EQUAL(published.at( id ).price, 2000.0);
+}
+
+BOOST_AUTO_TEST_CASE( testMain023 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on fixed-point tick prices" );
+
+    BOOST_TEST_MESSAGE(  "   Prices to the nearest tick and back" );
+    BOOST_CHECK_EQUAL(jpmorgan::toTicks( 12.3456 ), 123456);
+    BOOST_CHECK_EQUAL(jpmorgan::toTicks( 0.00004 ), 0);
+    BOOST_CHECK_EQUAL(jpmorgan::toTicks( 0.00006 ), 1);
+    BOOST_CHECK_EQUAL(jpmorgan::toPrice( jpmorgan::ticks{123456} ), 12.3456);
+    BOOST_CHECK( jpmorgan::tick_sum::product( 0.1, 3 ) == 3000 );
+
+    BOOST_TEST_MESSAGE(  "   Windows back to the very same bits after subtracting" );
+    jpmorgan::VwapWindow<jpmorgan::tick_sum> sliding;
+    sliding.add( 0.1, 3 );
+    double before = sliding.stockPrice();
+    sliding.add( 1e9, 1 );
+    for(size_t i=0; i<100000; ++i) { sliding.add( 0.1, 3 ); }
+    sliding.subtract( 1e9, 1 );
+    for(size_t i=0; i<100000; ++i) { sliding.subtract( 0.1, 3 ); }
+    BOOST_CHECK_EQUAL(sliding.stockPrice(), before);
+    BOOST_CHECK_EQUAL(sliding.stockPrice(), 0.1);
+
+    BOOST_TEST_MESSAGE(  "   Same sums whatever the order or the batching" );
+    std::vector<jpmorgan::trade_data> trades;
+    for(size_t i=0; i<1000; ++i) { trades.push_back( jpmorgan::trade_data{ 1 + (i * 104729) % 500, false, 10.0 + (i * 7919) % 1000 / 100.0 } ); }
+    jpmorgan::VwapWindow<jpmorgan::tick_sum> forward, backward, batch;
+    jpmorgan::tick_sum s_pxq {};
+    unsigned long long s_q {0};
+    for(const auto& trade : trades) {
+       forward.add( trade.price, trade.quantity );
+       s_pxq.add( jpmorgan::tick_sum::product( trade.price, trade.quantity ) );
+       s_q += trade.quantity;
+    }
+    for(auto it = trades.rbegin(); it != trades.rend(); ++it) { backward.add( it->price, it->quantity ); }
+    batch.add( s_pxq, s_q, trades.size() );
+    BOOST_CHECK_EQUAL(forward.stockPrice(), backward.stockPrice());
+    BOOST_CHECK_EQUAL(forward.stockPrice(), batch.stockPrice());
+
+    jpmorgan::VwapWindow<jpmorgan::plain_sum> reference;
+    for(const auto& trade : trades) { reference.add( trade.price, trade.quantity ); }
+    BOOST_CHECK_CLOSE(forward.stockPrice(), reference.stockPrice(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE( testMain024 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on the virtual time load generator" );
+
+    BOOST_TEST_MESSAGE(  "   Options parsed, the rest left by default" );
+    jpmorgan::simulation_config config = jpmorgan::parseSimulation( { "--symbols", "50", "--rate", "1000", "--price-rate", "100", "--seconds", "2", "--window", "0.5", "--price", "uniform" } );
+    BOOST_CHECK_EQUAL(config.symbols, 50);
+    BOOST_CHECK_EQUAL(config.trade_rate, 1000.0);
+    BOOST_CHECK_EQUAL(config.duration.count(), 2000);
+    BOOST_CHECK_EQUAL(config.window.count(), 500);
+    BOOST_CHECK_EQUAL(config.index_interval.count(), 50);
+    BOOST_CHECK( jpmorgan::simulation_config::uniform == config.prices );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--symbols" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--symbols", "many" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--price", "normal" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--speed", "1" } ), unexpected_option );
+    BOOST_CHECK_EQUAL(jpmorgan::parseSimulation( { "--seed", "18446744073709551615" } ).seed, 18446744073709551615ull);
+    BOOST_CHECK_EQUAL(jpmorgan::parseSimulation( { "--seed", "9007199254740993" } ).seed, 9007199254740993ull);
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--seed", "18446744073709551616" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--seed", "1e30" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseSimulation( { "--seed", "-1" } ), unexpected_option );
+    for(const char* name : { "--symbols", "--rate", "--price-rate", "--seconds", "--window", "--index-ms", "--clear-ms" })
+    {
+       BOOST_CHECK_THROW( jpmorgan::parseSimulation( { name, "inf" } ), unexpected_option );
+       BOOST_CHECK_THROW( jpmorgan::parseSimulation( { name, "nan" } ), unexpected_option );
+       BOOST_CHECK_THROW( jpmorgan::parseSimulation( { name, "1e30" } ), unexpected_option );
+    }
+
+    BOOST_TEST_MESSAGE(  "   Every stream at its own pace of virtual time" );
+    jpmorgan::simulation_report report = jpmorgan::simulate( config );
+    BOOST_CHECK_EQUAL(report.trades, 2000);
+    BOOST_CHECK_EQUAL(report.price_ticks, 200);
+    BOOST_CHECK_EQUAL(report.index_queries, 39);
+    BOOST_CHECK_EQUAL(report.clears, 99);
+    BOOST_CHECK( report.index_recomputes <= report.index_queries );
+    BOOST_CHECK_EQUAL(report.virtual_seconds, 2.0);
+    BOOST_CHECK( 0 < report.peak_rss_kb );
+    BOOST_CHECK( 0.0 < report.tradesPerSecond() );
+
+    BOOST_TEST_MESSAGE(  "   Without price ticks the index is calculated once" );
+    config.price_rate = 0.0;
+    report = jpmorgan::simulate( config );
+    BOOST_CHECK_EQUAL(report.price_ticks, 0);
+    BOOST_CHECK_EQUAL(report.index_recomputes, 1);
+}
+
+BOOST_AUTO_TEST_CASE( testMain025 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on parallel backtests" );
+
+    BOOST_TEST_MESSAGE(  "   Every task run once, tasks submitted by tasks too" );
+    jpmorgan::WorkStealingPool pool { 4 };
+    BOOST_CHECK_EQUAL(pool.size(), 4);
+    std::atomic<size_t> runs { 0 };
+    for(size_t i=0; i<100; ++i) {
+       pool.submit( [&]() {
+          ++runs;
+          for(size_t j=0; j<9; ++j) { pool.submit( [&]() { ++runs; } ); }
+       });
+    }
+    pool.wait();
+    BOOST_CHECK_EQUAL(runs.load(), 1000);
+
+    BOOST_TEST_MESSAGE(  "   First task exception rethrown by 'wait', the pool still usable" );
+    pool.submit( []() { throw stock_non_found(); } );
+    BOOST_CHECK_THROW( pool.wait(), stock_non_found );
+    pool.submit( [&]() { ++runs; } );
+    pool.wait();
+    BOOST_CHECK_EQUAL(runs.load(), 1001);
+
+    BOOST_TEST_MESSAGE(  "   A run samples what a live exchange would show" );
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    std::vector<jpmorgan::journal_record> records;
+    jpmorgan::SyntheticFeed feed;
+    for(size_t i=0; i<3000; ++i) {
+       jpmorgan::journal_record record {};
+       record.setTimestamp( start + std::chrono::milliseconds( 10 * i ) );
+       record.id = static_cast<std::uint32_t>( feed.index( 3 ) );
+       record.value = feed.price( 1.0, 200.0 );
+       record.kind = ( 0 == i % 10 ? jpmorgan::journal_record::price : jpmorgan::journal_record::trade );
+       record.quantity = feed.quantity();
+       records.push_back( record );
+    }
+    BOOST_CHECK_EQUAL(jpmorgan::journalStocks( records ), 3);
+
+    jpmorgan::backtest_config config { jpmorgan::_5sec, std::chrono::milliseconds(1000) };
+    jpmorgan::backtest_series series = jpmorgan::runBacktest( records, 3, config );
+    BOOST_CHECK_EQUAL(series.size(), 30);
+    BOOST_CHECK_EQUAL(series.vwaps.size(), 90);
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual, start };
+    jpmorgan::GlobalBeverageCorporationExchange live;
+    live.setClock( manual );
+    live.setBorder( jpmorgan::_5sec );
+    for(size_t id=0; id<3; ++id) { live.addStock( "S" + std::to_string(id), 0.0, 100.0 ); }
+    live.replay( jpmorgan::span<const jpmorgan::journal_record>{ records.data(), 1500 } ); // first 15 seconds
+    manual.set( start + std::chrono::seconds(15) );
+    BOOST_CHECK( series.times[14] == manual.now() );
+    BOOST_CHECK_CLOSE(series.all_share_index[14], live.allShareIndex(), 1e-9);
+    for(jpmorgan::SymbolId id=0; id<3; ++id) { BOOST_CHECK_CLOSE(series.vwap(14)[id], live.stockPrice(id), 1e-9); }
+
+    std::ostringstream csv;
+    series.write( csv );
+    BOOST_CHECK_EQUAL(csv.str().substr( 0, 30 ), "time,all_share_index,S0,S1,S2\n" );
+
+    BOOST_TEST_MESSAGE(  "   A sweep in parallel gives the runs one at a time" );
+    jpmorgan::backtest_options options = jpmorgan::parseBacktest( { "day.journal", "--borders", "1:3:1,10", "--interval-ms", "500,1000", "--threads", "4" } );
+    BOOST_CHECK_EQUAL(options.journal, "day.journal");
+    BOOST_CHECK_EQUAL(options.threads, 4);
+    BOOST_CHECK_EQUAL(options.configs.size(), 8);
+    BOOST_CHECK_EQUAL(options.configs[7].border.count(), 10000);
+    BOOST_CHECK_EQUAL(options.configs[7].interval.count(), 1000);
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "--borders", "5" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--borders", "5:x" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--speed", "1" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--borders", "900:60" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--borders", "inf" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--borders", "1:inf" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--interval-ms", "nan" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--interval-ms", "1e300" } ), unexpected_option );
+    BOOST_CHECK_THROW( jpmorgan::parseBacktest( { "day.journal", "--borders", "1:900:1e-9" } ), unexpected_option );
+    BOOST_CHECK_EQUAL(jpmorgan::parseBacktest( { "day.journal", "--borders", "60:60" } ).configs.size(), 1);
+
+    std::vector<jpmorgan::backtest_series> parallel( options.configs.size() );
+    jpmorgan::runBacktests( records, 3, options.configs, pool, [&parallel](size_t run, const jpmorgan::backtest_series& result) { parallel[run] = result; } );
+    for(size_t run=0; run<options.configs.size(); ++run) {
+       jpmorgan::backtest_series alone = jpmorgan::runBacktest( records, 3, options.configs[run] );
+       BOOST_CHECK_EQUAL(parallel[run].config.border.count(), options.configs[run].border.count());
+       BOOST_CHECK( parallel[run].all_share_index == alone.all_share_index );
+       BOOST_CHECK( parallel[run].vwaps == alone.vwaps );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( testMain026 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on change notifications" );
+
+    jpmorgan::Clock manual { jpmorgan::Clock::manual };
+    jpmorgan::GlobalBeverageCorporationExchange GBCE;
+    GBCE.setClock( manual );
+    jpmorgan::SymbolId tea = GBCE.addStock( "TEA", 0.0, 100.0 );
+    jpmorgan::SymbolId pop = GBCE.addStock( "POP", 8.0, 100.0 );
+    GBCE.setPrice( tea, 100.0 );
+    GBCE.setPrice( pop, 100.0 );
+
+    jpmorgan::ChangeNotifier notifier { GBCE };
+    std::vector<jpmorgan::change_update> updates;
+    auto record = [&updates](const jpmorgan::change_update& update) { updates.push_back( update ); };
+
+    BOOST_TEST_MESSAGE(  "   First value always sent, then only changes beyond the threshold" );
+    jpmorgan::subscription_options absolute { 0.5, jpmorgan::subscription_options::absolute, std::chrono::milliseconds(0) };
+    size_t on_tea = notifier.subscribeStock( "TEA", record, absolute );
+    BOOST_CHECK_THROW( notifier.subscribeStock( "GIN", record ), stock_non_found );
+    jpmorgan::ChangeNotifier::queue_type unused { 4 };
+    BOOST_CHECK_THROW( notifier.subscribeStock( jpmorgan::SymbolId{42}, record ), stock_non_found );
+    BOOST_CHECK_THROW( notifier.subscribeStock( jpmorgan::SymbolId{42}, unused ), stock_non_found );
+    BOOST_CHECK_EQUAL(notifier.size(), 1);
+    {
+       jpmorgan::GlobalBeverageCorporationExchange trimmed;
+       jpmorgan::SymbolId removed = trimmed.addStock( "TEA", 0.0, 100.0 );
+       trimmed.removeStock( "TEA" );
+       jpmorgan::ChangeNotifier late { trimmed };
+       BOOST_CHECK_THROW( late.subscribeStock( removed, record ), stock_non_found );
+       BOOST_CHECK_THROW( late.subscribeStock( "TEA", unused ), stock_non_found );
+       BOOST_CHECK_EQUAL(late.size(), 0);
+    }
+    GBCE.addTrade( tea, 10, true );
+    BOOST_CHECK_EQUAL(notifier.notify(), 1);
+    BOOST_CHECK_EQUAL(updates.back().subscription, on_tea);
+    BOOST_CHECK_EQUAL(updates.back().kind, jpmorgan::change_update::vwap);
+    BOOST_CHECK_EQUAL(updates.back().id, tea);
+    BOOST_CHECK_CLOSE(updates.back().value, 100.0, 1e-9);
+    BOOST_CHECK( std::isnan( updates.back().previous ) );
+
+    BOOST_CHECK_EQUAL(notifier.notify(), 0); // nothing moved
+    GBCE.setPrice( tea, 100.8 );
+    GBCE.addTrade( tea, 10, true ); // VWAP 100.4
+    BOOST_CHECK_EQUAL(notifier.notify(), 0);
+    GBCE.addTrade( tea, 20, true ); // VWAP 100.6
+    BOOST_CHECK_EQUAL(notifier.notify(), 1);
+    BOOST_CHECK_CLOSE(updates.back().value, 100.6, 1e-9);
+    BOOST_CHECK_CLOSE(updates.back().previous, 100.0, 1e-9);
+    notifier.unsubscribe( on_tea );
+    BOOST_CHECK_EQUAL(notifier.size(), 0);
+
+    BOOST_TEST_MESSAGE(  "   A burst within the interval coalesced into one update" );
+    updates.clear();
+    jpmorgan::subscription_options coalesced { 0.0, jpmorgan::subscription_options::absolute, std::chrono::milliseconds(100) };
+    notifier.subscribeStock( pop, record, coalesced );
+    BOOST_CHECK_EQUAL(notifier.notify(), 1);
+    for(size_t i=0; i<10000; ++i) {
+       GBCE.setPrice( pop, 100.0 + ( i % 7 ) );
+       GBCE.addTrade( pop, 1, 0 == i % 2 );
+       manual.advance( std::chrono::microseconds(1) ); // 10ms of trades
+       notifier.notify();
+    }
+    BOOST_CHECK_EQUAL(updates.size(), 1);
+    manual.advance( std::chrono::milliseconds(100) );
+    BOOST_CHECK_EQUAL(notifier.notify(), 1);
+    BOOST_CHECK_EQUAL(updates.size(), 2);
+    BOOST_CHECK_CLOSE(updates.back().value, GBCE.stockPrice( pop ), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Relative thresholds on the index, into a queue" );
+    jpmorgan::ChangeNotifier::queue_type queue { 2 };
+    jpmorgan::subscription_options relative { 0.01, jpmorgan::subscription_options::relative, std::chrono::milliseconds(0) };
+    size_t on_index = notifier.subscribeIndex( queue, relative );
+    notifier.notify();
+    jpmorgan::change_update update {};
+    BOOST_REQUIRE( queue.pop( update ) );
+    BOOST_CHECK_EQUAL(update.subscription, on_index);
+    BOOST_CHECK_EQUAL(update.kind, jpmorgan::change_update::index);
+    BOOST_CHECK_CLOSE(update.value, GBCE.allShareIndex(), 1e-9);
+    double sent = update.value;
+
+    GBCE.setPrice( tea, GBCE.getPrice( tea ) * 1.01 ); // index up by half a percent
+    notifier.notify();
+    BOOST_CHECK( !queue.pop( update ) );
+    GBCE.setPrice( tea, GBCE.getPrice( tea ) * 1.03 );
+    notifier.notify();
+    BOOST_REQUIRE( queue.pop( update ) );
+    BOOST_CHECK_CLOSE(update.previous, sent, 1e-9);
+    BOOST_CHECK_GT(update.value, sent * 1.01);
+
+    BOOST_TEST_MESSAGE(  "   A full queue drops the update and tries again" );
+    for(size_t i=0; i<3; ++i) {
+       GBCE.setPrice( tea, GBCE.getPrice( tea ) * 1.1 );
+       notifier.notify();
+    }
+    BOOST_CHECK_EQUAL(notifier.getDropped(), 1);
+    BOOST_CHECK( queue.pop( update ) );
+    BOOST_CHECK( queue.pop( update ) );
+    BOOST_CHECK_EQUAL(notifier.notify(), 1); // the value dropped last time
+    BOOST_REQUIRE( queue.pop( update ) );
+    BOOST_CHECK_CLOSE(update.value, GBCE.allShareIndex(), 1e-9);
+
+    BOOST_TEST_MESSAGE(  "   Callbacks may unsubscribe themselves and subscribe others" );
+    notifier.unsubscribe( on_index );
+    size_t once {0};
+    size_t self = notifier.subscribeIndex( [&](const jpmorgan::change_update& u) {
+       notifier.unsubscribe( u.subscription );
+       notifier.subscribeStock( tea, record );
+       ++once;
+    });
+    BOOST_CHECK_EQUAL(notifier.size(), 2);
+    notifier.notify();
+    BOOST_CHECK_EQUAL(once, 1);
+    BOOST_CHECK_EQUAL(notifier.size(), 2);
+    BOOST_CHECK_NE(self, on_index);
+    updates.clear();
+    notifier.notify();
+    BOOST_CHECK_EQUAL(updates.size(), 1); // the new one on TEA, POP within its interval and unchanged
+    BOOST_CHECK_EQUAL(updates.back().id, tea);
+
+    BOOST_TEST_MESSAGE(  "   Removed stocks go quiet" );
+    GBCE.removeStock( "TEA" );
+    GBCE.addTrade( pop, 1, true );
+    updates.clear();
+    manual.advance( std::chrono::milliseconds(100) );
+    notifier.notify();
+    for(const auto& u : updates) { BOOST_CHECK_NE(u.id, tea); }
+}
+
+BOOST_AUTO_TEST_CASE( testMain027 ) {
+    BOOST_TEST_MESSAGE(  "\nTests on the trade ring buffer" );
+
+    jpmorgan::timestamp start = std::chrono::system_clock::now();
+    auto at = [start](size_t i) { return start + std::chrono::milliseconds(i); };
+    auto check = [&](const jpmorgan::TradeStore& store, size_t from, size_t to) {
+       BOOST_REQUIRE_EQUAL(store.size(), to - from);
+       for(size_t i=from; i<to; ++i) {
+          BOOST_CHECK( store.getTimestamp(i) == at(i) );
+          BOOST_CHECK_EQUAL(store.getQuantity(i), i);
+          BOOST_CHECK_EQUAL(store.getPrice(i), 0.5 * i);
+          BOOST_CHECK_EQUAL(store.getIndicator(i), 0 == i % 3);
+       }
+    };
+
+    BOOST_TEST_MESSAGE(  "   The tail wraps around without growing" );
+    jpmorgan::TradeStore store;
+    size_t pushed {0};
+    for(; pushed<16; ++pushed) { store.push_back( at(pushed), jpmorgan::trade_data{ pushed, 0 == pushed % 3, 0.5 * pushed } ); }
+    BOOST_CHECK_EQUAL(store.capacity(), 16);
+    store.pop_front_until( 10 );
+    BOOST_CHECK_EQUAL(store.head(), 10);
+    for(; pushed<26; ++pushed) { store.push_back( at(pushed), jpmorgan::trade_data{ pushed, 0 == pushed % 3, 0.5 * pushed } ); }
+    BOOST_CHECK_EQUAL(store.capacity(), 16);
+    check( store, 10, 26 );
+
+    BOOST_TEST_MESSAGE(  "   Growing with a wrapped head keeps every sequence" );
+    store.push_back( at(pushed), jpmorgan::trade_data{ pushed, 0 == pushed % 3, 0.5 * pushed } );
+    ++pushed;
+    BOOST_CHECK_EQUAL(store.capacity(), 32);
+    check( store, 10, 27 );
+    std::vector<unsigned long> quantities {};
+    for(const auto& trade : store) { quantities.push_back( trade.second.quantity ); }
+    BOOST_CHECK_EQUAL(quantities.front(), 10);
+    BOOST_CHECK_EQUAL(quantities.back(), 26);
+
+    BOOST_TEST_MESSAGE(  "   Heads never go back nor past the tail" );
+    store.pop_front_until( 5 );
+    BOOST_CHECK_EQUAL(store.head(), 10);
+    store.pop_front_until( 100 );
+    BOOST_CHECK( store.empty() );
+    BOOST_CHECK_EQUAL(store.head(), store.tail());
+    BOOST_CHECK_EQUAL(store.capacity(), 32);
+
+    BOOST_TEST_MESSAGE(  "   Moved from stores are empty and usable" );
+    for(size_t i=27; i<40; ++i) { store.push_back( at(i), jpmorgan::trade_data{ i, 0 == i % 3, 0.5 * i } ); }
+    jpmorgan::TradeStore moved { std::move(store) };
+    check( moved, 27, 40 );
+    BOOST_CHECK( store.empty() );
+    BOOST_CHECK_EQUAL(store.capacity(), 0);
+    BOOST_CHECK_EQUAL(store.head(), store.tail());
+    store.push_back( at(0), jpmorgan::trade_data{ 0, true, 0.0 } );
+    check( store, 0, 1 );
+
+    jpmorgan::TradeStore assigned;
+    assigned = std::move( moved );
+    check( assigned, 27, 40 );
+    BOOST_CHECK( moved.empty() );
+    BOOST_CHECK_EQUAL(moved.capacity(), 0);
+
+    BOOST_TEST_MESSAGE(  "   Reserving a total goes straight to the next power of two" );
+    assigned.reserve( 1000 );
+    BOOST_CHECK_EQUAL(assigned.capacity(), 1024);
+    check( assigned, 27, 40 );
+    assigned.reserve( 20 );
+    BOOST_CHECK_EQUAL(assigned.capacity(), 1024);
+}